@@ -0,0 +1,79 @@
+// benchmark: sliding-window median/p99 with 
+// QuantileWindow vs. re-sorting the window each step 
+//
+// usage: ./bench-quantile [numValues] [windowSize]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "quantile.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// same nearest-rank index as QuantileWindow::quantile 
+static int nearestRank(int m, double q) {
+  int i = (int) ceil(q * m) - 1;
+  return max(0, min(i, m - 1));
+}
+
+static double secondsSince(Clock::time_point start) {
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 200000;
+  int w = argc > 2 ? atoi(argv[2]) : 1000;
+
+  mt19937 gen(42);
+  uniform_int_distribution<int> dist(0, 1000000);
+  vector<int> stream(n);
+  for (int &v : stream)
+    v = dist(gen);
+
+  // checksums make sure both versions agree 
+  // (and that the work isn't optimized out)
+  long long sumTree = 0, sumSort = 0;
+
+  auto start = Clock::now();
+  QuantileWindow qw(w);
+  for (int v : stream) {
+    qw.push(v);
+    sumTree += qw.median() + qw.quantile(0.99);
+  }
+  double treeSecs = secondsSince(start);
+
+  start = Clock::now();
+  deque<int> window;
+  vector<int> buf;
+  for (int v : stream) {
+    window.push_back(v);
+    if (window.size() > w)
+      window.pop_front();
+
+    buf.assign(window.begin(), window.end());
+    sort(buf.begin(), buf.end());
+    int m = buf.size();
+    sumSort += buf[nearestRank(m, 0.5)] + buf[nearestRank(m, 0.99)];
+  }
+  double sortSecs = secondsSince(start);
+
+  cout << "values: " << n << ", window: " << w << endl;
+  cout << "QuantileWindow: " << treeSecs << " s ("
+       << n / treeSecs << " steps/s)" << endl;
+  cout << "re-sort window: " << sortSecs << " s ("
+       << n / sortSecs << " steps/s)" << endl;
+  cout << "speedup: " << sortSecs / treeSecs << "x" << endl;
+
+  if (sumTree != sumSort) {
+    cout << "ERROR: results differ" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,558 @@
+// benchmark: SplayTree vs. std::set vs. a B-tree on
+// insert / find / scan / rank / remove, under several
+// key distributions and tree sizes
+//
+// usage: ./bench [-n sizes] [-o ops] [-w workloads] [-s structures] [-r seed]
+//                [-p | --perf]
+//
+//   -n  comma separated tree sizes, e.g. 1000,1e6,1e8
+//       (default 1000,100000,1000000)
+//   -o  operations per phase (default 1000000)
+//   -w  any of uniform,zipf,sequential,shift,adversarial
+//       (default all)
+//   -s  any of splay,set,btree,cached,static,cache,lru
+//       (default splay,set,btree). cached is the splay
+//       tree with a hot-key cache (see
+//       SplayTree::enableHotCache), static a frozen splay
+//       tree that is rebuilt for the access counts every
+//       2^18 finds (see SplayTree::rebuildOptimal).
+//       cache is a SplayCache (see splay-cache.h) and lru
+//       a std::map plus an LRU std::list, both without a
+//       capacity, so finds also update recency
+//   -r  random seed (default 42)
+//   -p  report hardware counters per operation instead
+//       of latencies (cycles, instructions, L1d/LLC/dTLB
+//       misses, branch misses, see perf-counters.h).
+//       counters the kernel won't give us show up as n/a
+//
+// each run loads n keys (the even numbers 0..2n-2, so
+// about half of the uniform lookups miss), then runs
+// the find, scan, rank and remove phases with keys
+// from the workload. every operation is timed on its
+// own for the latency percentiles. the clock reads are
+// included in the throughput, for all structures alike.
+//
+// the results of every phase are checked against the
+// other structures, and the exit code is 1 if they differ.
+//
+// make bench BENCHFLAGS="-O2 -DSPLAY_STATS" adds the splay
+// tree statistics (see stats.h) to every run.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <list>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "btree.h"
+#include "histogram.h"
+#include "perf-counters.h"
+#include "splay.h"
+#include "splay-cache.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// a scan covers about this many keys
+const int SCAN_LEN = 100;
+
+struct SplayBench {
+  SplayTree t;
+  static const bool hasRank = true;
+
+  void insert(int k) { t.insert(k); }
+  bool find(int k) { return t.find(k) != nullptr; }
+  int rank(int k) { return t.rank(k); }
+
+  bool remove(int k) {
+    int size = t.getSize();
+    t.remove(k);
+    return t.getSize() != size;
+  }
+
+  // cut the range out as one subtree and
+  // walk it in order
+  long long scan(int lo, int hi) {
+    STNode * r = t.isolateRange(lo, hi);
+    if (r == nullptr) return 0;
+
+    int m = r->size;
+    STNode * n = r;
+    while (n->hasLeftChild()) n = n->left;
+
+    long long sum = 0;
+    for (int i = 0; i < m; i++) {
+      sum += n->key;
+      n = n->successor();
+    }
+    return sum;
+  }
+};
+
+struct CachedSplayBench : SplayBench {
+  CachedSplayBench() { t.enableHotCache(); }
+};
+
+struct StaticSplayBench : SplayBench {
+  StaticSplayBench() {
+    t.setFrozen(true);
+    t.setAutoRebuild(1 << 18);
+  }
+};
+
+struct SetBench {
+  set<int> s;
+  static const bool hasRank = false;
+
+  void insert(int k) { s.insert(k); }
+  bool find(int k) { return s.find(k) != s.end(); }
+  int rank(int k) { return 0; }
+  bool remove(int k) { return s.erase(k) > 0; }
+
+  long long scan(int lo, int hi) {
+    long long sum = 0;
+    for (auto it = s.lower_bound(lo); it != s.end() && *it <= hi; ++it)
+      sum += *it;
+    return sum;
+  }
+};
+
+struct BTreeBench {
+  BTree b;
+  static const bool hasRank = false;
+
+  void insert(int k) { b.insert(k); }
+  bool find(int k) { return b.find(k); }
+  int rank(int k) { return 0; }
+  bool remove(int k) { return b.remove(k); }
+  long long scan(int lo, int hi) { return b.sumRange(lo, hi); }
+};
+
+struct SplayCacheBench {
+  SplayCache<int, int> c;
+  static const bool hasRank = false;
+
+  SplayCacheBench() : c(0) { }
+
+  void insert(int k) { c.put(k, k); }
+  bool find(int k) { return c.get(k) != nullptr; }
+  int rank(int k) { return 0; }
+  bool remove(int k) { return c.erase(k); }
+
+  long long scan(int lo, int hi) {
+    long long sum = 0;
+    c.scan(lo, hi, [&](int k, int v) { sum += k; });
+    return sum;
+  }
+};
+
+// the usual ordered LRU cache: the map holds each
+// key's value and its position in the recency list
+struct LruMapBench {
+  map<int, pair<int, list<int>::iterator>> m;
+  list<int> lru;
+  static const bool hasRank = false;
+
+  void insert(int k) {
+    lru.push_front(k);
+    m[k] = {k, lru.begin()};
+  }
+
+  bool find(int k) {
+    auto it = m.find(k);
+    if (it == m.end()) return false;
+    lru.splice(lru.begin(), lru, it->second.second);
+    return true;
+  }
+
+  int rank(int k) { return 0; }
+
+  bool remove(int k) {
+    auto it = m.find(k);
+    if (it == m.end()) return false;
+    lru.erase(it->second.second);
+    m.erase(it);
+    return true;
+  }
+
+  long long scan(int lo, int hi) {
+    long long sum = 0;
+    for (auto it = m.lower_bound(lo); it != m.end() && it->first <= hi; ++it)
+      sum += it->first;
+    return sum;
+  }
+};
+
+// built with -DSPLAY_STATS, the splay tree's rotation and 
+// depth statistics for each run go to stderr (see stats.h) 
+template <class Bench>
+static void printStats(Bench &b) { }
+
+static void printStats(SplayBench &b) {
+#ifdef SPLAY_STATS
+  fprintf(stderr, "%s", b.t.getStats().toText().c_str());
+#endif
+}
+
+static void printStats(CachedSplayBench &b) {
+  printStats((SplayBench &) b);
+  HotCacheStats s = b.t.getHotCacheStats();
+  fprintf(stderr, "hot-key cache: %d slots, hit rate %.3f\n", s.slots, s.hitRate());
+}
+
+struct PhaseResult {
+  string structure;
+  string phase;
+  double opsPerSec;
+  LatencyHistogram latency;
+  // sum of the per-op results, compared across structures
+  long long check;
+  // hardware counts per operation (-p only)
+  double perOp[PERF_NUM_EVENTS];
+};
+
+// time op(k) for every key, one by one.
+//
+// with perf counters, the batch runs without the
+// per-op clock reads (they would be most of the
+// instructions), so there are no latencies
+template <class Op>
+static PhaseResult runPhase(const string &phase, const vector<int> &keys,
+                            PerfCounters * perf, Op op) {
+  PhaseResult r;
+  r.phase = phase;
+  r.check = 0;
+  for (double &v : r.perOp) v = 0;
+
+  auto start = Clock::now();
+  if (perf != nullptr) {
+    perf->start();
+    for (int k : keys)
+      r.check += op(k);
+    perf->stop();
+    for (int e = 0; e < PERF_NUM_EVENTS; e++)
+      r.perOp[e] = (double) perf->value(e) / max<size_t>(keys.size(), 1);
+  }
+  else {
+    for (int k : keys) {
+      auto t0 = Clock::now();
+      r.check += op(k);
+      auto t1 = Clock::now();
+      r.latency.record(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count());
+    }
+  }
+  double secs = chrono::duration<double>(Clock::now() - start).count();
+  r.opsPerSec = keys.size() / max(secs, 1e-9);
+  return r;
+}
+
+template <class Bench>
+static void runAll(const string &name, const vector<int> &load,
+                   const vector<int> &stream, PerfCounters * perf,
+                   vector<PhaseResult> &results) {
+  // heap allocated: big trees shouldn't live on the stack,
+  // and freeing them isn't part of any phase
+  Bench * b = new Bench();
+  vector<int> scans(stream.begin(), stream.begin() + stream.size() / 10);
+
+  size_t first = results.size();
+  results.push_back(runPhase("insert", load, perf,
+                             [b](int k) { b->insert(k); return 0; }));
+  results.push_back(runPhase("find", stream, perf, [b](int k) { return b->find(k); }));
+  results.push_back(runPhase("scan", scans, perf,
+                             [b](int k) { return b->scan(k, k + 2 * SCAN_LEN - 1); }));
+  if (Bench::hasRank)
+    results.push_back(runPhase("rank", stream, perf, [b](int k) { return b->rank(k); }));
+  results.push_back(runPhase("remove", stream, perf, [b](int k) { return b->remove(k); }));
+
+  for (size_t i = first; i < results.size(); i++)
+    results[i].structure = name;
+  printStats(*b);
+  delete b;
+}
+
+//
+// workloads
+//
+
+// the keys in the tree, in insertion order
+static vector<int> loadKeys(const string &workload, int n, mt19937 &gen) {
+  vector<int> keys(n);
+  for (int i = 0; i < n; i++)
+    keys[i] = 2 * i;
+
+  // ascending inserts build a path in the splay tree
+  if (workload != "sequential" && workload != "adversarial")
+    shuffle(keys.begin(), keys.end(), gen);
+  return keys;
+}
+
+// zipf(theta) ranks in [0, n) in O(1) per sample,
+// after an O(n) setup (Gray et al., "Quickly generating
+// billion-record synthetic databases", as in YCSB)
+class ZipfGenerator {
+  private:
+    long long n;
+    double theta, alpha, zetan, eta;
+
+  public:
+    ZipfGenerator(long long items, double th) : n(items), theta(th) {
+      zetan = 0;
+      for (long long i = 1; i <= n; i++)
+        zetan += 1 / pow((double) i, theta);
+      double zeta2 = 1 + 1 / pow(2.0, theta);
+      alpha = 1 / (1 - theta);
+      eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan);
+    }
+
+    long long next(mt19937 &gen) {
+      double u = uniform_real_distribution<double>(0, 1)(gen);
+      double uz = u * zetan;
+      if (uz < 1) return 0;
+      if (uz < 1 + pow(0.5, theta)) return 1;
+      long long r = (long long) (n * pow(eta * u - eta + 1, alpha));
+      return min(r, n - 1);
+    }
+};
+
+// reverse the low `bits` bits of i
+static long long reverseBits(long long i, int bits) {
+  long long r = 0;
+  for (int b = 0; b < bits; b++)
+    r |= ((i >> b) & 1) << (bits - 1 - b);
+  return r;
+}
+
+// keys for the find/scan/rank/remove phases
+static vector<int> streamKeys(const string &workload, int n, int ops, mt19937 &gen) {
+  vector<int> keys;
+  keys.reserve(ops);
+
+  if (workload == "uniform") {
+    // hits and misses alike
+    uniform_int_distribution<int> dist(0, 2 * n - 1);
+    for (int i = 0; i < ops; i++)
+      keys.push_back(dist(gen));
+  }
+  else if (workload == "zipf") {
+    // popular ranks are scattered over the key space
+    ZipfGenerator zipf(n, 0.99);
+    for (int i = 0; i < ops; i++) {
+      unsigned long long h = zipf.next(gen) * 0x9E3779B97F4A7C15ULL;
+      keys.push_back(2 * (int) ((h >> 20) % n));
+    }
+  }
+  else if (workload == "sequential") {
+    for (int i = 0; i < ops; i++)
+      keys.push_back(2 * (i % n));
+  }
+  else if (workload == "shift") {
+    // a hot set of 1% of the keys that
+    // moves somewhere else 10 times
+    int w = max(1, n / 100);
+    int phaseLen = max(1, ops / 10);
+    uniform_int_distribution<int> offset(0, n - w);
+    uniform_int_distribution<int> inSet(0, w - 1);
+    int off = offset(gen);
+    for (int i = 0; i < ops; i++) {
+      if (i > 0 && i % phaseLen == 0)
+        off = offset(gen);
+      keys.push_back(2 * (off + inSet(gen)));
+    }
+  }
+  else if (workload == "adversarial") {
+    // bit-reversal permutation: Omega(log n) per access
+    // for any BST (Wilber), here starting from the path
+    // left by the ascending load
+    int bits = 0;
+    while ((1LL << bits) < n) bits++;
+    for (long long i = 0; keys.size() < ops; i++) {
+      long long r = reverseBits(i % (1LL << bits), bits);
+      if (r < n)
+        keys.push_back(2 * (int) r);
+    }
+  }
+  return keys;
+}
+
+//
+// command line
+//
+
+static vector<string> splitList(const string &s) {
+  vector<string> parts;
+  stringstream ss(s);
+  string part;
+  while (getline(ss, part, ','))
+    if (! part.empty()) parts.push_back(part);
+  return parts;
+}
+
+static bool contains(const vector<string> &v, const string &s) {
+  return find(v.begin(), v.end(), s) != v.end();
+}
+
+static void usage(const char * prog) {
+  fprintf(stderr, "usage: %s [-n sizes] [-o ops] [-w workloads] "
+                  "[-s structures] [-r seed] [-p | --perf]\n", prog);
+}
+
+int main(int argc, char **argv) {
+  string sizeList = "1000,100000,1000000";
+  long long ops = 1000000;
+  string workloadList = "uniform,zipf,sequential,shift,adversarial";
+  string structureList = "splay,set,btree";
+  unsigned seed = 42;
+  bool usePerf = false;
+
+  static struct option longOpts[] = {
+    {"perf", no_argument, nullptr, 'p'},
+    {nullptr, 0, nullptr, 0}
+  };
+
+  int c;
+  while ((c = getopt_long(argc, argv, "n:o:w:s:r:p", longOpts, nullptr)) != -1) {
+    switch (c) {
+      case 'n': sizeList = optarg; break;
+      // strtod, so 1e6 works too
+      case 'o': ops = (long long) strtod(optarg, nullptr); break;
+      case 'w': workloadList = optarg; break;
+      case 's': structureList = optarg; break;
+      case 'r': seed = atoi(optarg); break;
+      case 'p': usePerf = true; break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+
+  vector<string> workloads = splitList(workloadList);
+  vector<string> structures = splitList(structureList);
+  vector<long long> sizes;
+  for (string &s : splitList(sizeList))
+    sizes.push_back((long long) strtod(s.c_str(), nullptr));
+
+  // keys are 2i for i < n, and scans go a bit past 
+  // the largest key, so n has to stay well below 2^30
+  for (long long n : sizes) {
+    if (n < 1 || n > (1LL << 29)) {
+      fprintf(stderr, "bad size %lld\n", n);
+      return 2;
+    }
+  }
+  if (ops < 10 || ops > (1LL << 31) - 1) {
+    fprintf(stderr, "bad op count %lld\n", ops);
+    return 2;
+  }
+
+  vector<string> known = splitList("uniform,zipf,sequential,shift,adversarial");
+  for (const string &w : workloads) {
+    if (! contains(known, w)) {
+      fprintf(stderr, "unknown workload %s\n", w.c_str());
+      return 2;
+    }
+  }
+  known = splitList("splay,set,btree,cached,static,cache,lru");
+  for (const string &s : structures) {
+    if (! contains(known, s)) {
+      fprintf(stderr, "unknown structure %s\n", s.c_str());
+      return 2;
+    }
+  }
+
+  PerfCounters counters;
+  PerfCounters * perf = nullptr;
+  if (usePerf) {
+    if (counters.open())
+      perf = &counters;
+    else
+      fprintf(stderr, "no hardware counters available "
+                      "(check /proc/sys/kernel/perf_event_paranoid), "
+                      "reporting latencies instead\n");
+  }
+
+  bool mismatch = false;
+  if (perf != nullptr) {
+    printf("%-12s %10s %-6s %-7s %9s %8s", "workload", "n",
+           "struct", "phase", "Mops/s", "vs set");
+    for (int e = 0; e < PERF_NUM_EVENTS; e++)
+      printf(" %13s", perfEventName(e));
+    printf("   (per op)\n");
+  }
+  else 
+    printf("%-12s %10s %-6s %-7s %9s %8s %8s %8s %8s\n", "workload", "n",
+           "struct", "phase", "Mops/s", "vs set", "p50 ns", "p99 ns", "p999 ns");
+
+  for (const string &w : workloads) {
+    for (long long n : sizes) {
+      mt19937 gen(seed);
+      vector<int> load = loadKeys(w, n, gen);
+      vector<int> stream = streamKeys(w, n, ops, gen);
+
+      vector<PhaseResult> results;
+      if (contains(structures, "splay"))
+        runAll<SplayBench>("splay", load, stream, perf, results);
+      if (contains(structures, "set"))
+        runAll<SetBench>("set", load, stream, perf, results);
+      if (contains(structures, "btree"))
+        runAll<BTreeBench>("btree", load, stream, perf, results);
+      if (contains(structures, "cached"))
+        runAll<CachedSplayBench>("cached", load, stream, perf, results);
+      if (contains(structures, "static"))
+        runAll<StaticSplayBench>("static", load, stream, perf, results);
+      if (contains(structures, "cache"))
+        runAll<SplayCacheBench>("cache", load, stream, perf, results);
+      if (contains(structures, "lru"))
+        runAll<LruMapBench>("lru", load, stream, perf, results);
+
+      for (PhaseResult &r : results) {
+        // std::set is the reference for throughput,
+        // and every structure has to agree on the results
+        // (rank only exists for the splay tree)
+        string vs = "-";
+        for (PhaseResult &o : results) {
+          if (o.phase != r.phase || &o == &r) continue;
+          if (o.check != r.check) mismatch = true;
+          if (o.structure == "set") {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%.2fx", r.opsPerSec / o.opsPerSec);
+            vs = buf;
+          }
+        }
+
+        printf("%-12s %10lld %-6s %-7s %9.3f %8s",
+               w.c_str(), n, r.structure.c_str(), r.phase.c_str(),
+               r.opsPerSec / 1e6, vs.c_str());
+        if (perf != nullptr) {
+          for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+            if (perf->available(e))
+              printf(" %13.2f", r.perOp[e]);
+            else
+              printf(" %13s", "n/a");
+          }
+          printf("\n");
+        }
+        else
+          printf(" %8llu %8llu %8llu\n",
+                 (unsigned long long) r.latency.percentile(0.5),
+                 (unsigned long long) r.latency.percentile(0.99),
+                 (unsigned long long) r.latency.percentile(0.999));
+      }
+      fflush(stdout);
+    }
+  }
+
+  if (mismatch) {
+    printf("ERROR: structures disagree on some results\n");
+    return 1;
+  }
+  return 0;
+}
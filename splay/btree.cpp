@@ -0,0 +1,261 @@
+#include <cassert>
+#include "btree.h"
+
+const int T = BTREE_T;
+
+BTree::~BTree() {
+  freeSubtree(root);
+}
+
+void BTree::freeSubtree(BTNode * node) {
+  if (node == nullptr) return;
+  if (! node->leaf)
+    for (int i = 0; i <= node->n; i++)
+      freeSubtree(node->child[i]);
+  delete node;
+}
+
+// index of the first key in x that is >= k
+static int lowerIndex(const BTNode * x, int k) {
+  int lo = 0, hi = x->n;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (x->keys[mid] < k) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+bool BTree::find(int k) const {
+  const BTNode * x = root;
+  while (x != nullptr) {
+    int i = lowerIndex(x, k);
+    if (i < x->n && x->keys[i] == k) return true;
+    if (x->leaf) return false;
+    x = x->child[i];
+  }
+  return false;
+}
+
+// split the full child x->child[i] around its
+// median key, which moves up into x (not full)
+void BTree::splitChild(BTNode * x, int i) {
+  BTNode * y = x->child[i];
+  BTNode * z = new BTNode(y->leaf);
+  z->n = T - 1;
+  for (int j = 0; j < T - 1; j++)
+    z->keys[j] = y->keys[j + T];
+  if (! y->leaf)
+    for (int j = 0; j < T; j++)
+      z->child[j] = y->child[j + T];
+  y->n = T - 1;
+
+  for (int j = x->n; j > i; j--)
+    x->child[j + 1] = x->child[j];
+  x->child[i + 1] = z;
+  for (int j = x->n - 1; j >= i; j--)
+    x->keys[j + 1] = x->keys[j];
+  x->keys[i] = y->keys[T - 1];
+  x->n++;
+}
+
+// full nodes are split on the way down, so
+// there is always room for the key at the leaf.
+// a duplicate can still cause splits, which is harmless
+bool BTree::insertNonFull(BTNode * x, int k) {
+  while (true) {
+    int i = lowerIndex(x, k);
+    if (i < x->n && x->keys[i] == k) return false;
+
+    if (x->leaf) {
+      for (int j = x->n; j > i; j--)
+        x->keys[j] = x->keys[j - 1];
+      x->keys[i] = k;
+      x->n++;
+      return true;
+    }
+
+    if (x->child[i]->n == 2 * T - 1) {
+      splitChild(x, i);
+      if (k == x->keys[i]) return false;
+      if (k > x->keys[i]) i++;
+    }
+    x = x->child[i];
+  }
+}
+
+bool BTree::insert(int k) {
+  if (root == nullptr)
+    root = new BTNode(true);
+
+  if (root->n == 2 * T - 1) {
+    BTNode * s = new BTNode(false);
+    s->child[0] = root;
+    root = s;
+    splitChild(s, 0);
+  }
+
+  bool inserted = insertNonFull(root, k);
+  if (inserted) count++;
+  return inserted;
+}
+
+bool BTree::remove(int k) {
+  if (root == nullptr) return false;
+
+  bool removed = _remove(root, k);
+  if (removed) count--;
+
+  // the root lost its last key to a merge
+  if (root->n == 0) {
+    BTNode * old = root;
+    root = root->leaf ? nullptr : root->child[0];
+    delete old;
+  }
+  return removed;
+}
+
+// delete k from the subtree at x, where x has at least
+// T keys (or is the root). children are topped up
+// before descending, so no fix-ups are needed on the
+// way back (CLRS 18.3)
+bool BTree::_remove(BTNode * x, int k) {
+  int i = lowerIndex(x, k);
+
+  if (i < x->n && x->keys[i] == k) {
+    if (x->leaf) {
+      for (int j = i + 1; j < x->n; j++)
+        x->keys[j - 1] = x->keys[j];
+      x->n--;
+      return true;
+    }
+
+    BTNode * y = x->child[i];
+    BTNode * z = x->child[i + 1];
+    if (y->n >= T) {
+      // replace k by its predecessor
+      BTNode * p = y;
+      while (! p->leaf) p = p->child[p->n];
+      int pred = p->keys[p->n - 1];
+      x->keys[i] = pred;
+      return _remove(y, pred);
+    }
+    if (z->n >= T) {
+      // replace k by its successor
+      BTNode * s = z;
+      while (! s->leaf) s = s->child[0];
+      int succ = s->keys[0];
+      x->keys[i] = succ;
+      return _remove(z, succ);
+    }
+
+    // both have T-1 keys: merge them around k
+    merge(x, i);
+    return _remove(y, k);
+  }
+
+  if (x->leaf) return false;
+
+  bool last = (i == x->n);
+  if (x->child[i]->n < T)
+    fill(x, i);
+
+  // if the last child was merged into
+  // its left sibling, k is there now
+  if (last && i > x->n)
+    return _remove(x->child[i - 1], k);
+  return _remove(x->child[i], k);
+}
+
+// give x->child[i] (with T-1 keys) at least T keys
+void BTree::fill(BTNode * x, int i) {
+  if (i != 0 && x->child[i - 1]->n >= T)
+    borrowFromPrev(x, i);
+  else if (i != x->n && x->child[i + 1]->n >= T)
+    borrowFromNext(x, i);
+  else if (i != x->n)
+    merge(x, i);
+  else
+    merge(x, i - 1);
+}
+
+void BTree::borrowFromPrev(BTNode * x, int i) {
+  BTNode * c = x->child[i];
+  BTNode * s = x->child[i - 1];
+
+  for (int j = c->n - 1; j >= 0; j--)
+    c->keys[j + 1] = c->keys[j];
+  if (! c->leaf)
+    for (int j = c->n; j >= 0; j--)
+      c->child[j + 1] = c->child[j];
+
+  c->keys[0] = x->keys[i - 1];
+  if (! c->leaf)
+    c->child[0] = s->child[s->n];
+  x->keys[i - 1] = s->keys[s->n - 1];
+
+  c->n++;
+  s->n--;
+}
+
+void BTree::borrowFromNext(BTNode * x, int i) {
+  BTNode * c = x->child[i];
+  BTNode * s = x->child[i + 1];
+
+  c->keys[c->n] = x->keys[i];
+  if (! c->leaf)
+    c->child[c->n + 1] = s->child[0];
+  x->keys[i] = s->keys[0];
+
+  for (int j = 1; j < s->n; j++)
+    s->keys[j - 1] = s->keys[j];
+  if (! s->leaf)
+    for (int j = 1; j <= s->n; j++)
+      s->child[j - 1] = s->child[j];
+
+  c->n++;
+  s->n--;
+}
+
+// merge x->child[i+1] and the separating key
+// x->keys[i] into x->child[i]
+void BTree::merge(BTNode * x, int i) {
+  BTNode * c = x->child[i];
+  BTNode * s = x->child[i + 1];
+  assert(c->n + s->n + 1 <= 2 * T - 1);
+
+  c->keys[c->n] = x->keys[i];
+  for (int j = 0; j < s->n; j++)
+    c->keys[c->n + 1 + j] = s->keys[j];
+  if (! c->leaf)
+    for (int j = 0; j <= s->n; j++)
+      c->child[c->n + 1 + j] = s->child[j];
+  c->n += s->n + 1;
+
+  for (int j = i + 1; j < x->n; j++)
+    x->keys[j - 1] = x->keys[j];
+  for (int j = i + 2; j <= x->n; j++)
+    x->child[j - 1] = x->child[j];
+  x->n--;
+
+  delete s;
+}
+
+long long BTree::sumRange(int lo, int hi) const {
+  if (root == nullptr || lo > hi) return 0;
+  return _sumRange(root, lo, hi);
+}
+
+// only children whose key interval
+// overlaps [lo, hi] are visited
+long long BTree::_sumRange(const BTNode * x, int lo, int hi) {
+  long long sum = 0;
+  int i = lowerIndex(x, lo);
+  for (; i <= x->n; i++) {
+    if (! x->leaf)
+      sum += _sumRange(x->child[i], lo, hi);
+    if (i == x->n || x->keys[i] > hi) break;
+    sum += x->keys[i];
+  }
+  return sum;
+}
@@ -0,0 +1,58 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+// in-memory B-tree set of ints, as in CLRS ch. 18.
+// this is the cache-friendly baseline the splay tree
+// is benchmarked against (see bench.cpp): wide nodes,
+// O(log_T n) worst case per operation and no
+// restructuring on reads.
+
+// minimum degree: every node except the root
+// holds between T-1 and 2T-1 keys
+const int BTREE_T = 32;
+
+struct BTNode {
+  int n;
+  bool leaf;
+  int keys[2 * BTREE_T - 1];
+  BTNode * child[2 * BTREE_T];
+
+  BTNode(bool isLeaf) : n(0), leaf(isLeaf) { }
+};
+
+class BTree {
+  private:
+    long long count;
+
+    static void freeSubtree(BTNode * node);
+    void splitChild(BTNode * x, int i);
+    bool insertNonFull(BTNode * x, int k);
+
+    bool _remove(BTNode * x, int k);
+    void fill(BTNode * x, int i);
+    void borrowFromPrev(BTNode * x, int i);
+    void borrowFromNext(BTNode * x, int i);
+    void merge(BTNode * x, int i);
+
+    static long long _sumRange(const BTNode * x, int lo, int hi);
+
+  public:
+    BTNode * root;
+
+    BTree() : count(0), root(nullptr) { }
+    ~BTree();
+
+    bool find(int k) const;
+    // false if k was already present
+    bool insert(int k);
+    // false if k was not present
+    bool remove(int k);
+
+    // sum of the keys in [lo, hi], visiting
+    // them in order (a range scan)
+    long long sumRange(int lo, int hi) const;
+
+    long long getSize() const { return count; }
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "buffer-pool.h"
+
+BufferPool::BufferPool()
+  : fd(-1),
+    hand(0),
+    ioError(false),
+    hits(0),
+    misses(0),
+    evictions(0),
+    writebacks(0) { }
+
+BufferPool::~BufferPool() {
+  close();
+}
+
+bool BufferPool::open(const std::string &path, int numFrames) {
+  close();
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return false;
+
+  frames.assign(numFrames, Frame{0, 0, false, false, false});
+  memory.assign((size_t) numFrames * POOL_PAGE_SIZE, 0);
+  table.clear();
+  hand = 0;
+  ioError = false;
+  hits = misses = evictions = writebacks = 0;
+  return true;
+}
+
+bool BufferPool::close() {
+  if (fd < 0) return true;
+  bool ok = flush();
+  ok = ::close(fd) == 0 && ok;
+  fd = -1;
+  frames.clear();
+  memory.clear();
+  table.clear();
+  return ok;
+}
+
+bool BufferPool::writeBack(int f) {
+  off_t off = (off_t) frames[f].page * POOL_PAGE_SIZE;
+  if (pwrite(fd, frameData(f), POOL_PAGE_SIZE, off) != (ssize_t) POOL_PAGE_SIZE) {
+    ioError = true;
+    return false;
+  }
+  frames[f].dirty = false;
+  writebacks++;
+  return true;
+}
+
+// second chance: a referenced frame loses its
+// bit and is passed over once. two full turns
+// without a victim means everything is pinned
+int BufferPool::victim() {
+  for (size_t i = 0; i < 2 * frames.size(); i++) {
+    Frame &fr = frames[hand];
+    int f = hand;
+    hand = (hand + 1) % frames.size();
+    if (! fr.used) return f;
+    if (fr.pins > 0) continue;
+    if (fr.referenced) {
+      fr.referenced = false;
+      continue;
+    }
+    return f;
+  }
+  return -1;
+}
+
+char * BufferPool::pin(uint32_t page) {
+  auto it = table.find(page);
+  if (it != table.end()) {
+    Frame &fr = frames[it->second];
+    fr.pins++;
+    fr.referenced = true;
+    hits++;
+    return frameData(it->second);
+  }
+
+  misses++;
+  int f = victim();
+  assert(f >= 0);
+  Frame &fr = frames[f];
+  if (fr.used) {
+    // a failed write back is reported by
+    // flush/close, the page is lost either way
+    if (fr.dirty)
+      writeBack(f);
+    table.erase(fr.page);
+    evictions++;
+  }
+
+  // a short read is the end of the file,
+  // the rest of the page is zeros
+  char * data = frameData(f);
+  ssize_t n = pread(fd, data, POOL_PAGE_SIZE, (off_t) page * POOL_PAGE_SIZE);
+  if (n < 0) {
+    ioError = true;
+    n = 0;
+  }
+  memset(data + n, 0, POOL_PAGE_SIZE - n);
+
+  fr.page = page;
+  fr.pins = 1;
+  fr.dirty = false;
+  fr.referenced = true;
+  fr.used = true;
+  table[page] = f;
+  return data;
+}
+
+void BufferPool::unpin(uint32_t page, bool dirty) {
+  auto it = table.find(page);
+  assert(it != table.end());
+  Frame &fr = frames[it->second];
+  assert(fr.pins > 0);
+  fr.pins--;
+  fr.dirty = fr.dirty || dirty;
+}
+
+bool BufferPool::flush() {
+  if (fd < 0) return false;
+  for (size_t f = 0; f < frames.size(); f++)
+    if (frames[f].used && frames[f].dirty)
+      writeBack(f);
+  if (fsync(fd) != 0)
+    ioError = true;
+  return ! ioError;
+}
+
+BufferPoolStats BufferPool::getStats() const {
+  BufferPoolStats s;
+  s.frames = frames.size();
+  s.hits = hits;
+  s.misses = misses;
+  s.evictions = evictions;
+  s.writebacks = writebacks;
+  return s;
+}
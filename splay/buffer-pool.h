@@ -0,0 +1,99 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// fixed-size pages of a local file, cached in
+// a bounded number of in-memory frames (used by
+// DiskSplayTree, see disk-splay.h).
+//
+// pin(page) returns the page's bytes, reading the
+// page in first if it isn't cached. a pinned page
+// stays in its frame until every pin is released
+// with unpin, so the pointer stays valid until then.
+// unpin(.., true) marks the page dirty: it's written
+// back when its frame is reused, or by flush.
+//
+// frames are reused in clock order: each frame has
+// a reference bit that every pin sets, and the clock
+// hand clears bits until it finds an unpinned frame
+// whose bit is clear. pages touched by every
+// operation (for a splay tree, the ones near the
+// root) keep their bits set and stay resident.
+//
+// pages past the end of the file read as zeros.
+// nothing is written until eviction or flush, and
+// there is no journal: the file is only consistent
+// after flush (or close).
+
+const size_t POOL_PAGE_SIZE = 4096;
+
+struct BufferPoolStats {
+  int frames;
+  long long hits;
+  long long misses;
+  long long evictions;
+  long long writebacks;
+
+  double hitRate() const {
+    long long n = hits + misses;
+    return n == 0 ? 0 : (double) hits / n;
+  }
+};
+
+class BufferPool {
+  private:
+    struct Frame {
+      uint32_t page;
+      int pins;
+      bool dirty;
+      bool referenced;
+      bool used;
+    };
+
+    int fd;
+    std::vector<Frame> frames;
+    std::vector<char> memory;
+    std::unordered_map<uint32_t, int> table;
+    int hand;
+    bool ioError;
+
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long writebacks;
+
+    char * frameData(int f) { return memory.data() + (size_t) f * POOL_PAGE_SIZE; }
+    bool writeBack(int f);
+    // a free or evictable frame, -1 if
+    // every frame is pinned
+    int victim();
+
+  public:
+    BufferPool();
+    ~BufferPool();
+
+    // open (or create) the file with room for
+    // numFrames pages in memory
+    bool open(const std::string &path, int numFrames);
+    // flush and close. false on any I/O error
+    // since open
+    bool close();
+    bool isOpen() const { return fd >= 0; }
+
+    // precondition: the pool is open and not
+    // every frame is pinned
+    char * pin(uint32_t page);
+    void unpin(uint32_t page, bool dirty);
+
+    // write every dirty page back (and fsync).
+    // false on any I/O error since open
+    bool flush();
+
+    BufferPoolStats getStats() const;
+};
+
+#endif
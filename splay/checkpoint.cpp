@@ -0,0 +1,334 @@
+#include "checkpoint.h"
+#include "snapshot.h"
+#include <assert.h>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+
+// append raw bytes to a buffer 
+static void put(std::vector<char> &buf, const void * data, size_t len) {
+  const char * p = (const char *) data;
+  buf.insert(buf.end(), p, p + len);
+}
+
+// bounds-checked reads from a file body 
+struct Reader {
+  const std::vector<char> &buf;
+  size_t pos;
+
+  Reader(const std::vector<char> &b) : buf(b), pos(0) { }
+
+  bool get(void * out, size_t len) {
+    if (len > remaining()) return false;
+    memcpy(out, buf.data() + pos, len);
+    pos += len;
+    return true;
+  }
+
+  size_t remaining() const { return buf.size() - pos; }
+};
+
+static uint64_t headerChecksum(const CheckpointHeader &h) {
+  return checksumBytes(&h, offsetof(CheckpointHeader, headerChecksum));
+}
+
+// one chunk entry: index, number of keys, keys, counts 
+static void putChunk(std::vector<char> &buf, uint32_t index, 
+                     const int32_t * keys, const int32_t * counts, uint32_t n) {
+  put(buf, &index, sizeof(index));
+  put(buf, &n, sizeof(n));
+  put(buf, keys, n * sizeof(int32_t));
+  put(buf, counts, n * sizeof(int32_t));
+}
+
+// write header + body to a temp file, fsync it 
+// and rename it to path 
+static bool writeFile(const std::string &path, CheckpointHeader h, 
+                      const std::vector<char> &body) {
+  memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+  h.version = CHECKPOINT_VERSION;
+  h.checksum = checksumBytes(body.data(), body.size());
+  h.headerChecksum = headerChecksum(h);
+
+  std::string tmp = path + ".tmp";
+  FILE * f = fopen(tmp.c_str(), "wb");
+  if (f == nullptr) return false;
+
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+  ok = ok && (body.empty() || fwrite(body.data(), body.size(), 1, f) == 1);
+  ok = ok && fflush(f) == 0;
+  ok = ok && fsync(fileno(f)) == 0;
+  ok = (fclose(f) == 0) && ok;
+  return ok && rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// read and validate a file. false if missing or corrupt 
+static bool readFile(const std::string &path, CheckpointHeader &h, 
+                     std::vector<char> &body) {
+  FILE * f = fopen(path.c_str(), "rb");
+  if (f == nullptr) return false;
+
+  bool ok = fread(&h, sizeof(h), 1, f) == 1;
+  if (ok) {
+    fseek(f, 0, SEEK_END);
+    long end = ftell(f);
+    fseek(f, sizeof(h), SEEK_SET);
+    body.resize(end - sizeof(h));
+    ok = body.empty() || fread(body.data(), body.size(), 1, f) == 1;
+  }
+  fclose(f);
+
+  return ok 
+    && memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) == 0
+    && h.version == CHECKPOINT_VERSION 
+    && h.headerChecksum == headerChecksum(h)
+    && h.checksum == checksumBytes(body.data(), body.size());
+}
+
+// generation of the base file at path, 0 if 
+// there is none or its header is damaged. only 
+// the header is read 
+static uint64_t baseGeneration(const std::string &path) {
+  FILE * f = fopen(path.c_str(), "rb");
+  if (f == nullptr) return 0;
+  CheckpointHeader h;
+  bool ok = fread(&h, sizeof(h), 1, f) == 1;
+  fclose(f);
+
+  if (! ok || memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 
+      || h.version != CHECKPOINT_VERSION || h.headerChecksum != headerChecksum(h) 
+      || h.kind != CHECKPOINT_BASE) 
+    return 0;
+  return h.generation;
+}
+
+IncrementalCheckpointer::IncrementalCheckpointer(const std::string &d, int keys) 
+  : dir(d), 
+    chunkKeys(keys > 0 ? keys : 1), 
+    generation(0), 
+    seq(0), 
+    chunksWritten(0), 
+    bytesWritten(0) { }
+
+std::string IncrementalCheckpointer::basePath() const {
+  return dir + "/base.ckpt";
+}
+
+std::string IncrementalCheckpointer::deltaPath(uint64_t s) const {
+  char name[32];
+  snprintf(name, sizeof(name), "/delta-%06llu.ckpt", (unsigned long long) s);
+  return dir + name;
+}
+
+// largest key of chunk i 
+int IncrementalCheckpointer::chunkHi(int i) const {
+  return i + 1 < bounds.size() ? bounds[i + 1] - 1 : INT_MAX;
+}
+
+IncrementalCheckpointer::ChunkSig IncrementalCheckpointer::chunkSig(SplayTree &t, int i) {
+  STNode * range = t.isolateRange(bounds[i], chunkHi(i));
+  if (range == nullptr) 
+    return ChunkSig{0, 0, 0, 0};
+
+  ll countHash = 0;
+  if (range->weight != range->size) {
+    sigKeys.clear();
+    sigCounts.clear();
+    collectInorder(range, sigKeys, sigCounts);
+    countHash = checksumBytes(sigKeys.data(), sigKeys.size() * sizeof(int32_t));
+    countHash = checksumBytes(sigCounts.data(), sigCounts.size() * sizeof(int32_t), countHash);
+  }
+  return ChunkSig{range->size, range->weight, range->hash, countHash};
+}
+
+// delete delta files from seq number from onwards 
+void IncrementalCheckpointer::removeDeltas(uint64_t from) {
+  for (uint64_t s = from; unlink(deltaPath(s).c_str()) == 0; s++)
+    ;
+}
+
+bool IncrementalCheckpointer::writeBase(SplayTree &t) {
+  std::vector<int32_t> keys, counts;
+  keys.reserve(t.getSize());
+  counts.reserve(t.getSize());
+  collectInorder(t.root, keys, counts);
+
+  // chunk i starts at key i * chunkKeys 
+  bounds.assign(1, INT_MIN);
+  for (size_t i = chunkKeys; i < keys.size(); i += chunkKeys)
+    bounds.push_back(keys[i]);
+
+  std::vector<char> body;
+  put(body, bounds.data(), bounds.size() * sizeof(int32_t));
+  for (int i = 0; i < bounds.size(); i++) {
+    size_t first = (size_t) i * chunkKeys;
+    size_t n = std::min((size_t) chunkKeys, keys.size() - std::min(first, keys.size()));
+    putChunk(body, i, keys.data() + first, counts.data() + first, n);
+  }
+
+  // a checkpointer that didn't load the current 
+  // base still has to move past its generation: 
+  // a crash before removeDeltas below leaves that 
+  // base's deltas, which must not match the new one 
+  generation = std::max(generation, baseGeneration(basePath()));
+
+  CheckpointHeader h;
+  memset(&h, 0, sizeof(h));
+  h.kind = CHECKPOINT_BASE;
+  h.generation = generation + 1;
+  h.seq = 0;
+  h.numChunks = bounds.size();
+  h.numEntries = bounds.size();
+  if (! writeFile(basePath(), h, body)) return false;
+
+  // deltas of the previous base are now stale 
+  removeDeltas(1);
+  generation = h.generation;
+  seq = 0;
+
+  sigs.resize(bounds.size());
+  for (int i = 0; i < bounds.size(); i++)
+    sigs[i] = chunkSig(t, i);
+
+  chunksWritten = bounds.size();
+  bytesWritten = sizeof(h) + body.size();
+  return true;
+}
+
+bool IncrementalCheckpointer::writeDelta(SplayTree &t) {
+  if (generation == 0)
+    return writeBase(t);
+
+  std::vector<char> body;
+  std::vector<ChunkSig> newSigs(sigs.size());
+  std::vector<int32_t> keys, counts;
+  int changed = 0;
+  for (int i = 0; i < bounds.size(); i++) {
+    newSigs[i] = chunkSig(t, i);
+    if (! (newSigs[i] != sigs[i])) continue;
+
+    // chunk i is now gathered in one subtree 
+    keys.clear();
+    counts.clear();
+    collectInorder(t.isolateRange(bounds[i], chunkHi(i)), keys, counts);
+    putChunk(body, i, keys.data(), counts.data(), keys.size());
+    changed++;
+  }
+
+  chunksWritten = changed;
+  bytesWritten = 0;
+  if (changed == 0) return true;
+
+  CheckpointHeader h;
+  memset(&h, 0, sizeof(h));
+  h.kind = CHECKPOINT_DELTA;
+  h.generation = generation;
+  h.seq = seq + 1;
+  h.numChunks = bounds.size();
+  h.numEntries = changed;
+  if (! writeFile(deltaPath(h.seq), h, body)) return false;
+
+  seq = h.seq;
+  sigs = newSigs;
+  bytesWritten = sizeof(h) + body.size();
+  return true;
+}
+
+// a decoded chunk entry 
+struct ChunkEntry {
+  uint32_t index;
+  std::vector<int32_t> keys;
+  std::vector<int32_t> counts;
+};
+
+// bytes of a chunk entry with no keys 
+const size_t CHUNK_ENTRY_MIN = 2 * sizeof(uint32_t);
+
+// decode numEntries chunk entries. false if the 
+// body is too short or an index is out of range. 
+// counts are checked against the bytes left before 
+// anything is allocated 
+static bool readChunks(Reader &r, uint64_t numEntries, uint64_t numChunks, 
+                       std::vector<ChunkEntry> &entries) {
+  if (numEntries > r.remaining() / CHUNK_ENTRY_MIN) return false;
+  entries.resize(numEntries);
+  for (ChunkEntry &e : entries) {
+    uint32_t n;
+    if (! r.get(&e.index, sizeof(e.index)) || ! r.get(&n, sizeof(n))) return false;
+    if (e.index >= numChunks) return false;
+    if (n > r.remaining() / (2 * sizeof(int32_t))) return false;
+
+    e.keys.resize(n);
+    e.counts.resize(n);
+    if (! r.get(e.keys.data(), n * sizeof(int32_t))) return false;
+    if (! r.get(e.counts.data(), n * sizeof(int32_t))) return false;
+  }
+  return true;
+}
+
+bool IncrementalCheckpointer::load(SplayTree &t) {
+  assert(t.root == nullptr);
+
+  CheckpointHeader h;
+  std::vector<char> body;
+  if (! readFile(basePath(), h, body) || h.kind != CHECKPOINT_BASE) 
+    return false;
+  // a base holds every chunk, each with its bound 
+  // and an entry, which must fit in the body 
+  if (h.numEntries != h.numChunks || h.numChunks == 0 
+      || h.numChunks > body.size() / (sizeof(int32_t) + CHUNK_ENTRY_MIN)) 
+    return false;
+
+  uint64_t numChunks = h.numChunks;
+  std::vector<int32_t> newBounds(numChunks);
+  std::vector<ChunkEntry> chunks;
+  Reader r(body);
+  if (! r.get(newBounds.data(), numChunks * sizeof(int32_t))) return false;
+  if (! readChunks(r, h.numEntries, numChunks, chunks)) return false;
+  for (uint64_t c = 0; c < numChunks; c++)
+    if (chunks[c].index != c) return false;
+
+  // apply deltas of this base in order, 
+  // up to the first missing or invalid one 
+  uint64_t gen = h.generation;
+  uint64_t s = 0;
+  while (true) {
+    CheckpointHeader dh;
+    std::vector<char> dbody;
+    if (! readFile(deltaPath(s + 1), dh, dbody)) break;
+    if (dh.kind != CHECKPOINT_DELTA || dh.generation != gen 
+        || dh.seq != s + 1 || dh.numChunks != numChunks) 
+      break;
+
+    // a delta is applied only if it decodes completely 
+    std::vector<ChunkEntry> changed;
+    Reader dr(dbody);
+    if (! readChunks(dr, dh.numEntries, numChunks, changed)) break;
+    for (ChunkEntry &e : changed)
+      chunks[e.index] = std::move(e);
+    s++;
+  }
+
+  std::vector<STNode *> nodes;
+  for (uint64_t c = 0; c < numChunks; c++) {
+    for (size_t i = 0; i < chunks[c].keys.size(); i++) {
+      STNode * node = t.allocNode(chunks[c].keys[i]);
+      node->count = node->weight = chunks[c].counts[i];
+      nodes.push_back(node);
+    }
+  }
+  t.buildFromSorted(nodes);
+
+  bounds.swap(newBounds);
+  generation = gen;
+  seq = s;
+  sigs.resize(bounds.size());
+  for (int i = 0; i < bounds.size(); i++)
+    sigs[i] = chunkSig(t, i);
+  chunksWritten = 0;
+  bytesWritten = 0;
+  return true;
+}
@@ -0,0 +1,122 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "splay.h"
+
+// incremental checkpoints of a splay tree 
+//
+// a base checkpoint splits the keys into chunks 
+// of about chunkKeys consecutive keys and fixes 
+// the chunk boundaries (as key ranges). 
+// a delta checkpoint only writes the chunks whose 
+// signature changed since the previous checkpoint, 
+// so its I/O is proportional to the number of 
+// changed chunks, not to the tree size. 
+//
+// chunks are aligned on key ranges rather than on 
+// subtrees because splaying moves subtrees around 
+// on every access. the signature of a chunk is the 
+// (size, weight, hash) of the subtree that 
+// isolateRange() gathers its keys into, so for a 
+// chunk without repeated keys it costs O(log n) 
+// amortized and reads no keys. the hash ignores 
+// counts, so a chunk whose weight is above its size 
+// also hashes its (key, count) pairs, which reads 
+// the chunk but catches copies moving between keys. 
+//
+// files in dir: base.ckpt, delta-000001.ckpt, ... 
+// (each written to a temp file and renamed). 
+// loading applies the deltas of the current base 
+// in order on top of it. a new base takes a 
+// generation above the one on disk, even from a 
+// checkpointer that never loaded it, so deltas 
+// that a crash left behind never match it. 
+//
+// write a new base from time to time, which 
+// rebalances chunks that have grown 
+
+const char CHECKPOINT_MAGIC[8] = {'S','P','L','A','Y','C','K','P'};
+const uint32_t CHECKPOINT_VERSION = 2;
+
+const uint32_t CHECKPOINT_BASE  = 0;
+const uint32_t CHECKPOINT_DELTA = 1;
+
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t kind;
+  uint64_t generation;   // which base this file belongs to 
+  uint64_t seq;          // 0 for base, 1, 2, ... for deltas 
+  uint64_t numChunks;
+  uint64_t numEntries;   // chunks stored in this file 
+  uint64_t checksum;     // of everything after the header 
+  uint64_t headerChecksum;  // of the header fields above 
+};
+
+class IncrementalCheckpointer {
+  private:
+    struct ChunkSig {
+      int size;
+      int weight;
+      ll hash;
+      // of the (key, count) pairs, 0 if every 
+      // count is 1 
+      ll countHash;
+
+      bool operator!= (const ChunkSig &o) const {
+        return size != o.size || weight != o.weight || hash != o.hash 
+            || countHash != o.countHash;
+      }
+    };
+
+    std::string dir;
+    int chunkKeys;
+
+    uint64_t generation;
+    uint64_t seq;
+
+    // chunk i holds keys in [bounds[i], bounds[i+1]) 
+    // (bounds[0] is INT_MIN, the last chunk is open-ended) 
+    std::vector<int32_t> bounds;
+
+    // signatures as of the last checkpoint 
+    std::vector<ChunkSig> sigs;
+
+    // scratch space for countHash 
+    std::vector<int32_t> sigKeys;
+    std::vector<int32_t> sigCounts;
+
+    int chunksWritten;
+    long long bytesWritten;
+
+    std::string basePath() const;
+    std::string deltaPath(uint64_t s) const;
+
+    int chunkHi(int i) const;
+    ChunkSig chunkSig(SplayTree &t, int i);
+    void removeDeltas(uint64_t from);
+
+  public:
+    IncrementalCheckpointer(const std::string &dir, int chunkKeys = 4096);
+
+    // full checkpoint, new chunk boundaries 
+    bool writeBase(SplayTree &t);
+
+    // changed chunks only (writes a base if 
+    // there is none yet) 
+    bool writeDelta(SplayTree &t);
+
+    // rebuild the tree from base + deltas in O(n) 
+    // and continue checkpointing from there. 
+    // precondition: t is empty 
+    bool load(SplayTree &t);
+
+    int chunkCount() const { return bounds.size(); }
+    int lastChunksWritten() const { return chunksWritten; }
+    long long lastBytesWritten() const { return bytesWritten; }
+};
+
+#endif
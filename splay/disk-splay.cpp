@@ -0,0 +1,436 @@
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include "disk-splay.h"
+
+// written as 1, 2, 3, 4 in the file's byte order
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+DiskSplayTree::DiskSplayTree() {
+  memset(&header, 0, sizeof(header));
+}
+
+DiskSplayTree::~DiskSplayTree() {
+  close();
+}
+
+bool DiskSplayTree::open(const std::string &path, int numFrames) {
+  close();
+  // operations pin one page at a time
+  assert(numFrames >= 1);
+  if (! pool.open(path, numFrames)) return false;
+
+  char * page = pool.pin(0);
+  memcpy(&header, page, sizeof(header));
+  pool.unpin(0, false);
+
+  // a new (or empty) file reads as zeros
+  bool fresh = true;
+  for (int i = 0; i < 8; i++)
+    fresh = fresh && header.magic[i] == 0;
+
+  if (fresh) {
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DISK_TREE_MAGIC, 8);
+    header.version = DISK_TREE_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.hashMode = SPLAY_HASH_MODE;
+    // nothing to lose yet
+    header.clean = 1;
+    header.root = NULL_REF;
+    header.freeList = NULL_REF;
+    header.next = {1, 0};
+    return true;
+  }
+
+  if (memcmp(header.magic, DISK_TREE_MAGIC, 8) != 0
+      || header.version != DISK_TREE_VERSION
+      || header.byteOrder != BYTE_ORDER_MARK
+      || header.hashMode != SPLAY_HASH_MODE
+      || header.clean != 1) {
+    pool.close();
+    memset(&header, 0, sizeof(header));
+    return false;
+  }
+  return true;
+}
+
+void DiskSplayTree::writeHeader() {
+  char * page = pool.pin(0);
+  memcpy(page, &header, sizeof(header));
+  pool.unpin(0, true);
+}
+
+// the node pages go first, with the flag still
+// clear on disk, then the header that sets it
+bool DiskSplayTree::flush() {
+  if (! pool.isOpen()) return false;
+  if (header.clean) return pool.flush();
+  if (! pool.flush()) return false;
+  header.clean = 1;
+  writeHeader();
+  return pool.flush();
+}
+
+// nothing has been written since the last flush,
+// so page 0 is the only dirty page
+void DiskSplayTree::markDirty() {
+  header.clean = 0;
+  writeHeader();
+  pool.flush();
+}
+
+bool DiskSplayTree::close() {
+  if (! pool.isOpen()) return true;
+  bool ok = flush();
+  ok = pool.close() && ok;
+  memset(&header, 0, sizeof(header));
+  return ok;
+}
+
+DiskNode DiskSplayTree::read(NodeRef r) {
+  assert(! r.isNull());
+  DiskNode n;
+  char * page = pool.pin(r.page);
+  memcpy(&n, page + r.slot * sizeof(DiskNode), sizeof(DiskNode));
+  pool.unpin(r.page, false);
+  return n;
+}
+
+void DiskSplayTree::write(NodeRef r, const DiskNode &n) {
+  assert(! r.isNull());
+  if (header.clean)
+    markDirty();
+  char * page = pool.pin(r.page);
+  memcpy(page + r.slot * sizeof(DiskNode), &n, sizeof(DiskNode));
+  pool.unpin(r.page, true);
+}
+
+// a freed slot if there is one, otherwise
+// the next slot at the end of the file
+NodeRef DiskSplayTree::allocNode(int key) {
+  NodeRef r;
+  if (! header.freeList.isNull()) {
+    r = header.freeList;
+    header.freeList = read(r).left;
+  } else {
+    r = header.next;
+    header.next.slot++;
+    if (header.next.slot == (uint32_t) DISK_NODES_PER_PAGE) {
+      header.next.page++;
+      header.next.slot = 0;
+    }
+  }
+
+  DiskNode n;
+  n.key = key;
+  n.size = 1;
+  n.hash = combineHash(0, 0, key, 0);
+  n.left = n.right = n.parent = NULL_REF;
+  write(r, n);
+  return r;
+}
+
+void DiskSplayTree::freeNode(NodeRef r) {
+  DiskNode n;
+  memset(&n, 0, sizeof(n));
+  n.left = header.freeList;
+  write(r, n);
+  header.freeList = r;
+}
+
+void DiskSplayTree::setParent(NodeRef r, NodeRef p) {
+  DiskNode n = read(r);
+  n.parent = p;
+  write(r, n);
+}
+
+void DiskSplayTree::setLeftChild(NodeRef r, NodeRef c) {
+  DiskNode n = read(r);
+  n.left = c;
+  write(r, n);
+  if (! c.isNull())
+    setParent(c, r);
+}
+
+void DiskSplayTree::setRightChild(NodeRef r, NodeRef c) {
+  DiskNode n = read(r);
+  n.right = c;
+  write(r, n);
+  if (! c.isNull())
+    setParent(c, r);
+}
+
+// same as STNode::updateAugmentations,
+// every count is 1
+void DiskSplayTree::updateAugmentations(NodeRef r) {
+  DiskNode n = read(r);
+  ll ln = 0, lhash = 0, rn = 0, rhash = 0;
+  if (! n.left.isNull()) {
+    DiskNode l = read(n.left);
+    ln = l.size;
+    lhash = l.hash;
+  }
+  if (! n.right.isNull()) {
+    DiskNode rc = read(n.right);
+    rn = rc.size;
+    rhash = rc.hash;
+  }
+  n.size = ln + 1 + rn;
+  n.hash = combineHash(lhash, ln, n.key, rhash);
+  write(r, n);
+}
+
+void DiskSplayTree::updateAugToRoot(NodeRef r) {
+  for (NodeRef cur = r; ! cur.isNull(); cur = parentOf(cur))
+    updateAugmentations(cur);
+}
+
+// STNode::rotate
+void DiskSplayTree::rotate(NodeRef x) {
+  DiskNode xn = read(x);
+  if (xn.parent.isNull()) return;
+
+  NodeRef p = xn.parent;
+  DiskNode pn = read(p);
+  NodeRef gp = pn.parent;
+
+  if (pn.left == x) {
+    setLeftChild(p, xn.right);
+    setRightChild(x, p);
+  } else {
+    setRightChild(p, xn.left);
+    setLeftChild(x, p);
+  }
+
+  if (! gp.isNull()) {
+    DiskNode gn = read(gp);
+    if (gn.left == p)
+      setLeftChild(gp, x);
+    else if (gn.right == p)
+      setRightChild(gp, x);
+  }
+  else
+    setParent(x, NULL_REF);
+
+  updateAugmentations(p);
+  updateAugmentations(x);
+}
+
+// SplayTree::splay, up to the root
+void DiskSplayTree::splay(NodeRef x) {
+  assert(! x.isNull());
+  while (true) {
+    NodeRef p = parentOf(x);
+    if (p.isNull()) break;
+    DiskNode pn = read(p);
+    if (pn.parent.isNull()) {
+      rotate(x);
+      continue;
+    }
+    DiskNode gn = read(pn.parent);
+    bool zigZig = (pn.left == x) == (gn.left == p);
+    if (zigZig) {
+      rotate(p);
+      rotate(x);
+    } else {
+      rotate(x);
+      rotate(x);
+    }
+  }
+  header.root = x;
+}
+
+NodeRef DiskSplayTree::_find(int key) {
+  NodeRef cur = header.root;
+  while (! cur.isNull()) {
+    DiskNode n = read(cur);
+    if (key == n.key) return cur;
+    cur = key < n.key ? n.left : n.right;
+  }
+  return NULL_REF;
+}
+
+// SplayTree::replaceNode
+void DiskSplayTree::replaceNode(NodeRef n, NodeRef m) {
+  assert(! n.isNull());
+  if (header.root == n)
+    header.root = m;
+
+  DiskNode nn = read(n);
+  if (! nn.parent.isNull()) {
+    DiskNode pn = read(nn.parent);
+    if (pn.left == n)
+      setLeftChild(nn.parent, m);
+    else if (pn.right == n)
+      setRightChild(nn.parent, m);
+  }
+
+  if (! m.isNull())
+    setParent(m, nn.parent);
+}
+
+// SplayTree::removeNode. node's own record
+// isn't changed, so one copy of it is enough
+void DiskSplayTree::removeNode(NodeRef node) {
+  DiskNode nn = read(node);
+  NodeRef nodeToSplay = nn.parent;
+
+  if (nn.left.isNull()) {
+    replaceNode(node, nn.right);
+    if (! nn.parent.isNull())
+      updateAugmentations(nn.parent);
+  } else if (nn.right.isNull()) {
+    replaceNode(node, nn.left);
+    if (! nn.parent.isNull())
+      updateAugmentations(nn.parent);
+  }
+  else {
+    NodeRef pred = nn.left;
+    DiskNode predn = read(pred);
+    while (! predn.right.isNull()) {
+      pred = predn.right;
+      predn = read(pred);
+    }
+
+    if (predn.parent == node) {
+      nodeToSplay = pred;
+      replaceNode(node, pred);
+      setRightChild(pred, nn.right);
+      updateAugToRoot(pred);
+    }
+    else {
+      NodeRef originalPredParent = predn.parent;
+      NodeRef originalPredChild = predn.left;
+      nodeToSplay = originalPredParent;
+
+      replaceNode(node, pred);
+      setLeftChild(pred, nn.left);
+      setRightChild(pred, nn.right);
+      setRightChild(originalPredParent, originalPredChild);
+      updateAugToRoot(originalPredParent);
+    }
+  }
+
+  if (! nodeToSplay.isNull())
+    splay(nodeToSplay);
+}
+
+bool DiskSplayTree::find(int key) {
+  NodeRef n = _find(key);
+  if (n.isNull()) return false;
+  splay(n);
+  return true;
+}
+
+// precondition: key is absent. there are no
+// counts, and a second node with the same key
+// would break the search order
+void DiskSplayTree::insert(int key) {
+  assert(_find(key).isNull());
+
+  NodeRef n = allocNode(key);
+  if (header.root.isNull()) {
+    header.root = n;
+    return;
+  }
+
+  NodeRef cur = header.root;
+  while (true) {
+    DiskNode c = read(cur);
+    NodeRef next = key < c.key ? c.left : c.right;
+    if (next.isNull()) {
+      if (key < c.key)
+        setLeftChild(cur, n);
+      else
+        setRightChild(cur, n);
+      break;
+    }
+    cur = next;
+  }
+
+  updateAugToRoot(cur);
+  splay(n);
+}
+
+void DiskSplayTree::remove(int key) {
+  NodeRef n = _find(key);
+  if (n.isNull()) return;
+  removeNode(n);
+  freeNode(n);
+}
+
+// SplayTree::rank
+int DiskSplayTree::rank(int key) {
+  int r = 0;
+  NodeRef last = NULL_REF;
+  NodeRef cur = header.root;
+  while (! cur.isNull()) {
+    last = cur;
+    DiskNode n = read(cur);
+    if (key <= n.key)
+      cur = n.left;
+    else {
+      r += 1;
+      if (! n.left.isNull())
+        r += read(n.left).size;
+      cur = n.right;
+    }
+  }
+
+  if (! last.isNull())
+    splay(last);
+  return r;
+}
+
+// SplayTree::select
+bool DiskSplayTree::select(int i, int &key) {
+  if (i < 0 || i >= getSize()) return false;
+
+  NodeRef cur = header.root;
+  while (true) {
+    DiskNode n = read(cur);
+    int lsize = n.left.isNull() ? 0 : read(n.left).size;
+    if (i < lsize)
+      cur = n.left;
+    else if (i == lsize) {
+      key = n.key;
+      break;
+    }
+    else {
+      i -= lsize + 1;
+      cur = n.right;
+    }
+  }
+
+  splay(cur);
+  return true;
+}
+
+int DiskSplayTree::getSize() {
+  return header.root.isNull() ? 0 : read(header.root).size;
+}
+
+ll DiskSplayTree::getHash() {
+  return header.root.isNull() ? 0 : read(header.root).hash;
+}
+
+int DiskSplayTree::rootKey() {
+  return read(header.root).key;
+}
+
+// iterative, the tree can be deeper than the stack
+void DiskSplayTree::getInorder(std::vector<int> &v) {
+  std::vector<NodeRef> stack;
+  NodeRef cur = header.root;
+  while (! cur.isNull() || ! stack.empty()) {
+    while (! cur.isNull()) {
+      stack.push_back(cur);
+      cur = read(cur).left;
+    }
+    DiskNode n = read(stack.back());
+    stack.pop_back();
+    v.push_back(n.key);
+    cur = n.right;
+  }
+}
@@ -0,0 +1,160 @@
+#ifndef DISK_SPLAY_H
+#define DISK_SPLAY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "buffer-pool.h"
+#include "splay.h"
+
+// a splay tree whose nodes live in a page file
+// instead of on the heap, for trees that don't
+// fit in memory.
+//
+// nodes are addressed by (page, slot) and read
+// and written through a BufferPool of a fixed
+// number of frames (see buffer-pool.h). since
+// every operation starts at the root and splays
+// the accessed node up to it, the pages holding
+// the upper levels are touched all the time and
+// stay resident, and a skewed workload mostly
+// runs from memory.
+//
+// the operations are the same as SplayTree's,
+// step for step: the same sequence of operations
+// gives the same shape and the same hash (of the
+// inorder keys) as an in-memory SplayTree. there
+// are no multiset counts, and reads that would
+// return a node return its key instead.
+//
+// file layout: page 0 holds a DiskTreeHeader,
+// pages 1.. hold DISK_NODES_PER_PAGE nodes each.
+// freed slots are chained through their left
+// refs and reused before the file grows.
+//
+// dirty pages are written back whenever they are
+// evicted, but the header (root, free list) only
+// by flush(). so between flushes the file mixes
+// old and new nodes, and a crash there leaves it
+// corrupt. to make that detectable, the header
+// has a clean flag: the first change after a
+// flush clears it on disk (with an fsync) before
+// any node page can be written back, and flush()
+// sets it again after every page is on disk.
+// open() rejects a file whose flag is clear.
+
+struct NodeRef {
+  uint32_t page;
+  uint32_t slot;
+
+  bool isNull() const { return page == 0; }
+  bool operator==(const NodeRef &o) const { return page == o.page && slot == o.slot; }
+  bool operator!=(const NodeRef &o) const { return ! (*this == o); }
+};
+
+// page 0 is the header, so (0, 0) is free
+// to mean "no node"
+const NodeRef NULL_REF = {0, 0};
+
+struct DiskNode {
+  int32_t key;
+  int32_t size;
+  uint64_t hash;
+  NodeRef left;
+  NodeRef right;
+  NodeRef parent;
+};
+
+const int DISK_NODES_PER_PAGE = POOL_PAGE_SIZE / sizeof(DiskNode);
+
+const char DISK_TREE_MAGIC[8] = {'S','P','L','A','Y','D','S','K'};
+const uint32_t DISK_TREE_VERSION = 2;
+
+struct DiskTreeHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  // SPLAY_HASH_MODE of the writer (see splay.h)
+  uint32_t hashMode;
+  // 1 if the file was flushed after its last
+  // change, 0 while pages may be half written
+  uint32_t clean;
+  NodeRef root;
+  // head of the chain of freed slots
+  NodeRef freeList;
+  // first slot that was never used
+  NodeRef next;
+};
+
+class DiskSplayTree {
+  private:
+    BufferPool pool;
+    DiskTreeHeader header;
+
+    // copy a node out of / into its page
+    DiskNode read(NodeRef r);
+    void write(NodeRef r, const DiskNode &n);
+    // clear the clean flag on disk before the
+    // first write since the last flush
+    void markDirty();
+    void writeHeader();
+
+    NodeRef allocNode(int key);
+    void freeNode(NodeRef r);
+
+    NodeRef parentOf(NodeRef r) { return read(r).parent; }
+    void setParent(NodeRef r, NodeRef p);
+    void setLeftChild(NodeRef r, NodeRef c);
+    void setRightChild(NodeRef r, NodeRef c);
+    // size and hash of r from its children
+    void updateAugmentations(NodeRef r);
+    void updateAugToRoot(NodeRef r);
+
+    // as in SplayTree
+    void rotate(NodeRef x);
+    void splay(NodeRef x);
+    NodeRef _find(int key);
+    void replaceNode(NodeRef n, NodeRef m);
+    void removeNode(NodeRef node);
+
+  public:
+    DiskSplayTree();
+    ~DiskSplayTree();
+
+    // open the tree in path, or start an empty one
+    // if the file is new or empty, with numFrames
+    // pages of memory. false if the file can't be
+    // opened, isn't a tree file, was written with
+    // another hash (see SPLAY_HASH_MODE), or was
+    // changed and not flushed before a crash
+    bool open(const std::string &path, int numFrames = 1024);
+    // flush and close. false on any I/O error
+    bool close();
+    // write every change to the file and mark
+    // it clean. false on any I/O error since open
+    bool flush();
+    bool isOpen() const { return pool.isOpen(); }
+
+    bool find(int key);
+    // precondition: key is absent (as in SplayTree)
+    void insert(int key);
+    void remove(int key);
+
+    // number of keys < key. splays
+    int rank(int key);
+    // i-th smallest key (0-indexed) into key, false
+    // if i is out of range. splays
+    bool select(int i, int &key);
+
+    int getSize();
+    ll getHash();
+    void getInorder(std::vector<int> &v);
+    // precondition: tree is not empty
+    int rootKey();
+
+    // pages in the file, including the header
+    long long numPages() const { return header.next.page + (header.next.slot > 0); }
+    BufferPoolStats getPoolStats() const { return pool.getStats(); }
+};
+
+#endif
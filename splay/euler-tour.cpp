@@ -0,0 +1,197 @@
+#include <cassert>
+#include "euler-tour.h"
+
+EulerTourForest::EulerTourForest(int n) {
+  for (int i = 0; i < n; i++)
+    addVertex();
+}
+
+// nodes only point at each other through 
+// the tours, so each is unlinked and deleted 
+// on its own (see STNode::~STNode) 
+EulerTourForest::~EulerTourForest() {
+  for (STNode * x : vertices) {
+    x->left = x->right = nullptr;
+    delete x;
+  }
+  for (auto &e : edges) {
+    e.second->left = e.second->right = nullptr;
+    delete e.second;
+  }
+}
+
+int EulerTourForest::addVertex(int value) {
+  STNode * x = new STNode(vertices.size());
+  x->count = x->weight = value;
+  vertices.push_back(x);
+  return vertices.size() - 1;
+}
+
+STNode * EulerTourForest::edgeNode(int u, int v) {
+  auto it = edges.find(edgeKey(u, v));
+  return it == edges.end() ? nullptr : it->second;
+}
+
+// SplayTree::splay without a tree: every 
+// sequence is its own splay tree 
+void EulerTourForest::splay(STNode * x) {
+  while (x->hasParent()) {
+    if (! x->hasGrandP())
+      x->rotate();
+    else if (x->zigZig()) {
+      x->parent->rotate();
+      x->rotate();
+    }
+    else {
+      x->rotate();
+      x->rotate();
+    }
+  }
+}
+
+STNode * EulerTourForest::splitBefore(STNode * x) {
+  splay(x);
+  STNode * l = x->left;
+  if (l != nullptr) {
+    l->parent = nullptr;
+    x->left = nullptr;
+    x->updateAugmentations();
+  }
+  return l;
+}
+
+STNode * EulerTourForest::splitAfter(STNode * x) {
+  splay(x);
+  STNode * r = x->right;
+  if (r != nullptr) {
+    r->parent = nullptr;
+    x->right = nullptr;
+    x->updateAugmentations();
+  }
+  return r;
+}
+
+// precondition: a and b are roots of 
+// different sequences 
+STNode * EulerTourForest::join(STNode * a, STNode * b) {
+  if (a == nullptr) return b;
+  if (b == nullptr) return a;
+  // not maximumLeaf, which recurses, and 
+  // a sequence can be as deep as it is long 
+  STNode * last = a;
+  while (last->hasRightChild())
+    last = last->right;
+  splay(last);
+  last->setRightChild(b);
+  last->updateAugmentations();
+  return last;
+}
+
+// the tour is a cycle, so any rotation of it 
+// is the tour of the same tree, rooted at the 
+// vertex it starts with 
+void EulerTourForest::reroot(int v) {
+  STNode * x = vertices[v];
+  STNode * before = splitBefore(x);
+  join(x, before);
+}
+
+int EulerTourForest::getValue(int v) {
+  return vertices[v]->count;
+}
+
+// x's value is in the aggregates of 
+// its ancestors only, so splay it first 
+void EulerTourForest::setValue(int v, int value) {
+  STNode * x = vertices[v];
+  splay(x);
+  x->count = value;
+  x->updateAugmentations();
+}
+
+// with both tours rerooted at their endpoints, 
+// the new tour is 
+//   tour(v) (v,u) tour(u) (u,v) 
+bool EulerTourForest::link(int u, int v) {
+  if (connected(u, v)) return false;
+  reroot(u);
+  reroot(v);
+
+  STNode * vu = new STNode(v);
+  STNode * uv = new STNode(u);
+  vu->count = vu->weight = 0;
+  uv->count = uv->weight = 0;
+  edges[edgeKey(v, u)] = vu;
+  edges[edgeKey(u, v)] = uv;
+
+  STNode * tu = vertices[u];
+  STNode * tv = vertices[v];
+  splay(tu);
+  splay(tv);
+  join(join(join(tv, vu), tu), uv);
+  return true;
+}
+
+// rooted at u, the tour is 
+//   a (u,v) b (v,u) c 
+// where b is the tour of v's side and a c 
+// is the tour of u's side 
+bool EulerTourForest::cut(int u, int v) {
+  STNode * uv = edgeNode(u, v);
+  STNode * vu = edgeNode(v, u);
+  if (uv == nullptr) return false;
+  assert(vu != nullptr);
+
+  reroot(u);
+  STNode * a = splitBefore(uv);
+  splitAfter(uv);
+  splitBefore(vu);
+  STNode * c = splitAfter(vu);
+  join(a, c);
+
+  edges.erase(edgeKey(u, v));
+  edges.erase(edgeKey(v, u));
+  delete uv;
+  delete vu;
+  return true;
+}
+
+// after splaying v, u is still the root 
+// of its sequence iff it's in another one 
+bool EulerTourForest::connected(int u, int v) {
+  if (u == v) return true;
+  STNode * x = vertices[u];
+  splay(x);
+  splay(vertices[v]);
+  return x->hasParent();
+}
+
+// k vertices and k - 1 edges 
+// make 3k - 2 nodes 
+int EulerTourForest::componentSize(int v) {
+  STNode * x = vertices[v];
+  splay(x);
+  return (x->size + 2) / 3;
+}
+
+int EulerTourForest::componentSum(int v) {
+  STNode * x = vertices[v];
+  splay(x);
+  return x->weight;
+}
+
+// rooted at p, v's subtree is the part of the 
+// tour between (p,v) and (v,p), so its sum is 
+// the difference of their prefix sums 
+int EulerTourForest::subtreeSum(int v, int p) {
+  STNode * pv = edgeNode(p, v);
+  STNode * vp = edgeNode(v, p);
+  assert(pv != nullptr && vp != nullptr);
+
+  reroot(p);
+  splay(pv);
+  int before = pv->hasLeftChild() ? pv->left->weight : 0;
+  splay(vp);
+  int through = vp->hasLeftChild() ? vp->left->weight : 0;
+  return through - before;
+}
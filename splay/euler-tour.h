@@ -0,0 +1,83 @@
+#ifndef EULER_TOUR_H
+#define EULER_TOUR_H
+
+#include <unordered_map>
+#include <vector>
+#include "splay.h"
+
+// euler-tour trees (Henzinger and King): a forest
+// over vertices 0..n-1 with edges added and removed
+// at any time, and connectivity, component size and
+// subtree sum queries, all in O(log n) amortized.
+//
+// each tree is stored as its euler tour, the
+// sequence of a walk around the tree that crosses
+// every edge once each way. the tour holds one
+// occurrence node per vertex, and one node per
+// direction of each edge:
+//
+//   (a) (a,b) (b) (b,c) (c) (c,b) (b,a)
+//
+// is the tour of the path a - b - c, rooted at a.
+// the sequence is kept in a splay tree of STNodes
+// ordered by position (keys are not used for
+// order), so rerooting, linking and cutting are a
+// few splits and joins of sequences.
+//
+// the STNode augmentations give the aggregates:
+// size counts nodes, so a component of k vertices
+// has 3k - 2 of them, and each vertex's value is
+// the count of its occurrence node (edges count
+// 0), so weight is the sum of values.
+
+class EulerTourForest {
+  private:
+    // occurrence node of each vertex
+    std::vector<STNode*> vertices;
+    // node of each edge direction (u, v)
+    std::unordered_map<long long, STNode*> edges;
+
+    long long edgeKey(int u, int v) const { return ((long long) u << 32) | (unsigned) v; }
+    STNode * edgeNode(int u, int v);
+
+    // splay x to the root of its sequence
+    static void splay(STNode * x);
+    // cut off and return everything before / after
+    // x in its sequence, leaving x the root of the
+    // rest
+    static STNode * splitBefore(STNode * x);
+    static STNode * splitAfter(STNode * x);
+    // a then b, either may be null
+    static STNode * join(STNode * a, STNode * b);
+    // rotate v's tour to start at v
+    void reroot(int v);
+
+  public:
+    // n single-vertex trees with value 0
+    EulerTourForest(int n = 0);
+    ~EulerTourForest();
+
+    int addVertex(int value = 0);
+    int numVertices() const { return vertices.size(); }
+
+    int getValue(int v);
+    void setValue(int v, int value);
+
+    // add edge u-v. false if u and v are already
+    // connected (the edge would close a cycle)
+    bool link(int u, int v);
+    // remove edge u-v. false if there is none
+    bool cut(int u, int v);
+
+    bool connected(int u, int v);
+    // vertices in v's tree
+    int componentSize(int v);
+    // sum of values in v's tree
+    int componentSum(int v);
+    // sum of values on v's side of edge v-p,
+    // i.e. of the subtree of v when the tree is
+    // rooted at p. precondition: edge v-p exists
+    int subtreeSum(int v, int p);
+};
+
+#endif
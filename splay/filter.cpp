@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include "filter.h"
+
+// counters per block, and bits to address one
+const int BLOCK_COUNTERS = 128;
+const int POSITION_BITS = 7;
+const int MAX_HASHES = 64 / POSITION_BITS;
+const uint64_t COUNTER_MAX = 15;
+
+// murmur3's 64-bit finalizer
+static uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// the usual sizing for a Bloom filter:
+// m = -n ln p / (ln 2)^2 counters and
+// k = m/n ln 2 hashes
+KeyFilter::KeyFilter(long long cap, double p)
+  : numHashes(1),
+    keys(0),
+    capacity(std::max(1LL, cap)),
+    fpRate(std::min(std::max(p, 1e-9), 0.5)),
+    lookups(0),
+    definiteMisses(0),
+    falsePositives(0),
+    rebuilds(0) {
+  double ln2 = std::log(2.0);
+  double counters = -capacity * std::log(fpRate) / (ln2 * ln2);
+  size_t numBlocks = (size_t) std::ceil(counters / BLOCK_COUNTERS);
+  blocks.resize(std::max<size_t>(1, numBlocks));
+
+  int k = (int) std::lround(counters / capacity * ln2);
+  numHashes = std::min(std::max(k, 1), MAX_HASHES);
+  clear();
+}
+
+void KeyFilter::clear() {
+  memset(blocks.data(), 0, blocks.size() * sizeof(Block));
+  keys = 0;
+}
+
+// the high half of one hash picks the block
+// (multiply-shift instead of a modulo), a
+// second hash gives the counter positions
+void KeyFilter::locate(int key, size_t &block, uint64_t &positions) const {
+  uint64_t h = mix((uint32_t) key);
+  block = (size_t) (((h >> 32) * (uint64_t) blocks.size()) >> 32);
+  positions = mix(h ^ 0x9e3779b97f4a7c15ULL);
+}
+
+void KeyFilter::add(int key) {
+  size_t b;
+  uint64_t pos;
+  locate(key, b, pos);
+  uint64_t * words = blocks[b].words;
+  for (int i = 0; i < numHashes; i++, pos >>= POSITION_BITS) {
+    int c = pos & (BLOCK_COUNTERS - 1);
+    int shift = (c & 15) * 4;
+    if (((words[c >> 4] >> shift) & COUNTER_MAX) < COUNTER_MAX)
+      words[c >> 4] += 1ULL << shift;
+  }
+  keys++;
+}
+
+// saturated counters are left alone, they
+// may be holding up other keys too
+void KeyFilter::remove(int key) {
+  size_t b;
+  uint64_t pos;
+  locate(key, b, pos);
+  uint64_t * words = blocks[b].words;
+  for (int i = 0; i < numHashes; i++, pos >>= POSITION_BITS) {
+    int c = pos & (BLOCK_COUNTERS - 1);
+    int shift = (c & 15) * 4;
+    uint64_t v = (words[c >> 4] >> shift) & COUNTER_MAX;
+    assert(v > 0);
+    if (v < COUNTER_MAX)
+      words[c >> 4] -= 1ULL << shift;
+  }
+  keys--;
+}
+
+bool KeyFilter::mayContain(int key) const {
+  size_t b;
+  uint64_t pos;
+  locate(key, b, pos);
+  const uint64_t * words = blocks[b].words;
+  for (int i = 0; i < numHashes; i++, pos >>= POSITION_BITS) {
+    int c = pos & (BLOCK_COUNTERS - 1);
+    if (((words[c >> 4] >> ((c & 15) * 4)) & COUNTER_MAX) == 0)
+      return false;
+  }
+  return true;
+}
+
+FilterStats KeyFilter::getStats() const {
+  FilterStats s;
+  s.keys = keys;
+  s.capacity = capacity;
+  s.hashes = numHashes;
+  s.targetFpRate = fpRate;
+  s.memoryBytes = blocks.size() * sizeof(Block);
+  s.lookups = lookups;
+  s.definiteMisses = definiteMisses;
+  s.falsePositives = falsePositives;
+  s.rebuilds = rebuilds;
+  return s;
+}
@@ -0,0 +1,97 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <cstdint>
+#include <vector>
+
+// compact membership filter over the keys of a
+// SplayTree (see SplayTree::enableFilter), so that
+// lookups of absent keys can return without
+// descending the tree.
+//
+// it is a blocked counting Bloom filter: a key's
+// hashes all fall into one 64-byte block of 128
+// 4-bit counters, so a query touches a single
+// cache line. counters (rather than bits) allow
+// removals. a counter that reaches 15 stays there,
+// which can only cause false positives, never
+// false negatives.
+//
+// mayContain(k) is false only if k was never
+// added (or was removed again). confining the
+// hashes to one block costs a little accuracy, so
+// the observed false positive rate is somewhat
+// above the target, mostly at low targets.
+
+struct FilterStats {
+  long long keys;
+  long long capacity;
+  int hashes;
+  double targetFpRate;
+  size_t memoryBytes;
+
+  // lookups that consulted the filter, the ones it
+  // answered alone, and the ones it let through
+  // for a key that then wasn't in the tree
+  long long lookups;
+  long long definiteMisses;
+  long long falsePositives;
+
+  // times the filter was rebuilt larger after
+  // the tree outgrew its capacity
+  long long rebuilds;
+
+  // false positives among lookups of absent keys
+  double observedFpRate() const {
+    long long misses = definiteMisses + falsePositives;
+    return misses == 0 ? 0 : (double) falsePositives / misses;
+  }
+};
+
+class KeyFilter {
+  private:
+    struct alignas(64) Block {
+      uint64_t words[8];
+    };
+
+    std::vector<Block> blocks;
+    int numHashes;
+    long long keys;
+    long long capacity;
+    double fpRate;
+
+    // block index and the 7-bit counter
+    // positions (one per hash) of key
+    void locate(int key, size_t &block, uint64_t &positions) const;
+
+  public:
+    // counters for the stats, kept by the tree
+    long long lookups;
+    long long definiteMisses;
+    long long falsePositives;
+    long long rebuilds;
+
+    // sized for capacity keys at a false
+    // positive rate of about fpRate
+    KeyFilter(long long capacity, double fpRate);
+
+    void add(int key);
+    // precondition: key was added
+    void remove(int key);
+    bool mayContain(int key) const;
+
+    // forget all keys (the stats are kept)
+    void clear();
+
+    long long size() const { return keys; }
+    long long getCapacity() const { return capacity; }
+    double getFpRate() const { return fpRate; }
+
+    // above twice the capacity the false positive
+    // rate is far off target
+    bool overfull() const { return keys > 2 * capacity; }
+
+    FilterStats getStats() const;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include <cassert>
+#include <iterator>
+#include <new>
+#include <utility>
+#include "forest.h"
+
+NodeArena::NodeArena(int slabSlots)
+  : freeList(nullptr),
+    freeListSize(0),
+    bump(nullptr),
+    bumpLeft(0),
+    slabSlots(slabSlots),
+    liveSlots(0) {
+  assert(slabSlots > 0);
+}
+
+NodeArena::~NodeArena() {
+  for (auto &s : slabs)
+    ::operator delete(s.first);
+}
+
+char * NodeArena::newSlab(int slots) {
+  char * mem = (char *) ::operator new((size_t) slots * SLOT_BYTES);
+  slabs[mem] = slots;
+  return mem;
+}
+
+void * NodeArena::allocate() {
+  liveSlots++;
+  if (freeList != nullptr) {
+    void * p = freeList;
+    freeList = *(void **) p;
+    freeListSize--;
+    return p;
+  }
+  if (bumpLeft == 0) {
+    bump = newSlab(slabSlots);
+    bumpLeft = slabSlots;
+  }
+  void * p = bump;
+  bump += SLOT_BYTES;
+  bumpLeft--;
+  return p;
+}
+
+void NodeArena::release(void * p) {
+  liveSlots--;
+  *(void **) p = freeList;
+  freeList = p;
+  freeListSize++;
+}
+
+void * NodeArena::allocateRun(int n) {
+  assert(n > 0);
+  liveSlots += n;
+  if (n <= bumpLeft) {
+    void * p = bump;
+    bump += (size_t) n * SLOT_BYTES;
+    bumpLeft -= n;
+    return p;
+  }
+  // the newest slab keeps its tail for allocate
+  return newSlab(n);
+}
+
+// count the free slots of each slab, then drop
+// the slabs whose slots are all free and relink
+// the free list without their slots
+long long NodeArena::trim() {
+  std::map<char *, int> freeCount;
+  for (auto &s : slabs)
+    freeCount[s.first] = 0;
+  // find the slab holding slot p
+  auto slabOf = [&](void * p) {
+    auto it = slabs.upper_bound((char *) p);
+    assert(it != slabs.begin());
+    return std::prev(it)->first;
+  };
+
+  for (void * p = freeList; p != nullptr; p = *(void **) p)
+    freeCount[slabOf(p)]++;
+  char * bumpSlab = bumpLeft > 0 ? slabOf(bump) : nullptr;
+  if (bumpSlab != nullptr)
+    freeCount[bumpSlab] += bumpLeft;
+
+  long long freed = 0;
+  for (auto &f : freeCount) {
+    int slots = slabs[f.first];
+    if (f.second < slots) continue;
+    if (f.first == bumpSlab) {
+      bump = nullptr;
+      bumpLeft = 0;
+    }
+    slabs.erase(f.first);
+    freed += (long long) slots * SLOT_BYTES;
+  }
+  if (freed == 0) return 0;
+
+  // slabs were erased before being deleted, so
+  // a slot is kept iff its slab is still there
+  void * kept = nullptr;
+  long long keptSize = 0;
+  void * p = freeList;
+  while (p != nullptr) {
+    void * next = *(void **) p;
+    auto it = slabs.upper_bound((char *) p);
+    bool live = it != slabs.begin()
+      && (char *) p < std::prev(it)->first + (size_t) std::prev(it)->second * SLOT_BYTES;
+    if (live) {
+      *(void **) p = kept;
+      kept = p;
+      keptSize++;
+    }
+    p = next;
+  }
+  freeList = kept;
+  freeListSize = keptSize;
+
+  for (auto &f : freeCount)
+    if (slabs.find(f.first) == slabs.end())
+      ::operator delete(f.first);
+  return freed;
+}
+
+ArenaStats NodeArena::getStats() const {
+  ArenaStats s;
+  s.slabs = slabs.size();
+  s.liveSlots = liveSlots;
+  s.freeSlots = freeListSize + bumpLeft;
+  s.reservedBytes = 0;
+  for (auto &slab : slabs)
+    s.reservedBytes += (long long) slab.second * SLOT_BYTES;
+  return s;
+}
+
+SplayForest::SplayForest(int slabNodes)
+  : arena(slabNodes),
+    numTrees(0) { }
+
+SplayForest::Entry & SplayForest::entry(int id) {
+  assert(hasTree(id));
+  return entries[id];
+}
+
+bool SplayForest::hasTree(int id) const {
+  return id >= 0 && id < (int) entries.size() && entries[id].tree != nullptr;
+}
+
+int SplayForest::createTree(long long quotaBytes) {
+  int id;
+  if (! freeIds.empty()) {
+    id = freeIds.back();
+    freeIds.pop_back();
+  } else {
+    id = entries.size();
+    entries.emplace_back(&arena);
+  }
+  Entry &e = entries[id];
+  e.quotaBytes = quotaBytes;
+  e.tree.reset(new SplayTree(&e.allocator));
+  numTrees++;
+  return id;
+}
+
+void SplayForest::dropTree(int id) {
+  Entry &e = entry(id);
+  // nodes in NodeHandles extracted from the tree
+  // stay counted until the handles release them
+  e.tree.reset();
+  freeIds.push_back(id);
+  numTrees--;
+}
+
+bool SplayForest::insert(int id, int key) {
+  Entry &e = entry(id);
+  if (e.quotaBytes > 0
+      && (e.allocator.nodes + 1) * (long long) NodeArena::SLOT_BYTES > e.quotaBytes)
+    return false;
+  if (e.tree->find(key) != nullptr) return false;
+  e.tree->insert(key);
+  return true;
+}
+
+// iterative, the tree can be a path
+TreeMemoryStats SplayForest::getTreeStats(int id) {
+  Entry &e = entry(id);
+  TreeMemoryStats s;
+  s.nodes = e.allocator.nodes;
+  s.bytes = s.nodes * NodeArena::SLOT_BYTES;
+  s.quotaBytes = e.quotaBytes;
+  s.maxDepth = -1;
+  s.avgDepth = 0;
+
+  long long total = 0, count = 0;
+  std::vector<std::pair<STNode *, int> > stack;
+  if (e.tree->root != nullptr)
+    stack.push_back({e.tree->root, 0});
+  while (! stack.empty()) {
+    STNode * n = stack.back().first;
+    int d = stack.back().second;
+    stack.pop_back();
+    if (d > s.maxDepth) s.maxDepth = d;
+    total += d;
+    count++;
+    if (n->hasLeftChild()) stack.push_back({n->left, d + 1});
+    if (n->hasRightChild()) stack.push_back({n->right, d + 1});
+  }
+  if (count > 0)
+    s.avgDepth = (double) total / count;
+  return s;
+}
+
+ForestStats SplayForest::getStats() const {
+  ForestStats s;
+  s.trees = numTrees;
+  s.arena = arena.getStats();
+  s.nodes = 0;
+  for (const Entry &e : entries)
+    s.nodes += e.allocator.nodes;
+  s.bytes = s.nodes * NodeArena::SLOT_BYTES;
+  return s;
+}
+
+bool SplayForest::compact(int id) {
+  return entry(id).tree->compact();
+}
+
+long long SplayForest::defragment() {
+  for (int id = 0; id < (int) entries.size(); id++)
+    if (hasTree(id))
+      compact(id);
+  return arena.trim();
+}
@@ -0,0 +1,186 @@
+#ifndef FOREST_H
+#define FOREST_H
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+#include "splay.h"
+
+// many splay trees sharing one node arena, with
+// per-tree memory accounting and quotas.
+//
+// a NodeArena hands out STNode-sized slots from
+// large slabs, and keeps released slots on a free
+// list for reuse, so a million small trees cost a
+// few thousand allocations instead of one per node.
+// each tree of a SplayForest gets a TreeAllocator
+// (see NodeAllocator in splay.h) that counts its
+// nodes and passes the slots through to the arena.
+//
+// compact(id) moves a tree's nodes into one
+// contiguous run (see SplayTree::compact). the
+// slots it leaves behind go on the free list, and
+// trim() gives slabs that are entirely free back
+// to the system, so defragment() = compact every
+// tree, then trim.
+
+struct ArenaStats {
+  int slabs;
+  // slots in use and free (including slots of
+  // the newest slab that were never handed out)
+  long long liveSlots;
+  long long freeSlots;
+  long long reservedBytes;
+};
+
+class NodeArena {
+  private:
+    // slab start -> number of slots
+    std::map<char *, int> slabs;
+    // released slots, linked through their
+    // first bytes
+    void * freeList;
+    long long freeListSize;
+    // unused tail of the newest slab
+    char * bump;
+    int bumpLeft;
+    int slabSlots;
+    long long liveSlots;
+
+    char * newSlab(int slots);
+
+  public:
+    static const size_t SLOT_BYTES = sizeof(STNode);
+
+    // slabs of slabSlots slots
+    NodeArena(int slabSlots = 1024);
+    ~NodeArena();
+
+    NodeArena(const NodeArena &) = delete;
+    NodeArena & operator=(const NodeArena &) = delete;
+
+    void * allocate();
+    void release(void * p);
+    // n contiguous slots, from the newest slab if
+    // they fit and from a slab of their own if not
+    void * allocateRun(int n);
+
+    // free every slab with no live slots.
+    // returns the number of bytes freed
+    long long trim();
+
+    ArenaStats getStats() const;
+};
+
+// a tree's view of the arena: counts its nodes
+class TreeAllocator : public NodeAllocator {
+  private:
+    NodeArena * arena;
+
+  public:
+    long long nodes;
+
+    TreeAllocator(NodeArena * arena) : arena(arena), nodes(0) { }
+
+    void * allocate() {
+      nodes++;
+      return arena->allocate();
+    }
+
+    void release(void * p) {
+      nodes--;
+      arena->release(p);
+    }
+
+    void * allocateRun(int n) {
+      nodes += n;
+      return arena->allocateRun(n);
+    }
+};
+
+struct TreeMemoryStats {
+  long long nodes;
+  long long bytes;
+  // 0 if the tree has no quota
+  long long quotaBytes;
+  // root at depth 0, -1 for an empty tree
+  int maxDepth;
+  double avgDepth;
+};
+
+struct ForestStats {
+  int trees;
+  long long nodes;
+  // bytes of the trees' nodes
+  long long bytes;
+  ArenaStats arena;
+
+  // fraction of the reserved memory
+  // holding live nodes
+  double utilization() const {
+    return arena.reservedBytes == 0 ? 0 : (double) bytes / arena.reservedBytes;
+  }
+};
+
+class SplayForest {
+  private:
+    struct Entry {
+      TreeAllocator allocator;
+      std::unique_ptr<SplayTree> tree;
+      long long quotaBytes;
+
+      Entry(NodeArena * arena) : allocator(arena), quotaBytes(0) { }
+    };
+
+    // declared first so it outlives the trees
+    NodeArena arena;
+    // deque, so entries (and the allocators
+    // the trees point at) don't move
+    std::deque<Entry> entries;
+    // ids of dropped trees, reused first
+    std::vector<int> freeIds;
+    int numTrees;
+
+    Entry & entry(int id);
+
+  public:
+    SplayForest(int slabNodes = 1024);
+
+    // a new empty tree with a quota on the bytes
+    // of its nodes (0 for none). returns its id
+    int createTree(long long quotaBytes = 0);
+    // delete the tree and release its nodes.
+    // the id may be reused by createTree
+    void dropTree(int id);
+    bool hasTree(int id) const;
+    int getNumTrees() const { return numTrees; }
+
+    // the tree itself, for everything but quota
+    // checked inserts. nodes it allocates are
+    // counted, but only insert below is refused
+    // at the quota
+    SplayTree & tree(int id) { return *entry(id).tree; }
+
+    // insert key into tree id. false if the key
+    // is present or the node would go over the
+    // tree's quota
+    bool insert(int id, int key);
+
+    void setQuota(int id, long long quotaBytes) { entry(id).quotaBytes = quotaBytes; }
+
+    // nodes and bytes are O(1), the depths walk
+    // the tree
+    TreeMemoryStats getTreeStats(int id);
+    ForestStats getStats() const;
+
+    // move tree id's nodes into one contiguous run
+    // (see SplayTree::compact)
+    bool compact(int id);
+    // compact every tree, then free the slabs
+    // that were left empty. returns bytes freed
+    long long defragment();
+    long long trim() { return arena.trim(); }
+};
+
+#endif
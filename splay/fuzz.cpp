@@ -0,0 +1,172 @@
+// multithreaded differential stress test: every
+// worker runs its own random operation sequence
+// on its own SplayTree and checks it against
+// a multiset reference (see stress.h)
+//
+// usage: ./fuzz [-t threads] [-n ops] [-s seed] [-k key ranges]
+//               [-v validate every] [-d seconds] [-w worker]
+//
+//   -t  worker threads (default one per core)
+//   -n  operations per worker, e.g. 1e9 (default 1e7)
+//   -s  seed (default random, and printed)
+//   -k  comma separated key ranges, worker w uses
+//       the (w mod count)-th one (default 64,4096,1e6,
+//       so some trees are dense and some sparse)
+//   -v  full validation every this many operations
+//       (default 100000)
+//   -d  stop after this many seconds, however far
+//       the workers got
+//   -w  run only this worker, e.g. to repeat a failure
+//
+// odd-numbered workers run their trees with a
+// membership filter (see SplayTree::enableFilter),
+// workers 2, 3, 6, 7, ... with a hot-key cache
+// (see SplayTree::enableHotCache), and workers
+// 4-7 of every 8 with frozen, periodically rebuilt
+// trees (see SplayTree::rebuildOptimal).
+//
+// each worker's seed comes from the seed and its
+// number, so a failure is reproduced by the command
+// printed with it. the exit code is 1 on any failure.
+//
+// built with optimization but with asserts, and
+// FUZZFLAGS adds sanitizers, e.g.
+//   make fuzz FUZZFLAGS="-O1 -g -fsanitize=address,undefined"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "stress.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+static void usage(const char * prog) {
+  fprintf(stderr, "usage: %s [-t threads] [-n ops] [-s seed] [-k key ranges] "
+                  "[-v validate every] [-d seconds] [-w worker]\n", prog);
+}
+
+int main(int argc, char **argv) {
+  int threads = max(1u, thread::hardware_concurrency());
+  long long ops = 10000000;
+  uint64_t seed = random_device()() * 4294967296ULL + random_device()();
+  vector<int> keyRanges;
+  long long validateEvery = 100000;
+  double seconds = 0;
+  int only = -1;
+
+  int c;
+  while ((c = getopt(argc, argv, "t:n:s:k:v:d:w:")) != -1) {
+    switch (c) {
+      case 't': threads = max(1, atoi(optarg)); break;
+      // strtod, so 1e9 works too
+      case 'n': ops = (long long) strtod(optarg, nullptr); break;
+      case 's': seed = strtoull(optarg, nullptr, 0); break;
+      case 'v': validateEvery = (long long) strtod(optarg, nullptr); break;
+      case 'd': seconds = strtod(optarg, nullptr); break;
+      case 'w': only = atoi(optarg); break;
+      case 'k': {
+        string s = optarg;
+        for (size_t pos = 0; pos <= s.size(); ) {
+          size_t end = s.find(',', pos);
+          if (end == string::npos) end = s.size();
+          keyRanges.push_back((int) strtod(s.substr(pos, end - pos).c_str(), nullptr));
+          pos = end + 1;
+        }
+        break;
+      }
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (keyRanges.empty())
+    keyRanges = {64, 4096, 1000000};
+  for (int k : keyRanges) {
+    if (k < 1) {
+      fprintf(stderr, "key ranges have to be positive\n");
+      return 2;
+    }
+  }
+
+  vector<int> workers;
+  if (only >= 0)
+    workers.push_back(only);
+  else
+    for (int w = 0; w < threads; w++)
+      workers.push_back(w);
+
+  printf("seed %llu, %zu workers, %lld ops each\n",
+         (unsigned long long) seed, workers.size(), ops);
+  fflush(stdout);
+
+  vector<StressConfig> configs(workers.size());
+  vector<StressResult> results(workers.size());
+  for (size_t i = 0; i < workers.size(); i++) {
+    configs[i].seed = stressWorkerSeed(seed, workers[i]);
+    configs[i].ops = ops;
+    configs[i].keyRange = keyRanges[workers[i] % keyRanges.size()];
+    configs[i].validateEvery = validateEvery;
+    configs[i].filter = workers[i] % 2 == 1;
+    configs[i].hotCache = workers[i] % 4 >= 2;
+    configs[i].frozen = workers[i] % 8 >= 4;
+  }
+
+  // a failing worker stops the others, there's
+  // no point in waiting for the rest
+  atomic<bool> stop(false);
+  atomic<long long> progress(0);
+  atomic<int> running((int) workers.size());
+  vector<thread> pool;
+  auto start = Clock::now();
+  for (size_t i = 0; i < workers.size(); i++) {
+    pool.push_back(thread([&, i]() {
+      if (! runStress(configs[i], results[i], &stop, &progress))
+        stop = true;
+      running--;
+    }));
+  }
+
+  // progress report every 10 s
+  auto lastReport = start;
+  while (running > 0) {
+    this_thread::sleep_for(chrono::milliseconds(50));
+    auto now = Clock::now();
+    double elapsed = chrono::duration<double>(now - start).count();
+    if (seconds > 0 && elapsed >= seconds)
+      stop = true;
+    if (now - lastReport >= chrono::seconds(10)) {
+      lastReport = now;
+      fprintf(stderr, "%.0f s: %lld ops, %.2f Mops/s\n", elapsed,
+              progress.load(), progress / elapsed / 1e6);
+    }
+  }
+  for (thread &t : pool)
+    t.join();
+  double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+  long long total = 0;
+  bool ok = true;
+  for (size_t i = 0; i < workers.size(); i++) {
+    const StressResult &r = results[i];
+    total += r.ops;
+    if (r.ok) continue;
+
+    ok = false;
+    printf("worker %d (key range %d) failed at op %lld: %s\n",
+           workers[i], configs[i].keyRange, r.failedOp, r.why.c_str());
+    printf("  repeat with: %s -s %llu -k %d -w %d -n %lld -v %lld\n",
+           argv[0], (unsigned long long) seed, configs[i].keyRange,
+           workers[i], r.failedOp + 1, validateEvery);
+  }
+
+  printf("%s: %lld ops in %.1f s, %.2f Mops/s\n", ok ? "ok" : "FAILED",
+         total, elapsed, total / max(elapsed, 1e-9) / 1e6);
+  return ok ? 0 : 1;
+}
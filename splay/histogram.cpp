@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cmath>
+#include "histogram.h"
+
+LatencyHistogram::LatencyHistogram()
+  : buckets(NUM_BUCKETS, 0) {
+  reset();
+}
+
+void LatencyHistogram::reset() {
+  std::fill(buckets.begin(), buckets.end(), 0);
+  total = 0;
+  minValue = UINT64_MAX;
+  maxValue = 0;
+  sum = 0;
+}
+
+// buckets [0, SUB_BUCKETS) hold the values
+// themselves. for v >= SUB_BUCKETS with top bit e,
+// the SUB_BITS bits below the top bit pick the
+// bucket within [2^e, 2^(e+1))
+int LatencyHistogram::bucketOf(uint64_t v) {
+  if (v < SUB_BUCKETS) return v;
+  int e = 63 - __builtin_clzll(v);
+  int sub = (v >> (e - SUB_BITS)) & (SUB_BUCKETS - 1);
+  return (e - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketHigh(int i) {
+  if (i < SUB_BUCKETS) return i;
+  int e = i / SUB_BUCKETS + SUB_BITS - 1;
+  uint64_t sub = i % SUB_BUCKETS;
+  uint64_t low = (1ULL << e) + (sub << (e - SUB_BITS));
+  return low + (1ULL << (e - SUB_BITS)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t v) {
+  buckets[bucketOf(v)]++;
+  total++;
+  minValue = std::min(minValue, v);
+  maxValue = std::max(maxValue, v);
+  sum += v;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &h) {
+  for (int i = 0; i < NUM_BUCKETS; i++)
+    buckets[i] += h.buckets[i];
+  total += h.total;
+  minValue = std::min(minValue, h.minValue);
+  maxValue = std::max(maxValue, h.maxValue);
+  sum += h.sum;
+}
+
+double LatencyHistogram::mean() const {
+  return total ? (double) (sum / total) : 0;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+  if (total == 0) return 0;
+
+  // rank of the value we want, 1-based
+  uint64_t want = (uint64_t) std::ceil(q * total);
+  want = std::max<uint64_t>(1, std::min(want, total));
+
+  uint64_t seen = 0;
+  for (int i = 0; i < NUM_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen >= want)
+      return std::min(bucketHigh(i), maxValue);
+  }
+  return maxValue;
+}
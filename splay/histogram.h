@@ -0,0 +1,53 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+// log-linear histogram of non-negative values
+// (latencies in ns, depths, ...).
+//
+// values below 2^SUB_BITS get a bucket each. above that,
+// every power of two [2^e, 2^(e+1)) is split into
+// 2^SUB_BITS equal buckets, so a reported percentile is
+// within 1 / 2^SUB_BITS (~3%) of the true value,
+// with a fixed ~2k buckets for the full 64-bit range.
+// recording is O(1) and never allocates.
+class LatencyHistogram {
+  public:
+    static const int SUB_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+  private:
+    std::vector<uint64_t> buckets;
+    uint64_t total;
+    uint64_t minValue;
+    uint64_t maxValue;
+    long double sum;
+
+    static int bucketOf(uint64_t v);
+    // largest value that falls in bucket i
+    static uint64_t bucketHigh(int i);
+
+  public:
+    LatencyHistogram();
+
+    void record(uint64_t v);
+    // add all values recorded in h
+    void merge(const LatencyHistogram &h);
+    void reset();
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? minValue : 0; }
+    uint64_t max() const { return maxValue; }
+    double mean() const;
+
+    // smallest bucket bound that at least a
+    // fraction q of the values are <= to,
+    // capped at the largest recorded value.
+    // 0 if nothing was recorded
+    uint64_t percentile(double q) const;
+};
+
+#endif
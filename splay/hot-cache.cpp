@@ -0,0 +1,36 @@
+#include "hot-cache.h"
+
+HotKeyCache::HotKeyCache(int slots)
+  : shift(31),
+    hits(0),
+    misses(0),
+    invalidations(0),
+    clears(0) {
+  int numSets = 2;
+  while (2 * numSets < slots && numSets < (1 << 30)) {
+    numSets *= 2;
+    shift--;
+  }
+  sets.resize(numSets);
+  clear();
+  clears = 0;
+}
+
+void HotKeyCache::clear() {
+  for (Set &s : sets) {
+    s.nodes[0] = s.nodes[1] = nullptr;
+    s.keys[0] = s.keys[1] = 0;
+    s.mru = 0;
+  }
+  clears++;
+}
+
+HotCacheStats HotKeyCache::getStats() const {
+  HotCacheStats s;
+  s.slots = 2 * sets.size();
+  s.hits = hits;
+  s.misses = misses;
+  s.invalidations = invalidations;
+  s.clears = clears;
+  return s;
+}
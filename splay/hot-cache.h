@@ -0,0 +1,107 @@
+#ifndef HOT_CACHE_H
+#define HOT_CACHE_H
+
+#include <cstdint>
+#include <vector>
+
+class STNode;
+
+// small cache from key to node in front of
+// SplayTree::find (see SplayTree::enableHotCache).
+//
+// with a few hot keys, splaying keeps them near
+// the root, but alternating between them still
+// rotates them back and forth on every access. a
+// hit here returns the node straight away, with
+// no descent and no splay.
+//
+// it is 2-way set associative: each key maps to
+// one set of two entries, and a miss replaces the
+// entry of the set that was used less recently.
+// entries hold node pointers, so the tree drops a
+// key's entry whenever its node is unlinked or
+// rekeyed, and all entries on bulk operations.
+
+struct HotCacheStats {
+  int slots;
+  long long hits;
+  long long misses;
+  // entries dropped for unlinked or rekeyed nodes
+  long long invalidations;
+  // whole-cache clears by bulk operations
+  long long clears;
+
+  double hitRate() const {
+    long long n = hits + misses;
+    return n == 0 ? 0 : (double) hits / n;
+  }
+};
+
+class HotKeyCache {
+  private:
+    struct Set {
+      int keys[2];
+      STNode * nodes[2];
+      // the way used last
+      int mru;
+    };
+
+    std::vector<Set> sets;
+    int shift;
+
+    // fibonacci hashing: the top bits of
+    // key * 2^32 / phi pick the set
+    Set & setOf(int key) {
+      return sets[((uint32_t) key * 2654435769u) >> shift];
+    }
+
+  public:
+    long long hits;
+    long long misses;
+    long long invalidations;
+    long long clears;
+
+    // at least slots entries, rounded up to
+    // a power of two (4 or more)
+    HotKeyCache(int slots);
+
+    // cached node for key, or null
+    STNode * lookup(int key) {
+      Set &s = setOf(key);
+      for (int w = 0; w < 2; w++) {
+        if (s.nodes[w] != nullptr && s.keys[w] == key) {
+          s.mru = w;
+          hits++;
+          return s.nodes[w];
+        }
+      }
+      misses++;
+      return nullptr;
+    }
+
+    // remember node for key (after a miss)
+    void store(int key, STNode * node) {
+      Set &s = setOf(key);
+      int w = 1 - s.mru;
+      s.keys[w] = key;
+      s.nodes[w] = node;
+      s.mru = w;
+    }
+
+    // drop key's entry, if any
+    void invalidate(int key) {
+      Set &s = setOf(key);
+      for (int w = 0; w < 2; w++) {
+        if (s.nodes[w] != nullptr && s.keys[w] == key) {
+          s.nodes[w] = nullptr;
+          invalidations++;
+        }
+      }
+    }
+
+    void clear();
+
+    HotCacheStats getStats() const;
+};
+
+#endif
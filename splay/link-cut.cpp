@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include "link-cut.h"
+
+LCNode::LCNode(int id, long long value)
+  : left(nullptr),
+    right(nullptr),
+    parent(nullptr),
+    id(id),
+    value(value),
+    sum(value),
+    min(value),
+    flip(false) { }
+
+// a path-parent doesn't have this node as a child
+bool LCNode::isSplayRoot() const {
+  return parent == nullptr
+    || (parent->left != this && parent->right != this);
+}
+
+void LCNode::push() {
+  if (! flip) return;
+  std::swap(left, right);
+  if (left != nullptr)
+    left->flip = ! left->flip;
+  if (right != nullptr)
+    right->flip = ! right->flip;
+  flip = false;
+}
+
+// reversing a path doesn't change its sum
+// or min, so flip bits don't matter here
+void LCNode::update() {
+  sum = value;
+  min = value;
+  if (left != nullptr) {
+    sum += left->sum;
+    min = std::min(min, left->min);
+  }
+  if (right != nullptr) {
+    sum += right->sum;
+    min = std::min(min, right->min);
+  }
+}
+
+LinkCutForest::LinkCutForest(int n) {
+  for (int i = 0; i < n; i++)
+    addVertex();
+}
+
+int LinkCutForest::addVertex(long long value) {
+  nodes.emplace_back(nodes.size(), value);
+  return nodes.size() - 1;
+}
+
+LCNode * LinkCutForest::node(int v) {
+  assert(v >= 0 && v < (int) nodes.size());
+  return &nodes[v];
+}
+
+// as STNode::rotate, except that the grandparent
+// only gets x as a child if it had p as one
+// (otherwise it's p's path-parent, and x's now)
+void LinkCutForest::rotate(LCNode * x) {
+  LCNode * p = x->parent;
+  LCNode * gp = p->parent;
+
+  if (! p->isSplayRoot()) {
+    if (gp->left == p)
+      gp->left = x;
+    else
+      gp->right = x;
+  }
+  x->parent = gp;
+
+  if (p->left == x) {
+    p->left = x->right;
+    if (p->left != nullptr)
+      p->left->parent = p;
+    x->right = p;
+  } else {
+    p->right = x->left;
+    if (p->right != nullptr)
+      p->right->parent = p;
+    x->left = p;
+  }
+  p->parent = x;
+
+  // p is x's child now, update it first
+  p->update();
+  x->update();
+}
+
+// same steps as SplayTree::splay. the flips on
+// the way down from the splay root are pushed
+// first, so the rotations see the real children
+void LinkCutForest::splay(LCNode * x) {
+  std::vector<LCNode*> path;
+  for (LCNode * cur = x; ; cur = cur->parent) {
+    path.push_back(cur);
+    if (cur->isSplayRoot()) break;
+  }
+  for (int i = path.size() - 1; i >= 0; i--)
+    path[i]->push();
+
+  while (! x->isSplayRoot()) {
+    LCNode * p = x->parent;
+    // no grandparent in this splay tree
+    if (p->isSplayRoot())
+      rotate(x);
+    // left/left or right/right
+    else if ((p->left == x) == (p->parent->left == p)) {
+      rotate(p);
+      rotate(x);
+    }
+    // left/right or right/left
+    else {
+      rotate(x);
+      rotate(x);
+    }
+  }
+}
+
+// at each path-parent y, y's deeper part of its
+// path (its right subtree) is cut off and the
+// path below replaces it
+LCNode * LinkCutForest::access(LCNode * x) {
+  LCNode * last = nullptr;
+  for (LCNode * y = x; y != nullptr; y = y->parent) {
+    splay(y);
+    y->right = last;
+    y->update();
+    last = y;
+  }
+  splay(x);
+  return last;
+}
+
+// after access, x is the deepest node of the
+// path in its splay tree. reversing the path
+// makes it the shallowest, i.e. the root
+void LinkCutForest::makeRoot(LCNode * x) {
+  access(x);
+  x->flip = ! x->flip;
+}
+
+// the shallowest node of the root path,
+// splayed to pay for the descent
+LCNode * LinkCutForest::_findRoot(LCNode * x) {
+  access(x);
+  LCNode * r = x;
+  r->push();
+  while (r->left != nullptr) {
+    r = r->left;
+    r->push();
+  }
+  splay(r);
+  return r;
+}
+
+LCNode * LinkCutForest::exposePath(LCNode * u, LCNode * v) {
+  makeRoot(u);
+  access(v);
+  return v;
+}
+
+long long LinkCutForest::getValue(int v) {
+  return node(v)->value;
+}
+
+// aggregates are per splay tree, and x is
+// the root of its own after splaying
+void LinkCutForest::setValue(int v, long long value) {
+  LCNode * x = node(v);
+  splay(x);
+  x->value = value;
+  x->update();
+}
+
+bool LinkCutForest::link(int u, int v) {
+  if (connected(u, v)) return false;
+  LCNode * x = node(u);
+  makeRoot(x);
+  // x is the root of its tree and of its splay
+  // tree, so v just becomes its path-parent
+  x->parent = node(v);
+  return true;
+}
+
+bool LinkCutForest::cut(int u, int v) {
+  if (u == v) return false;
+  LCNode * x = node(u);
+  LCNode * y = node(v);
+  LCNode * root = _findRoot(x);
+
+  // with u the root, the edge is there iff the
+  // path u..v is just u, v
+  exposePath(x, y);
+  x->push();
+  bool edge = y->left == x && x->right == nullptr;
+  if (edge) {
+    y->left = nullptr;
+    x->parent = nullptr;
+    y->update();
+  }
+
+  // root is on one side. the other side is
+  // rooted at its endpoint already
+  makeRoot(root);
+  return edge;
+}
+
+int LinkCutForest::findRoot(int v) {
+  return _findRoot(node(v))->id;
+}
+
+bool LinkCutForest::connected(int u, int v) {
+  if (u == v) return true;
+  return _findRoot(node(u)) == _findRoot(node(v));
+}
+
+void LinkCutForest::reroot(int v) {
+  makeRoot(node(v));
+}
+
+int LinkCutForest::lca(int u, int v) {
+  if (! connected(u, v)) return -1;
+  access(node(u));
+  return access(node(v))->id;
+}
+
+// the path queries reroot at u, so they put
+// the old root back afterwards
+long long LinkCutForest::pathSum(int u, int v) {
+  assert(connected(u, v));
+  LCNode * root = _findRoot(node(u));
+  long long s = exposePath(node(u), node(v))->sum;
+  makeRoot(root);
+  return s;
+}
+
+long long LinkCutForest::pathMin(int u, int v) {
+  assert(connected(u, v));
+  LCNode * root = _findRoot(node(u));
+  long long m = exposePath(node(u), node(v))->min;
+  makeRoot(root);
+  return m;
+}
@@ -0,0 +1,119 @@
+#ifndef LINK_CUT_H
+#define LINK_CUT_H
+
+#include <deque>
+#include <vector>
+
+// link-cut trees (Sleator and Tarjan, see Tarjan's
+// book): a forest of rooted trees over vertices
+// 0..n-1 with edges added and removed at any time,
+// and connectivity, root, lca and path sum/min
+// queries, all in O(log n) amortized.
+//
+// each tree is split into preferred paths, and
+// each path is kept in a splay tree ordered by
+// depth. the root of a path's splay tree keeps a
+// path-parent pointer to the vertex above the top
+// of the path: its parent pointer is set, but the
+// parent doesn't have it as a child. access(v)
+// splays its way up these pointers until the path
+// from the tree's root to v is a single splay tree.
+//
+// link and cut treat edges as undirected, so they
+// may have to reroot a tree (reverse a path). the
+// reversal is lazy: a flip bit on a splay subtree
+// means its children are swapped, and is pushed
+// down before the subtree is descended into.
+//
+// the splay trees can't reuse STNode: a node whose
+// parent doesn't point back at it is a splay root
+// here, and rotations need the flip bits pushed.
+
+class LCNode {
+  public:
+    LCNode * left;
+    LCNode * right;
+    // parent in the splay tree, or path-parent
+    // if this is the root of its splay tree
+    LCNode * parent;
+    int id;
+
+    long long value;
+    // over this splay subtree, i.e. a piece
+    // of a preferred path
+    long long sum;
+    long long min;
+    // children (and their subtrees) are swapped
+    bool flip;
+
+    LCNode(int id, long long value);
+
+    // root of its splay tree (not of the forest)
+    bool isSplayRoot() const;
+    // apply a pending flip to the children
+    void push();
+    // sum and min from the children
+    void update();
+};
+
+class LinkCutForest {
+  private:
+    // deque so nodes don't move when
+    // vertices are added
+    std::deque<LCNode> nodes;
+
+    LCNode * node(int v);
+    void rotate(LCNode * x);
+    // splay x to the root of its splay tree
+    void splay(LCNode * x);
+    // make the path from x's root to x preferred,
+    // with x at the root of its splay tree. returns
+    // the last node splayed on the way up, which is
+    // the lca of x and the last vertex accessed
+    LCNode * access(LCNode * x);
+    // make x the root of its tree by reversing
+    // the path from x to the old root
+    void makeRoot(LCNode * x);
+    LCNode * _findRoot(LCNode * x);
+    // reroot at u and access v, so v's splay
+    // tree holds exactly the path u..v
+    LCNode * exposePath(LCNode * u, LCNode * v);
+
+  public:
+    // n single-vertex trees with value 0
+    LinkCutForest(int n = 0);
+
+    // new single-vertex tree, returns its id
+    int addVertex(long long value = 0);
+    int numVertices() const { return nodes.size(); }
+
+    long long getValue(int v);
+    void setValue(int v, long long value);
+
+    // add edge u-v: u's tree is rerooted at u and
+    // hung under v. false if u and v are already
+    // connected (the edge would close a cycle)
+    bool link(int u, int v);
+    // remove edge u-v. the part that doesn't hold
+    // the root is rooted at its endpoint. false if
+    // there is no such edge
+    bool cut(int u, int v);
+
+    // root of v's tree
+    int findRoot(int v);
+    bool connected(int u, int v);
+    // make v the root of its tree
+    void reroot(int v);
+
+    // lowest common ancestor of u and v in
+    // their tree, -1 if they aren't connected
+    int lca(int u, int v);
+
+    // sum / min of the values on the path u..v
+    // (both included).
+    // precondition: u and v are connected
+    long long pathSum(int u, int v);
+    long long pathMin(int u, int v);
+};
+
+#endif
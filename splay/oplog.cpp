@@ -0,0 +1,311 @@
+#include "oplog.h"
+#include "snapshot.h"
+#include <assert.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// file header: magic + version + padding 
+const size_t OPLOG_HEADER_SIZE = 16;
+
+// checksum of everything in the record before the checksum 
+static uint32_t recordChecksum(const LogRecord &r) {
+  return (uint32_t) checksumBytes(&r, offsetof(LogRecord, checksum));
+}
+
+static LogRecord makeRecord(uint8_t op, int32_t a, int32_t b, 
+                            int32_t c = 0, int32_t d = 0) {
+  LogRecord r;
+  memset(&r, 0, sizeof(r));
+  r.op = op;
+  r.a = a;
+  r.b = b;
+  r.c = c;
+  r.d = d;
+  r.checksum = recordChecksum(r);
+  return r;
+}
+
+// write all of buf, retrying short writes 
+static bool writeAll(int fd, const void * buf, size_t len) {
+  const char * p = (const char *) buf;
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n <= 0) return false;
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+// make a rename in the directory of path durable 
+static bool fsyncParentDir(const std::string &path) {
+  size_t slash = path.rfind('/');
+  std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+
+  int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dfd < 0) return false;
+  bool ok = fsync(dfd) == 0;
+  ::close(dfd);
+  return ok;
+}
+
+static bool writeHeader(int fd) {
+  char header[OPLOG_HEADER_SIZE];
+  memset(header, 0, sizeof(header));
+  memcpy(header, OPLOG_MAGIC, sizeof(OPLOG_MAGIC));
+  memcpy(header + sizeof(OPLOG_MAGIC), &OPLOG_VERSION, sizeof(OPLOG_VERSION));
+  return writeAll(fd, header, sizeof(header));
+}
+
+// read all valid records of a log file. 
+// stops at the first torn or corrupt record. 
+// returns false if the file is missing or 
+// has a bad header 
+static bool readLog(const std::string &path, std::vector<LogRecord> &records) {
+  FILE * f = fopen(path.c_str(), "rb");
+  if (f == nullptr) return false;
+
+  char header[OPLOG_HEADER_SIZE];
+  uint32_t version;
+  bool ok = fread(header, sizeof(header), 1, f) == 1;
+  memcpy(&version, header + sizeof(OPLOG_MAGIC), sizeof(version));
+  ok = ok && memcmp(header, OPLOG_MAGIC, sizeof(OPLOG_MAGIC)) == 0;
+  ok = ok && version == OPLOG_VERSION;
+
+  LogRecord r;
+  while (ok && fread(&r, sizeof(r), 1, f) == 1) {
+    if (r.checksum != recordChecksum(r)) break;
+    records.push_back(r);
+  }
+  fclose(f);
+  return ok;
+}
+
+OpLog::OpLog() 
+  : fd(-1), 
+    groupSize(64), 
+    fsyncs(0), 
+    failed(false) { }
+
+OpLog::~OpLog() {
+  close();
+}
+
+bool OpLog::open(const std::string &p, int group) {
+  close();
+  path = p;
+  groupSize = group > 0 ? group : 1;
+  failed = false;
+
+  // keep only the valid prefix of an existing log 
+  std::vector<LogRecord> records;
+  bool existing = readLog(path, records);
+
+  fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+  if (fd < 0) return false;
+
+  bool ok;
+  if (existing) {
+    off_t validEnd = OPLOG_HEADER_SIZE + records.size() * sizeof(LogRecord);
+    ok = ftruncate(fd, validEnd) == 0 
+         && lseek(fd, validEnd, SEEK_SET) == validEnd;
+  }
+  else 
+    ok = ftruncate(fd, 0) == 0 && writeHeader(fd) && fsync(fd) == 0;
+
+  if (! ok) {
+    ::close(fd);
+    fd = -1;
+  }
+  return ok;
+}
+
+void OpLog::close() {
+  if (fd < 0) return;
+  commit();
+  ::close(fd);
+  fd = -1;
+}
+
+void OpLog::append(uint8_t op, int32_t a, int32_t b) {
+  pending.push_back(makeRecord(op, a, b));
+  if (pending.size() >= groupSize)
+    commit();
+}
+
+// group commit: one write and one fsync 
+// for all pending records 
+bool OpLog::commit() {
+  if (fd < 0) return false;
+  if (pending.empty()) return ! failed;
+
+  bool ok = writeAll(fd, pending.data(), pending.size() * sizeof(LogRecord))
+            && fsync(fd) == 0;
+  fsyncs++;
+  pending.clear();
+  failed = failed || ! ok;
+  return ! failed;
+}
+
+// order matters for crash safety: 
+// 1. the snapshot is written next to the old one 
+// 2. a checkpoint record with its checksum and 
+//    the current hash is made durable in the log 
+// 3. the snapshot is renamed over the old one 
+// 4. a new log holding only that checkpoint record 
+//    is written next to the old one and renamed 
+//    over it 
+//
+// a crash between any two steps leaves a 
+// snapshot whose checksum matches some checkpoint 
+// record in the log (see replayLog). the log is 
+// never cut in place, since a crash after the 
+// cut would leave it without that record 
+bool OpLog::checkpoint(const SplayTree &t, const std::string &snapshotPath) {
+  if (fd < 0) return false;
+
+  std::string tmp = snapshotPath + ".tmp";
+  ll checksum;
+  if (! writeSnapshot(t, tmp, false, &checksum)) return false;
+
+  ll hash = t.getHash();
+  LogRecord cp = makeRecord(LOG_CHECKPOINT, (int32_t) (hash & 0xffffffffULL), 
+                                            (int32_t) (hash >> 32), 
+                                            (int32_t) (checksum & 0xffffffffULL), 
+                                            (int32_t) (checksum >> 32));
+  pending.push_back(cp);
+  if (! commit()) return false;
+
+  if (rename(tmp.c_str(), snapshotPath.c_str()) != 0) return false;
+  if (! fsyncParentDir(snapshotPath)) return false;
+
+  std::string tmpLog = path + ".tmp";
+  int tfd = ::open(tmpLog.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (tfd < 0) return false;
+  bool ok = writeHeader(tfd) 
+            && writeAll(tfd, &cp, sizeof(cp)) 
+            && fsync(tfd) == 0;
+  fsyncs++;
+  ok = (::close(tfd) == 0) && ok;
+  ok = ok && rename(tmpLog.c_str(), path.c_str()) == 0 
+          && fsyncParentDir(path);
+  if (! ok) {
+    unlink(tmpLog.c_str());
+    return false;
+  }
+
+  // appends go to the new log from here on 
+  ::close(fd);
+  fd = ::open(path.c_str(), O_WRONLY);
+  ok = fd >= 0 && lseek(fd, 0, SEEK_END) == (off_t) (OPLOG_HEADER_SIZE + sizeof(cp));
+  failed = failed || ! ok;
+  return ok;
+}
+
+void OpLog::onInsert(int key, int count) {
+  append(LOG_INSERT, key, count);
+}
+
+void OpLog::onRemove(int key) {
+  append(LOG_REMOVE, key, 0);
+}
+
+void OpLog::onEraseRange(int lo, int hi) {
+  append(LOG_ERASE_RANGE, lo, hi);
+}
+
+void OpLog::onInsertMulti(int key) {
+  append(LOG_INSERT_MULTI, key, 0);
+}
+
+void OpLog::onRemoveOne(int key) {
+  append(LOG_REMOVE_ONE, key, 0);
+}
+
+void OpLog::onRekey(int oldKey, int newKey) {
+  append(LOG_REKEY, oldKey, newKey);
+}
+
+static ll checkpointHash(const LogRecord &r) {
+  return ((ll) (uint32_t) r.b << 32) | (uint32_t) r.a;
+}
+
+static ll checkpointChecksum(const LogRecord &r) {
+  return ((ll) (uint32_t) r.d << 32) | (uint32_t) r.c;
+}
+
+// replay starts after the last checkpoint record 
+// whose checksum matches the snapshot. the root 
+// hash alone ignores counts, so it could match a 
+// checkpoint taken after only insertMulti/removeOne 
+// ops and skip them. with no snapshot and no 
+// matching checkpoint, the whole log is replayed 
+// on an empty tree. any later checkpoint record 
+// must match the hash of the replayed tree. 
+bool replayLog(const std::string &snapshotPath, 
+               const std::string &logPath, SplayTree &t) {
+  assert(t.root == nullptr);
+
+  bool haveSnapshot = access(snapshotPath.c_str(), F_OK) == 0;
+  ll checksum = 0;
+  if (haveSnapshot) {
+    SnapshotView view;
+    if (! view.open(snapshotPath)) return false;
+    view.toTree(t);
+    checksum = view.getChecksum();
+  }
+
+  // snapshot alone 
+  if (access(logPath.c_str(), F_OK) != 0)
+    return true;
+
+  std::vector<LogRecord> records;
+  if (! readLog(logPath, records))
+    return false;
+
+  int start = -1;
+  for (int i = 0; i < records.size(); i++)
+    if (records[i].op == LOG_CHECKPOINT && haveSnapshot 
+        && checkpointChecksum(records[i]) == checksum)
+      start = i;
+  if (start >= 0 && checkpointHash(records[start]) != t.getHash())
+    return false;
+  if (start < 0 && haveSnapshot && t.getSize() > 0)
+    return false;
+
+  for (int i = start + 1; i < records.size(); i++) {
+    const LogRecord &r = records[i];
+    switch (r.op) {
+      case LOG_INSERT:
+        t.insert(r.a);
+        for (int c = 1; c < r.b; c++)
+          t.insertMulti(r.a);
+        break;
+      case LOG_REMOVE:
+        t.remove(r.a);
+        break;
+      case LOG_ERASE_RANGE:
+        t.eraseRange(r.a, r.b);
+        break;
+      case LOG_INSERT_MULTI:
+        t.insertMulti(r.a);
+        break;
+      case LOG_REMOVE_ONE:
+        t.removeOne(r.a);
+        break;
+      case LOG_REKEY:
+        t.rekey(r.a, r.b);
+        break;
+      case LOG_CHECKPOINT:
+        if (checkpointHash(r) != t.getHash()) return false;
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
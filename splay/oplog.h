@@ -0,0 +1,109 @@
+#ifndef OPLOG_H
+#define OPLOG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "splay.h"
+
+// append-only operation log (write-ahead log) 
+// for splay tree mutations 
+//
+// an OpLog is attached to a tree as an observer 
+// and appends one fixed-size record per mutation. 
+// records are buffered and written + fsync'ed 
+// in groups (group commit): every groupSize 
+// records, or when commit() is called. 
+//
+// checkpoint() writes a snapshot of the tree 
+// and replaces the log with one that starts at 
+// the checkpoint (by rename, so a crash leaves 
+// the old log or the new one). the checkpoint 
+// record holds the snapshot's checksum, which 
+// covers its keys and counts, so replay knows 
+// which checkpoint a snapshot belongs to, and the 
+// root hash, so it can check cheaply that it 
+// rebuilt the same tree. 
+//
+// file layout: 8-byte magic, version, then 
+// LogRecords. each record has its own checksum, 
+// so a torn write at the tail is detected and 
+// ignored (and cut off when the log is reopened). 
+
+const char OPLOG_MAGIC[8] = {'S','P','L','A','Y','L','O','G'};
+const uint32_t OPLOG_VERSION = 2;
+
+enum LogOp : uint8_t {
+  LOG_INSERT = 1,       // a = key, b = count 
+  LOG_REMOVE,           // a = key 
+  LOG_ERASE_RANGE,      // a = lo, b = hi 
+  LOG_INSERT_MULTI,     // a = key 
+  LOG_REMOVE_ONE,       // a = key 
+  LOG_REKEY,            // a = old key, b = new key 
+  LOG_CHECKPOINT        // (a, b) = low, high half of root hash, 
+                        // (c, d) = of the snapshot checksum 
+};
+
+struct LogRecord {
+  uint8_t op;
+  uint8_t pad[3];
+  int32_t a;
+  int32_t b;
+  int32_t c;
+  int32_t d;
+  uint32_t checksum;
+};
+
+class OpLog : public TreeObserver {
+  private:
+    int fd;
+    int groupSize;
+    std::string path;
+
+    // records not yet written/fsync'ed 
+    std::vector<LogRecord> pending;
+
+    long long fsyncs;
+    bool failed;
+
+    void append(uint8_t op, int32_t a, int32_t b);
+
+  public:
+    OpLog();
+    ~OpLog();
+
+    // open (or create) the log for appending. 
+    // an invalid tail left by a crash is cut off 
+    bool open(const std::string &path, int groupSize = 64);
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+    // write and fsync pending records. 
+    // returns false if any write so far has failed 
+    bool commit();
+
+    // write a snapshot of t to snapshotPath 
+    // and start a new log. t must be the tree 
+    // this log is attached to 
+    bool checkpoint(const SplayTree &t, const std::string &snapshotPath);
+
+    int pendingRecords() const { return pending.size(); }
+    long long fsyncCount() const { return fsyncs; }
+
+    void onInsert(int key, int count);
+    void onRemove(int key);
+    void onEraseRange(int lo, int hi);
+    void onInsertMulti(int key);
+    void onRemoveOne(int key);
+    void onRekey(int oldKey, int newKey);
+};
+
+// rebuild a tree from the last snapshot plus the log. 
+// t must be empty. returns false if the snapshot 
+// is invalid or has no checkpoint record in the log, 
+// or the replayed tree doesn't match a later 
+// checkpoint hash 
+bool replayLog(const std::string &snapshotPath, 
+               const std::string &logPath, SplayTree &t);
+
+#endif
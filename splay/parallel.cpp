@@ -0,0 +1,115 @@
+#include <algorithm>
+#include "parallel.h"
+
+int parallelThreads(int threads) {
+  if (threads > 0) return threads;
+  int n = std::thread::hardware_concurrency();
+  return n > 0 ? n : 1;
+}
+
+// number of keys < k below node (no splaying)
+static long long countBelow(STNode * node, int k) {
+  long long r = 0;
+  while (node != nullptr) {
+    if (k <= node->key)
+      node = node->left;
+    else {
+      r += 1 + (node->hasLeftChild() ? node->left->size : 0);
+      node = node->right;
+    }
+  }
+  return r;
+}
+
+// node with inorder index i below node, 
+// precondition: 0 <= i < node->size (no splaying)
+static STNode * nodeAt(STNode * node, long long i) {
+  while (true) {
+    long long lsize = node->hasLeftChild() ? node->left->size : 0;
+    if (i < lsize)
+      node = node->left;
+    else if (i == lsize)
+      return node;
+    else {
+      i -= lsize + 1;
+      node = node->right;
+    }
+  }
+}
+
+// split the inorder indexes [first, last) into up
+// to threads equal ranges, and run
+// work(worker, node, offset, n) for range worker on
+// a thread of its own: node is the key at index
+// offset, found by a descent, and the worker walks
+// n successors from there. ranges are cut by rank
+// rather than by subtree, so every worker gets
+// its share whatever the shape of the tree
+static void runRanges(STNode * root, long long first, long long last, int threads,
+                      const std::function<void(int, STNode *, long long, long long)> &work) {
+  long long total = last - first;
+  if (total <= 0) return;
+  threads = std::min<long long>(threads, total);
+
+  auto range = [&](int w) {
+    long long from = first + total * w / threads;
+    long long to = first + total * (w + 1) / threads;
+    work(w, nodeAt(root, from), from, to - from);
+  };
+  if (threads == 1) {
+    range(0);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  for (int w = 0; w < threads; w++)
+    workers.push_back(std::thread(range, w));
+  for (std::thread &t : workers)
+    t.join();
+}
+
+void parallelInorder(const SplayTree &t, int * out, int threads) {
+  if (t.root == nullptr) return;
+  runRanges(t.root, 0, t.root->size, parallelThreads(threads),
+            [&](int worker, STNode * n, long long offset, long long m) {
+    int * dst = out + offset;
+    for (long long j = 0; j < m; j++) {
+      dst[j] = n->key;
+      n = n->successor();
+    }
+  });
+}
+
+void parallelInorder(const SplayTree &t, std::vector<int> &v, int threads) {
+  v.resize(t.getSize());
+  if (! v.empty())
+    parallelInorder(t, v.data(), threads);
+}
+
+long long parallelForEachWorker(const SplayTree &t, int lo, int hi,
+                                const std::function<void(int, int, int)> &fn,
+                                int threads) {
+  if (lo > hi || t.root == nullptr) return 0;
+  threads = parallelThreads(threads);
+
+  // the keys in [lo, hi] are the indexes 
+  // [keys < lo, keys <= hi) 
+  long long first = countBelow(t.root, lo);
+  long long last = hi == INT_MAX ? t.root->size : countBelow(t.root, hi + 1);
+  runRanges(t.root, first, last, threads,
+            [&](int worker, STNode * n, long long offset, long long m) {
+    for (long long j = 0; j < m; j++) {
+      fn(worker, n->key, n->count);
+      n = n->successor();
+    }
+  });
+  return std::max(0LL, last - first);
+}
+
+long long parallelForEach(const SplayTree &t, int lo, int hi,
+                          const std::function<void(int, int)> &fn,
+                          int threads) {
+  return parallelForEachWorker(t, lo, hi, [&fn](int worker, int key, int count) {
+    fn(key, count);
+  }, threads);
+}
@@ -0,0 +1,74 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <climits>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "splay.h"
+
+// multithreaded read-only traversals of a SplayTree.
+//
+// the keys are split into one range of inorder
+// indexes per thread, of equal length whatever the
+// shape of the tree (a splay tree is often close
+// to a path). each worker finds the first key of
+// its range by a descent on the size augmentation
+// and walks successors from there. nothing is splayed,
+// so these may run while other threads only read the
+// tree too, but not alongside any operation that
+// splays or mutates it.
+//
+// threads <= 0 means one per core.
+
+// all keys in order into out, which must have room
+// for t.getSize() keys. the key with inorder index
+// i goes to out[i], so each range is written at a
+// known offset without coordination
+void parallelInorder(const SplayTree &t, int * out, int threads = 0);
+
+// same into v, resized to exactly t.getSize()
+void parallelInorder(const SplayTree &t, std::vector<int> &v, int threads = 0);
+
+// fn(key, count) for every key in [lo, hi], called
+// from several threads at once and in no particular
+// order. returns the number of keys visited
+long long parallelForEach(const SplayTree &t, int lo, int hi,
+                          const std::function<void(int, int)> &fn,
+                          int threads = 0);
+
+// the same, with the index of the calling worker
+// (0 <= worker < threads used) so callers can keep
+// per-thread state without locking. worker w visits
+// the w-th range of keys, so every worker visits
+// some if there are at least threads keys
+long long parallelForEachWorker(const SplayTree &t, int lo, int hi,
+                                const std::function<void(int, int, int)> &fn,
+                                int threads = 0);
+
+int parallelThreads(int threads);
+
+// combine(map(key, count)) over the keys in [lo, hi].
+// combine has to be associative and commutative,
+// since keys are folded per thread in no fixed order
+// and the partial results combined at the end
+template <class T, class Map, class Combine>
+T parallelReduce(const SplayTree &t, int lo, int hi, T identity,
+                 Map map, Combine combine, int threads = 0) {
+  // one cache line per worker, so the partial
+  // results don't share lines
+  struct alignas(64) Partial { T value; };
+
+  threads = parallelThreads(threads);
+  std::vector<Partial> partial(threads, Partial{identity});
+  parallelForEachWorker(t, lo, hi, [&](int worker, int key, int count) {
+    partial[worker].value = combine(partial[worker].value, map(key, count));
+  }, threads);
+
+  T result = identity;
+  for (const Partial &p : partial)
+    result = combine(result, p.value);
+  return result;
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include <cstring>
+#include "perf-counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char * perfEventName(int e) {
+  static const char * names[PERF_NUM_EVENTS] = {
+    "cycles", "instructions", "L1d-misses",
+    "LLC-misses", "dTLB-misses", "branch-misses"
+  };
+  return e >= 0 && e < PERF_NUM_EVENTS ? names[e] : "?";
+}
+
+PerfCounters::PerfCounters() {
+  for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+    fds[e] = -1;
+    values[e] = 0;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  close();
+}
+
+bool PerfCounters::anyAvailable() const {
+  for (int e = 0; e < PERF_NUM_EVENTS; e++)
+    if (available(e)) return true;
+  return false;
+}
+
+#ifdef __linux__
+
+// cache events are (cache id) | (op << 8) | (result << 16)
+static uint64_t cacheReadMiss(uint64_t cache) {
+  return cache
+       | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+       | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+static int openEvent(uint32_t type, uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                   | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  // this thread, any cpu, no group
+  return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+bool PerfCounters::open() {
+  close();
+  fds[PERF_CYCLES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  fds[PERF_INSTRUCTIONS] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  fds[PERF_L1D_MISSES] = openEvent(PERF_TYPE_HW_CACHE,
+                                   cacheReadMiss(PERF_COUNT_HW_CACHE_L1D));
+  fds[PERF_LLC_MISSES] = openEvent(PERF_TYPE_HW_CACHE,
+                                   cacheReadMiss(PERF_COUNT_HW_CACHE_LL));
+  fds[PERF_DTLB_MISSES] = openEvent(PERF_TYPE_HW_CACHE,
+                                    cacheReadMiss(PERF_COUNT_HW_CACHE_DTLB));
+  fds[PERF_BRANCH_MISSES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+  return anyAvailable();
+}
+
+void PerfCounters::close() {
+  for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+    if (fds[e] >= 0)
+      ::close(fds[e]);
+    fds[e] = -1;
+  }
+}
+
+void PerfCounters::start() {
+  for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+    if (fds[e] < 0) continue;
+    ioctl(fds[e], PERF_EVENT_IOC_RESET, 0);
+    ioctl(fds[e], PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+void PerfCounters::stop() {
+  for (int e = 0; e < PERF_NUM_EVENTS; e++)
+    if (fds[e] >= 0)
+      ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+
+  for (int e = 0; e < PERF_NUM_EVENTS; e++) {
+    values[e] = 0;
+    if (fds[e] < 0) continue;
+
+    // value, time enabled, time running
+    uint64_t buf[3];
+    if (read(fds[e], buf, sizeof(buf)) != sizeof(buf)) continue;
+
+    // scale up if the counter was multiplexed
+    if (buf[2] > 0 && buf[2] < buf[1])
+      values[e] = (uint64_t) ((double) buf[0] * buf[1] / buf[2]);
+    else
+      values[e] = buf[0];
+  }
+}
+
+#else
+
+// no counters outside of linux
+bool PerfCounters::open() { return false; }
+void PerfCounters::close() { }
+void PerfCounters::start() { }
+void PerfCounters::stop() { }
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+
+// hardware performance counters around a batch of
+// operations, with linux perf_event_open.
+//
+// each counter is opened on its own for this thread
+// (user space only), so if some event isn't supported
+// by the CPU or the VM the others still work. when the
+// kernel doesn't allow counters at all (containers,
+// perf_event_paranoid > 2, not linux), every counter
+// is unavailable and start/stop do nothing.
+//
+// if the PMU has fewer registers than events, the
+// kernel multiplexes them and the counts are scaled
+// up from the time each one actually ran.
+
+enum PerfEvent {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_L1D_MISSES,
+  PERF_LLC_MISSES,
+  PERF_DTLB_MISSES,
+  PERF_BRANCH_MISSES,
+  PERF_NUM_EVENTS
+};
+
+const char * perfEventName(int e);
+
+class PerfCounters {
+  private:
+    int fds[PERF_NUM_EVENTS];
+    uint64_t values[PERF_NUM_EVENTS];
+
+  public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters & operator=(const PerfCounters &) = delete;
+
+    // true if at least one counter is available
+    bool open();
+    void close();
+
+    bool available(int e) const { return fds[e] >= 0; }
+    bool anyAvailable() const;
+
+    // reset and start all counters
+    void start();
+    // stop them and read the counts
+    void stop();
+
+    // count from the last start/stop,
+    // 0 if the counter is unavailable
+    uint64_t value(int e) const { return values[e]; }
+};
+
+#endif
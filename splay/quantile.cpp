@@ -0,0 +1,50 @@
+#include "quantile.h"
+#include <assert.h>
+#include <climits>
+#include <cmath>
+
+QuantileWindow::QuantileWindow(int w) : windowSize(w) {
+  assert(w > 0);
+}
+
+void QuantileWindow::evictOldest() {
+  bool removed = tree.removeOne(values.front());
+  assert(removed);
+  values.pop_front();
+}
+
+void QuantileWindow::push(int v) {
+  if (size() == windowSize)
+    evictOldest();
+
+  values.push_back(v);
+  tree.insertMulti(v);
+}
+
+// only the last windowSize values of the batch 
+// can survive it. if the batch fills the whole 
+// window, the old window is dropped in bulk 
+// (eraseRange) and the earlier batch values skipped 
+void QuantileWindow::pushBatch(const std::vector<int> &vs) {
+  int first = 0;
+  if (vs.size() >= windowSize) {
+    first = vs.size() - windowSize;
+    tree.eraseRange(INT_MIN, INT_MAX);
+    values.clear();
+  }
+
+  for (int i = first; i < vs.size(); i++)
+    push(vs[i]);
+}
+
+int QuantileWindow::quantile(double q) {
+  assert(size() > 0);
+
+  int i = (int) std::ceil(q * size()) - 1;
+  if (i < 0) i = 0;
+  if (i >= size()) i = size() - 1;
+
+  STNode * node = tree.select(i);
+  assert(node != nullptr);
+  return node->key;
+}
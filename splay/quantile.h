@@ -0,0 +1,48 @@
+#ifndef QUANTILE_H
+#define QUANTILE_H
+
+#include <deque>
+#include <vector>
+#include "splay.h"
+
+// sliding-window order statistics over a stream of ints. 
+//
+// the last windowSize values are kept in a 
+// multiset SplayTree (see insertMulti) so that 
+// a quantile is a single select() on subtree weights, 
+// O(log w) amortized instead of re-sorting the 
+// window (O(w log w)) for every query. 
+class QuantileWindow {
+  private:
+    int windowSize;
+
+    // values in arrival order, for eviction 
+    std::deque<int> values;
+
+    // multiset of the values in the window 
+    SplayTree tree;
+
+    void evictOldest();
+
+  public:
+    QuantileWindow(int w);
+
+    // add a value, evicting the oldest one 
+    // if the window is full 
+    void push(int v);
+
+    // add values in order. values that would be 
+    // evicted again within the same batch 
+    // are never inserted 
+    void pushBatch(const std::vector<int> &vs);
+
+    int size() const { return values.size(); }
+
+    // nearest-rank quantile: the smallest value 
+    // with at least ceil(q * size()) values <= it. 
+    // precondition: size() > 0, 0 <= q <= 1 
+    int quantile(double q);
+    int median() { return quantile(0.5); }
+};
+
+#endif
@@ -0,0 +1,177 @@
+// replay a captured trace (see trace.h) on an
+// empty SplayTree, with per-operation timing
+//
+// usage: ./replay [-d] [-p] [-r runs] trace
+//
+//   -d  print the events as text instead
+//   -p  hardware counters per event (see perf-counters.h)
+//       instead of latencies
+//   -r  replay this many times, each on a fresh tree,
+//       and keep the fastest run (default 1)
+//
+// the tree configuration is whatever replay was built
+// with, e.g.
+//   make replay REPLAYFLAGS="-O2 -DSPLAY_STATS"
+// also prints the rotation and depth statistics,
+// and HASHFLAGS selects the hash (see splay.h).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <vector>
+
+#include "histogram.h"
+#include "perf-counters.h"
+#include "splay.h"
+#include "trace.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+struct ReplayResult {
+  double secs;
+  LatencyHistogram latency[TRACE_NUM_OPS];
+  long long counts[TRACE_NUM_OPS];
+  int size;
+  ll hash;
+};
+
+// time every event on its own, unless perf
+// counters are on (the clock reads would
+// dominate what they measure)
+static void replayOnce(const vector<TraceEvent> &events,
+                       PerfCounters * perf, ReplayResult &r) {
+  SplayTree * t = new SplayTree();
+  for (int op = 0; op < TRACE_NUM_OPS; op++) {
+    r.latency[op].reset();
+    r.counts[op] = 0;
+  }
+
+  auto start = Clock::now();
+  if (perf != nullptr) {
+    perf->start();
+    for (const TraceEvent &e : events)
+      applyTraceEvent(*t, e);
+    perf->stop();
+  }
+  else {
+    for (const TraceEvent &e : events) {
+      auto t0 = Clock::now();
+      applyTraceEvent(*t, e);
+      auto t1 = Clock::now();
+      r.latency[e.op].record(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count());
+    }
+  }
+  r.secs = chrono::duration<double>(Clock::now() - start).count();
+
+  for (const TraceEvent &e : events)
+    r.counts[e.op]++;
+  r.size = t->getSize();
+  r.hash = t->getHash();
+
+#ifdef SPLAY_STATS
+  fprintf(stderr, "%s", t->getStats().toText().c_str());
+#endif
+  delete t;
+}
+
+static void usage(const char * prog) {
+  fprintf(stderr, "usage: %s [-d] [-p] [-r runs] trace\n", prog);
+}
+
+int main(int argc, char **argv) {
+  bool dump = false;
+  bool usePerf = false;
+  int runs = 1;
+
+  int c;
+  while ((c = getopt(argc, argv, "dpr:")) != -1) {
+    switch (c) {
+      case 'd': dump = true; break;
+      case 'p': usePerf = true; break;
+      case 'r': runs = max(1, atoi(optarg)); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  TraceReader reader;
+  if (! reader.open(argv[optind])) {
+    fprintf(stderr, "can't read trace %s\n", argv[optind]);
+    return 1;
+  }
+
+  // read everything up front so the
+  // replay doesn't measure file i/o
+  vector<TraceEvent> events;
+  TraceEvent e;
+  while (reader.next(e)) {
+    if (dump)
+      printf("%s %d %d\n", traceOpName(e.op), e.a, e.b);
+    else
+      events.push_back(e);
+  }
+  if (reader.truncated())
+    fprintf(stderr, "warning: trace ends in a malformed record\n");
+  if (dump) return 0;
+
+  PerfCounters counters;
+  PerfCounters * perf = nullptr;
+  if (usePerf) {
+    if (counters.open())
+      perf = &counters;
+    else
+      fprintf(stderr, "no hardware counters available, "
+                      "reporting latencies instead\n");
+  }
+
+  // perf counts are kept for the fastest run only
+  ReplayResult * best = new ReplayResult();
+  ReplayResult * cur = new ReplayResult();
+  uint64_t perfValues[PERF_NUM_EVENTS] = {0};
+  for (int i = 0; i < runs; i++) {
+    replayOnce(events, perf, *cur);
+    if (i == 0 || cur->secs < best->secs) {
+      swap(best, cur);
+      if (perf != nullptr)
+        for (int ev = 0; ev < PERF_NUM_EVENTS; ev++)
+          perfValues[ev] = perf->value(ev);
+    }
+  }
+
+  size_t n = max<size_t>(events.size(), 1);
+  printf("events: %zu, %.3f s, %.3f Mops/s\n", events.size(),
+         best->secs, events.size() / max(best->secs, 1e-9) / 1e6);
+  printf("final tree: %d keys, hash %llu\n", best->size, (unsigned long long) best->hash);
+
+  if (perf != nullptr) {
+    for (int ev = 0; ev < PERF_NUM_EVENTS; ev++) {
+      if (perf->available(ev))
+        printf("%-14s %12.2f per event\n", perfEventName(ev), (double) perfValues[ev] / n);
+      else
+        printf("%-14s %12s\n", perfEventName(ev), "n/a");
+    }
+  }
+  else {
+    printf("%-12s %10s %8s %8s %8s %8s\n", "op", "count",
+           "mean ns", "p50 ns", "p99 ns", "p999 ns");
+    for (int op = 1; op < TRACE_NUM_OPS; op++) {
+      const LatencyHistogram &h = best->latency[op];
+      if (best->counts[op] == 0) continue;
+      printf("%-12s %10lld %8.0f %8llu %8llu %8llu\n", traceOpName(op),
+             best->counts[op], h.mean(),
+             (unsigned long long) h.percentile(0.5),
+             (unsigned long long) h.percentile(0.99),
+             (unsigned long long) h.percentile(0.999));
+    }
+  }
+
+  delete best;
+  delete cur;
+  return 0;
+}
@@ -0,0 +1,287 @@
+#include "snapshot.h"
+#include <assert.h>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// round up to a multiple of 8 
+static size_t align8(size_t n) {
+  return (n + 7) & ~((size_t) 7);
+}
+
+ll checksumBytes(const void * data, size_t len, ll h) {
+  const unsigned char * p = (const unsigned char *) data;
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// collect keys and counts in inorder. iterative, 
+// by successor steps from the subtree's leftmost 
+// node to its rightmost one, since a tree built by 
+// sequential inserts is a path 
+void collectInorder(const STNode * node, 
+                    std::vector<int32_t> &keys, 
+                    std::vector<int32_t> &counts) {
+  if (node == nullptr) return;
+  const STNode * last = node;
+  while (last->right != nullptr) last = last->right;
+  const STNode * n = node;
+  while (n->left != nullptr) n = n->left;
+
+  while (true) {
+    keys.push_back(n->key);
+    counts.push_back(n->count);
+    if (n == last) break;
+    if (n->right != nullptr) {
+      n = n->right;
+      while (n->left != nullptr) n = n->left;
+    } else {
+      while (n->parent->right == n) n = n->parent;
+      n = n->parent;
+    }
+  }
+}
+
+// fill aug[lo..hi] for the balanced tree over 
+// keys[lo..hi] and return the index of its root 
+// (-1 if empty). mirrors SplayTree::_buildBalanced 
+static int computeAug(const std::vector<int32_t> &keys, 
+                      const std::vector<int32_t> &counts, 
+                      std::vector<SnapshotAug> &aug, 
+                      int lo, int hi) {
+  if (lo > hi) return -1;
+
+  int mid = lo + (hi - lo) / 2;
+  int l = computeAug(keys, counts, aug, lo, mid - 1);
+  int r = computeAug(keys, counts, aug, mid + 1, hi);
+
+  SnapshotAug a;
+  a.size = 1;
+  a.weight = counts[mid];
+  ll lhash = 0, rhash = 0, ln = 0;
+  if (l >= 0) {
+    a.size += aug[l].size;
+    a.weight += aug[l].weight;
+    lhash = aug[l].hash;
+    ln = aug[l].size;
+  }
+  if (r >= 0) {
+    a.size += aug[r].size;
+    a.weight += aug[r].weight;
+    rhash = aug[r].hash;
+  }
+  a.hash = combineHash(lhash, ln, keys[mid], rhash);
+  aug[mid] = a;
+  return mid;
+}
+
+// write a section followed by zero padding 
+// to the next 8-byte boundary 
+static bool writeSection(FILE * f, const void * data, size_t len, ll &checksum) {
+  static const char zeros[8] = {0};
+  size_t pad = align8(len) - len;
+  if (len > 0 && fwrite(data, 1, len, f) != len) return false;
+  if (pad > 0 && fwrite(zeros, 1, pad, f) != pad) return false;
+  checksum = checksumBytes(data, len, checksum);
+  checksum = checksumBytes(zeros, pad, checksum);
+  return true;
+}
+
+bool writeSnapshot(const SplayTree &t, const std::string &path, bool withAug, 
+                   ll * checksumOut) {
+  std::vector<int32_t> keys, counts;
+  keys.reserve(t.getSize());
+  counts.reserve(t.getSize());
+  collectInorder(t.root, keys, counts);
+
+  SnapshotHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+  h.version = SNAPSHOT_VERSION;
+  h.count = keys.size();
+  h.rootHash = t.getHash();
+  h.byteOrder = SNAPSHOT_BYTE_ORDER;
+  h.hashMode = SPLAY_HASH_MODE;
+
+  // counts are only stored for real multisets 
+  if (t.getWeight() != t.getSize())
+    h.flags |= SNAPSHOT_COUNTS;
+  if (withAug)
+    h.flags |= SNAPSHOT_AUG;
+
+  FILE * f = fopen(path.c_str(), "wb");
+  if (f == nullptr) return false;
+
+  // header is rewritten once the checksum is known 
+  bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+
+  ll checksum = FNV_OFFSET;
+  ok = ok && writeSection(f, keys.data(), keys.size() * sizeof(int32_t), checksum);
+  if (h.flags & SNAPSHOT_COUNTS)
+    ok = ok && writeSection(f, counts.data(), counts.size() * sizeof(int32_t), checksum);
+  if (h.flags & SNAPSHOT_AUG) {
+    std::vector<SnapshotAug> aug(keys.size());
+    computeAug(keys, counts, aug, 0, (int) keys.size() - 1);
+    ok = ok && writeSection(f, aug.data(), aug.size() * sizeof(SnapshotAug), checksum);
+  }
+
+  h.checksum = checksum;
+  ok = ok && fseek(f, 0, SEEK_SET) == 0;
+  ok = ok && fwrite(&h, sizeof(h), 1, f) == 1;
+  ok = ok && fflush(f) == 0;
+  ok = ok && fsync(fileno(f)) == 0;
+  ok = (fclose(f) == 0) && ok;
+  if (checksumOut != nullptr)
+    *checksumOut = checksum;
+  return ok;
+}
+
+SnapshotView::SnapshotView() 
+  : base(nullptr), 
+    length(0), 
+    header(nullptr), 
+    keys(nullptr), 
+    counts(nullptr), 
+    aug(nullptr) { }
+
+SnapshotView::~SnapshotView() {
+  close();
+}
+
+void SnapshotView::close() {
+  if (base != nullptr)
+    munmap(base, length);
+  base = nullptr;
+  length = 0;
+  header = nullptr;
+  keys = counts = nullptr;
+  aug = nullptr;
+}
+
+bool SnapshotView::open(const std::string &path, bool verifyChecksum) {
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(SnapshotHeader)) {
+    ::close(fd);
+    return false;
+  }
+
+  void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) return false;
+  base = p;
+  length = st.st_size;
+
+  const SnapshotHeader * h = (const SnapshotHeader *) base;
+  if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0
+      || h->version != SNAPSHOT_VERSION 
+      || h->byteOrder != SNAPSHOT_BYTE_ORDER
+      || h->hashMode != SPLAY_HASH_MODE) {
+    close();
+    return false;
+  }
+
+  // a count that doesn't fit in an int, or in the 
+  // file, is rejected before it is multiplied, so 
+  // a damaged count can't wrap around to a size 
+  // that matches the file 
+  if (h->count > INT_MAX || h->count > length / sizeof(int32_t)) {
+    close();
+    return false;
+  }
+
+  // section sizes must add up to the file size 
+  size_t keyBytes = align8(h->count * sizeof(int32_t));
+  size_t expected = sizeof(SnapshotHeader) + keyBytes;
+  if (h->flags & SNAPSHOT_COUNTS)
+    expected += keyBytes;
+  if (h->flags & SNAPSHOT_AUG)
+    expected += h->count * sizeof(SnapshotAug);
+  if (expected != length) {
+    close();
+    return false;
+  }
+
+  const char * cur = (const char *) base + sizeof(SnapshotHeader);
+  if (verifyChecksum 
+      && checksumBytes(cur, length - sizeof(SnapshotHeader)) != h->checksum) {
+    close();
+    return false;
+  }
+
+  header = h;
+  keys = (const int32_t *) cur;
+  cur += keyBytes;
+  if (h->flags & SNAPSHOT_COUNTS) {
+    counts = (const int32_t *) cur;
+    cur += keyBytes;
+  }
+  if (h->flags & SNAPSHOT_AUG)
+    aug = (const SnapshotAug *) cur;
+  return true;
+}
+
+int SnapshotView::size() const {
+  return header != nullptr ? header->count : 0;
+}
+
+ll SnapshotView::getHash() const {
+  return header != nullptr ? header->rootHash : 0;
+}
+
+ll SnapshotView::getChecksum() const {
+  return header != nullptr ? header->checksum : 0;
+}
+
+// index of key k, or -1 if absent 
+int SnapshotView::indexOf(int k) const {
+  int lo = 0, hi = size() - 1;
+  while (lo <= hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (keys[mid] == k) return mid;
+    if (keys[mid] < k)
+      lo = mid + 1;
+    else 
+      hi = mid - 1;
+  }
+  return -1;
+}
+
+bool SnapshotView::contains(int k) const {
+  return indexOf(k) >= 0;
+}
+
+void SnapshotView::toTree(SplayTree &t) const {
+  int n = size();
+  std::vector<STNode *> nodes(n);
+  for (int i = 0; i < n; i++) {
+    STNode * node = t.allocNode(keys[i]);
+    node->count = node->weight = countAt(i);
+    if (aug != nullptr) {
+      node->size = aug[i].size;
+      node->weight = aug[i].weight;
+      node->hash = aug[i].hash;
+    }
+    nodes[i] = node;
+  }
+  t.buildFromSorted(nodes, aug == nullptr);
+}
+
+bool loadSnapshot(const std::string &path, SplayTree &t) {
+  SnapshotView view;
+  if (! view.open(path)) return false;
+  view.toTree(t);
+  return true;
+}
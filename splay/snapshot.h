@@ -0,0 +1,117 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "splay.h"
+
+// binary snapshot of a splay tree 
+//
+// layout (native byte order, every section 
+// starts on an 8-byte boundary): 
+//
+//   SnapshotHeader 
+//   int32_t     keys[count]    sorted, distinct 
+//   int32_t     counts[count]  if SNAPSHOT_COUNTS 
+//   SnapshotAug aug[count]     if SNAPSHOT_AUG 
+//
+// the aug section holds size/weight/hash of every 
+// node of the balanced tree that SnapshotView::toTree 
+// builds (the middle key of each range is its root), 
+// so a loaded tree needs no hashing at all. 
+// that is also the tree a binary search over 
+// the mapped keys walks, so a SnapshotView 
+// can be served read-only straight from the page cache. 
+//
+// the checksum covers everything after the header. 
+
+const char SNAPSHOT_MAGIC[8] = {'S','P','L','A','Y','S','N','P'};
+const uint32_t SNAPSHOT_VERSION = 1;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+// flags 
+const uint32_t SNAPSHOT_COUNTS = 1;
+const uint32_t SNAPSHOT_AUG    = 2;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t count;
+  uint64_t rootHash;
+  uint64_t checksum;
+  uint32_t byteOrder;
+  // SPLAY_HASH_MODE of the writer; rootHash and 
+  // aug hashes are meaningless under another mode 
+  uint32_t hashMode;
+};
+
+struct SnapshotAug {
+  int32_t size;
+  int32_t weight;
+  uint64_t hash;
+};
+
+// 64-bit FNV-1a, can be chained through h 
+const ll FNV_OFFSET = 14695981039346656037ULL;
+ll checksumBytes(const void * data, size_t len, ll h = FNV_OFFSET);
+
+// append keys and counts of subtree in inorder 
+void collectInorder(const STNode * node, 
+                    std::vector<int32_t> &keys, 
+                    std::vector<int32_t> &counts);
+
+// write t to path in one inorder pass. 
+// returns false on I/O error. the file's 
+// checksum is stored in *checksum if given 
+bool writeSnapshot(const SplayTree &t, const std::string &path, 
+                   bool withAug = false, ll * checksum = nullptr);
+
+// read-only view of a snapshot file through mmap 
+class SnapshotView {
+  private:
+    void * base;
+    size_t length;
+
+    const SnapshotHeader * header;
+    const int32_t * keys;
+    const int32_t * counts;
+    const SnapshotAug * aug;
+
+  public:
+    SnapshotView();
+    ~SnapshotView();
+
+    // map file and check header (and checksum, 
+    // which reads the whole file). 
+    // returns false if the file is missing or invalid 
+    bool open(const std::string &path, bool verifyChecksum = true);
+    void close();
+    bool isOpen() const { return base != nullptr; }
+
+    int size() const;
+    ll getHash() const;
+    // checksum of the file's sections, i.e. 
+    // of its keys and counts (and aug) 
+    ll getChecksum() const;
+    bool hasAug() const { return aug != nullptr; }
+
+    // i-th smallest key and its multiplicity 
+    int keyAt(int i) const { return keys[i]; }
+    int countAt(int i) const { return counts != nullptr ? counts[i] : 1; }
+
+    // binary search on the mapped keys 
+    bool contains(int k) const;
+    int indexOf(int k) const;
+
+    // build a mutable tree in O(n) without splaying. 
+    // precondition: t is empty 
+    void toTree(SplayTree &t) const;
+};
+
+// open + toTree 
+bool loadSnapshot(const std::string &path, SplayTree &t);
+
+#endif
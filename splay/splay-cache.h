@@ -0,0 +1,422 @@
+#ifndef SPLAY_CACHE_H
+#define SPLAY_CACHE_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// ordered key -> value cache with a capacity in
+// entries and/or bytes.
+//
+// entries live in a splay tree ordered by key, so
+// get/put/erase are O(log n) amortized and recently
+// used entries sit near the root. each node is also
+// on an intrusive recency list (most recent first),
+// so one allocation per entry holds the key, the
+// value, the tree links and the list links, where
+// std::map plus an LRU std::list needs two nodes
+// and a map from one to the other.
+//
+// when a put goes over capacity, the least recently
+// used entries are evicted in one batch, down to
+// (1 - batchFraction) of the capacity, so the tree
+// isn't restructured on every put. a batch of at
+// least a quarter of the entries rebuilds the tree
+// from the survivors in one pass instead of
+// unlinking the victims one by one.
+//
+// scans visit keys in order and don't count as
+// uses. K needs operator<.
+
+struct SplayCacheStats {
+  size_t entries;
+  size_t bytes;
+  long long hits;
+  long long misses;
+  long long evictions;
+  // eviction batches, and how many rebuilt the tree
+  long long batches;
+  long long rebuilds;
+
+  double hitRate() const {
+    long long n = hits + misses;
+    return n == 0 ? 0 : (double) hits / n;
+  }
+};
+
+template <typename K, typename V>
+class SplayCache {
+  private:
+    struct Node {
+      Node * left;
+      Node * right;
+      Node * parent;
+      // recency list, most recent first.
+      // prev == this marks a batch victim
+      Node * prev;
+      Node * next;
+      K key;
+      V value;
+      // bytes charged for this entry
+      size_t bytes;
+
+      Node(const K &k, const V &v, size_t b)
+        : left(nullptr), right(nullptr), parent(nullptr),
+          prev(nullptr), next(nullptr), key(k), value(v), bytes(b) { }
+    };
+
+    Node * root;
+    Node * head;
+    Node * tail;
+
+    size_t maxEntries;
+    size_t maxBytes;
+    double batchFraction;
+
+    size_t entries;
+    size_t bytes;
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long batches;
+    long long rebuilds;
+
+    // same steps as SplayTree::rotate/splay,
+    // without augmentations to update
+    void rotate(Node * x) {
+      Node * p = x->parent;
+      Node * gp = p->parent;
+      if (p->left == x) {
+        p->left = x->right;
+        if (p->left != nullptr) p->left->parent = p;
+        x->right = p;
+      } else {
+        p->right = x->left;
+        if (p->right != nullptr) p->right->parent = p;
+        x->left = p;
+      }
+      p->parent = x;
+      x->parent = gp;
+      if (gp != nullptr) {
+        if (gp->left == p) gp->left = x;
+        else gp->right = x;
+      }
+    }
+
+    void splay(Node * x) {
+      while (x->parent != nullptr) {
+        Node * p = x->parent;
+        if (p->parent == nullptr)
+          rotate(x);
+        else if ((p->left == x) == (p->parent->left == p)) {
+          rotate(p);
+          rotate(x);
+        }
+        else {
+          rotate(x);
+          rotate(x);
+        }
+      }
+      root = x;
+    }
+
+    // node with key k, or null. last is the
+    // last node on the search path
+    Node * descend(const K &k, Node *& last) {
+      last = nullptr;
+      Node * cur = root;
+      while (cur != nullptr) {
+        last = cur;
+        if (k < cur->key) cur = cur->left;
+        else if (cur->key < k) cur = cur->right;
+        else return cur;
+      }
+      return nullptr;
+    }
+
+    void listUnlink(Node * n) {
+      if (n->prev != nullptr) n->prev->next = n->next;
+      else head = n->next;
+      if (n->next != nullptr) n->next->prev = n->prev;
+      else tail = n->prev;
+      n->prev = n->next = nullptr;
+    }
+
+    void listPushFront(Node * n) {
+      n->prev = nullptr;
+      n->next = head;
+      if (head != nullptr) head->prev = n;
+      head = n;
+      if (tail == nullptr) tail = n;
+    }
+
+    void touch(Node * n) {
+      if (head == n) return;
+      listUnlink(n);
+      listPushFront(n);
+    }
+
+    // splay n up, then join its subtrees
+    void treeUnlink(Node * n) {
+      splay(n);
+      Node * l = n->left;
+      Node * r = n->right;
+      if (l == nullptr) {
+        root = r;
+        if (r != nullptr) r->parent = nullptr;
+        return;
+      }
+      l->parent = nullptr;
+      Node * m = l;
+      while (m->right != nullptr) m = m->right;
+      splay(m);
+      m->right = r;
+      if (r != nullptr) r->parent = m;
+    }
+
+    bool overCapacity(size_t e, size_t b) const {
+      return (maxEntries > 0 && e > maxEntries)
+          || (maxBytes > 0 && b > maxBytes);
+    }
+
+    // balanced tree over nodes[lo, hi)
+    static Node * build(std::vector<Node*> &nodes, int lo, int hi, Node * parent) {
+      if (lo >= hi) return nullptr;
+      int mid = lo + (hi - lo) / 2;
+      Node * n = nodes[mid];
+      n->parent = parent;
+      n->left = build(nodes, lo, mid, n);
+      n->right = build(nodes, mid + 1, hi, n);
+      return n;
+    }
+
+    // nodes in key order, iteratively
+    template <typename F>
+    void inorder(F f) {
+      Node * cur = root;
+      std::vector<Node*> stack;
+      while (cur != nullptr || ! stack.empty()) {
+        while (cur != nullptr) {
+          stack.push_back(cur);
+          cur = cur->left;
+        }
+        cur = stack.back();
+        stack.pop_back();
+        Node * right = cur->right;
+        f(cur);
+        cur = right;
+      }
+    }
+
+    static Node * successor(Node * n) {
+      if (n->right != nullptr) {
+        n = n->right;
+        while (n->left != nullptr) n = n->left;
+        return n;
+      }
+      while (n->parent != nullptr && n->parent->right == n)
+        n = n->parent;
+      return n->parent;
+    }
+
+    // evict from the tail until below the low
+    // water mark, keeping at least the head
+    void evictBatch() {
+      size_t keepEntries = maxEntries - (size_t) (maxEntries * batchFraction);
+      size_t keepBytes = maxBytes - (size_t) (maxBytes * batchFraction);
+      size_t e = entries, b = bytes;
+      std::vector<Node*> victims;
+      for (Node * n = tail; n != head; n = n->prev) {
+        bool over = (maxEntries > 0 && e > keepEntries)
+                 || (maxBytes > 0 && b > keepBytes);
+        if (! over) break;
+        victims.push_back(n);
+        e--;
+        b -= n->bytes;
+      }
+      if (victims.empty()) return;
+
+      batches++;
+      for (Node * n : victims)
+        listUnlink(n);
+
+      if (4 * victims.size() >= entries) {
+        // mark the victims and rebuild from the rest
+        for (Node * n : victims)
+          n->prev = n;
+        std::vector<Node*> keep;
+        keep.reserve(e);
+        inorder([&](Node * n) {
+          if (n->prev != n) keep.push_back(n);
+        });
+        root = build(keep, 0, keep.size(), nullptr);
+        rebuilds++;
+      } else {
+        for (Node * n : victims)
+          treeUnlink(n);
+      }
+
+      for (Node * n : victims)
+        delete n;
+      evictions += victims.size();
+      entries = e;
+      bytes = b;
+    }
+
+  public:
+    // 0 means no limit. an entry is charged
+    // sizeof its node plus the bytes passed to put
+    SplayCache(size_t maxEntries, size_t maxBytes = 0, double batchFraction = 1.0 / 16)
+      : root(nullptr),
+        head(nullptr),
+        tail(nullptr),
+        maxEntries(maxEntries),
+        maxBytes(maxBytes),
+        batchFraction(batchFraction),
+        entries(0),
+        bytes(0),
+        hits(0),
+        misses(0),
+        evictions(0),
+        batches(0),
+        rebuilds(0) {
+      assert(batchFraction >= 0 && batchFraction < 1);
+    }
+
+    SplayCache(const SplayCache &) = delete;
+    SplayCache & operator=(const SplayCache &) = delete;
+
+    ~SplayCache() { clear(); }
+
+    // the cached value, or null. a hit makes the
+    // entry the most recent. the pointer is good
+    // until the next put or erase
+    V * get(const K &k) {
+      Node * last;
+      Node * n = descend(k, last);
+      if (n == nullptr) {
+        // splay the end of the search path
+        // to pay for the descent
+        if (last != nullptr) splay(last);
+        misses++;
+        return nullptr;
+      }
+      splay(n);
+      touch(n);
+      hits++;
+      return &n->value;
+    }
+
+    // insert or replace. extraBytes is charged on
+    // top of the node, e.g. for the value's heap
+    // memory. may evict a batch of other entries
+    void put(const K &k, const V &v, size_t extraBytes = 0) {
+      size_t charge = sizeof(Node) + extraBytes;
+      Node * last;
+      Node * n = descend(k, last);
+      if (n != nullptr) {
+        n->value = v;
+        bytes = bytes - n->bytes + charge;
+        n->bytes = charge;
+        splay(n);
+        touch(n);
+      } else {
+        n = new Node(k, v, charge);
+        n->parent = last;
+        if (last != nullptr) {
+          if (k < last->key) last->left = n;
+          else last->right = n;
+        }
+        splay(n);
+        listPushFront(n);
+        entries++;
+        bytes += charge;
+      }
+
+      if (overCapacity(entries, bytes))
+        evictBatch();
+    }
+
+    bool erase(const K &k) {
+      Node * last;
+      Node * n = descend(k, last);
+      if (n == nullptr) {
+        if (last != nullptr) splay(last);
+        return false;
+      }
+      treeUnlink(n);
+      listUnlink(n);
+      entries--;
+      bytes -= n->bytes;
+      delete n;
+      return true;
+    }
+
+    bool contains(const K &k) {
+      Node * last;
+      Node * n = descend(k, last);
+      if (last != nullptr) splay(last);
+      return n != nullptr;
+    }
+
+    // f(key, value) for every key in [lo, hi], in order
+    template <typename F>
+    void scan(const K &lo, const K &hi, F f) {
+      // lowest key >= lo
+      Node * first = nullptr;
+      Node * last = nullptr;
+      for (Node * cur = root; cur != nullptr; ) {
+        last = cur;
+        if (cur->key < lo) cur = cur->right;
+        else {
+          first = cur;
+          cur = cur->left;
+        }
+      }
+      if (last != nullptr) splay(last);
+
+      for (Node * n = first; n != nullptr && ! (hi < n->key); n = successor(n))
+        f(n->key, (const V &) n->value);
+    }
+
+    // f(key, value) for every entry, in order
+    template <typename F>
+    void forEach(F f) {
+      inorder([&](Node * n) { f(n->key, (const V &) n->value); });
+    }
+
+    // keys from most to least recently used
+    void getRecency(std::vector<K> &keys) const {
+      for (Node * n = head; n != nullptr; n = n->next)
+        keys.push_back(n->key);
+    }
+
+    void clear() {
+      Node * n = head;
+      while (n != nullptr) {
+        Node * next = n->next;
+        delete n;
+        n = next;
+      }
+      root = head = tail = nullptr;
+      entries = bytes = 0;
+    }
+
+    size_t getSize() const { return entries; }
+    size_t getBytes() const { return bytes; }
+    static size_t nodeBytes() { return sizeof(Node); }
+
+    SplayCacheStats getStats() const {
+      SplayCacheStats s;
+      s.entries = entries;
+      s.bytes = bytes;
+      s.hits = hits;
+      s.misses = misses;
+      s.evictions = evictions;
+      s.batches = batches;
+      s.rebuilds = rebuilds;
+      return s;
+    }
+};
+
+#endif
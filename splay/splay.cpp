@@ -3,6 +3,19 @@
 #include <assert.h>
 #include <iostream>
 #include <string>
+#include <climits>
+#include <algorithm>
+#include <new>
+
+// statistics hooks (see stats.h), 
+// no-ops unless compiled with -DSPLAY_STATS 
+#ifdef SPLAY_STATS
+#define STAT_OP(op) StatScope statScope(stats.get(), op)
+#define STAT(stmt) stmt
+#else
+#define STAT_OP(op)
+#define STAT(stmt)
+#endif
 
 
 // TODO 
@@ -11,9 +24,7 @@
 // - make SplayTree work for general type 
 //   with comparator 
 // - implement upperBound(), lowerBound() 
-// - multiset 
 // - range counting 
-// - rank, select 
 
 // binary exponentiation 
 // from cp-algorithms 
@@ -32,31 +43,186 @@ ll binpow(ll a, ll b) {
 // - delete all dynamically-allocated nodes 
 //   in the tree by deleting the root 
 SplayTree::~SplayTree() {
-  if (root == nullptr) return;
-  delete root;
+  freeSubtree(root);
 }
 
+// delete every node in subtree without recursion 
+//
+// (deleting the root directly recurses through 
+// ~STNode, which can overflow the stack 
+// on a path-shaped subtree) 
+//
+// the left child is rotated up until the 
+// current node has no left child, then the 
+// node is deleted and we continue on its right. 
+// each rotation puts one more node on the 
+// right spine, so this is O(n) with O(1) space 
+void SplayTree::freeSubtree(STNode * node) {
+  while (node != nullptr) {
+    if (node->hasLeftChild()) {
+      STNode * l = node->left;
+      node->left = l->right;
+      l->right = node;
+      node = l;
+    }
+    else {
+      STNode * next = node->right;
+      node->right = nullptr;
+      freeNode(node);
+      node = next;
+    }
+  }
+}
 
 
+
+// nodes with or without an allocator. a node's 
+// children are cleared before it's destroyed, 
+// since ~STNode deletes them 
+static STNode * makeNode(int k, NodeAllocator * a) {
+  if (a == nullptr) return new STNode(k);
+  return new (a->allocate()) STNode(k);
+}
+
+static void releaseNode(STNode * node, NodeAllocator * a) {
+  node->left = node->right = nullptr;
+  if (a == nullptr) {
+    delete node;
+    return;
+  }
+  node->~STNode();
+  a->release(node);
+}
+
+// every node this tree allocates or frees goes 
+// through these two, so the stats count them here 
+STNode * SplayTree::allocNode(int k) {
+  STAT(stats->nodeAllocs++);
+  return makeNode(k, allocator);
+}
+
+void SplayTree::freeNode(STNode * node) {
+  STAT(stats->nodeFrees++);
+  releaseNode(node, allocator);
+}
+
 // compare based on hash
 //
 // - O(n) worst case, but collisions should be rare 
+// - if hashes (and sizes) match, both trees are 
+//   walked in order in lockstep with parent pointers, 
+//   so nothing is allocated and the walk stops 
+//   at the first difference 
 bool operator== (const SplayTree& t1, const SplayTree& t2) {
   // if addresses are same, same tree
   if (&t1 == &t2) return true;
 
   // different hashes -> different trees 
   if (t1.getHash() != t2.getHash()) return false;
+  if (t1.getSize() != t2.getSize()) return false;
+  if (t1.getWeight() != t2.getWeight()) return false;
+
+  // if hashes match, manually check keys (and counts)
+  STNode * a = t1.peekMin();
+  STNode * b = t2.peekMin();
+  while (a != nullptr && b != nullptr) {
+    if (a->key != b->key || a->count != b->count) return false;
+    a = a->successor();
+    b = b->successor();
+  }
+  return a == nullptr && b == nullptr;
+}
 
-  // // if hashes match, manually check keys 
-  std::vector<int> v1, v2; 
-  t1.getInorder(v1);
-  t2.getInorder(v2);
+// ranges with at most this many keys on 
+// both sides are compared key by key 
+const int DIFF_LEAF_SIZE = 16;
 
-  if (v1.size() != v2.size()) return false;
-  for (int i = 0; i < v1.size(); i++)
-    if (v1[i] != v2[i]) return false;
-  return true;
+// (key, count) pairs of a subtree in order 
+static void getKeyCounts(const STNode * node, std::vector<std::pair<int, int> > &v) {
+  if (node == nullptr) return;
+  getKeyCounts(node->left, v);
+  v.push_back(std::make_pair(node->key, node->count));
+  getKeyCounts(node->right, v);
+}
+
+// append [lo, hi] to out, merging with the 
+// previous range if they touch 
+static void addRange(std::vector<std::pair<int, int> > &out, int lo, int hi) {
+  if (! out.empty() && (long long) out.back().second + 1 >= lo) {
+    if (hi > out.back().second)
+      out.back().second = hi;
+    return;
+  }
+  out.push_back(std::make_pair(lo, hi));
+}
+
+// merge two small sorted ranges and emit runs 
+// of consecutive keys that differ 
+static void diffLeaf(const STNode * ra, const STNode * rb, 
+                     std::vector<std::pair<int, int> > &out) {
+  std::vector<std::pair<int, int> > va, vb;
+  getKeyCounts(ra, va);
+  getKeyCounts(rb, vb);
+
+  bool inRun = false;
+  int i = 0, j = 0;
+  while (i < va.size() || j < vb.size()) {
+    int k;
+    bool differs = true;
+    if (j == vb.size() || (i < va.size() && va[i].first < vb[j].first)) 
+      k = va[i++].first;
+    else if (i == va.size() || vb[j].first < va[i].first) 
+      k = vb[j++].first;
+    else {
+      k = va[i].first;
+      differs = va[i++].second != vb[j++].second;
+    }
+
+    if (! differs) 
+      inRun = false;
+    else if (inRun)
+      out.back().second = k;
+    else {
+      addRange(out, k, k);
+      inRun = true;
+    }
+  }
+}
+
+// compare keys of a and b in [lo, hi] 
+static void diffRange(SplayTree &a, SplayTree &b, long long lo, long long hi, 
+                      std::vector<std::pair<int, int> > &out) {
+  STNode * ra = a.isolateRange(lo, hi);
+  STNode * rb = b.isolateRange(lo, hi);
+
+  int sa = ra ? ra->size : 0, sb = rb ? rb->size : 0;
+  int wa = ra ? ra->weight : 0, wb = rb ? rb->weight : 0;
+  ll ha = ra ? ra->hash : 0, hb = rb ? rb->hash : 0;
+  if (sa == sb && wa == wb && ha == hb) return;
+
+  // every key on the non-empty side differs 
+  if (sa == 0 || sb == 0) {
+    STNode * r = sa == 0 ? rb : ra;
+    addRange(out, r->minimumLeaf()->key, r->maximumLeaf()->key);
+    return;
+  }
+
+  if ((sa <= DIFF_LEAF_SIZE && sb <= DIFF_LEAF_SIZE) || lo == hi) {
+    diffLeaf(ra, rb, out);
+    return;
+  }
+
+  // lo + hi can overflow an int 
+  long long mid = lo + (hi - lo) / 2;
+  diffRange(a, b, lo, mid, out);
+  diffRange(a, b, mid + 1, hi, out);
+}
+
+std::vector<std::pair<int, int> > diff(SplayTree &a, SplayTree &b) {
+  std::vector<std::pair<int, int> > out;
+  if (&a != &b)
+    diffRange(a, b, INT_MIN, INT_MAX, out);
+  return out;
 }
 
 // delete left and right subtree pointers
@@ -76,6 +242,7 @@ void STNode::updateAugmentations() {
   // bc polynomial hash computation
   // uses sizes 
   updateSizeFromChildren();
+  updateWeightFromChildren();
   updateHashFromChildren();
 }
 
@@ -93,16 +260,68 @@ void STNode::updateHashFromChildren() {
 
   ll rhash = hasRightChild() ? right->hash : 0;
 
-  // TODO precomputing powers of p could speed up 
-  //
-  // hash of this node is 
-  // (left hash...) 
-  // + key * p^ln 
-  // + p^(ln+1) * (right hash...)
-  hash = lhash 
-         + (key*binpow(P, ln) % M)
-         + (rhash*binpow(P, ln+1) % M);
-  hash = hash % M; 
+  hash = combineHash(lhash, ln, key, rhash);
+}
+
+// hash of a subtree from the hash and size 
+// of its left subtree, its root key and 
+// the hash of its right subtree 
+//
+// TODO precomputing powers of p could speed up 
+//
+// hash of this node is 
+// (left hash...) 
+// + key * p^ln 
+// + p^(ln+1) * (right hash...)
+ll combineHash(ll lhash, ll ln, int key, ll rhash) {
+  ll hash = hashAdd(lhash, hashMul(hashKey(key), hashPow(ln)));
+  return hashAdd(hash, hashMul(rhash, hashPow(ln+1)));
+}
+
+#ifdef SPLAY_HASH_M61
+
+// a*b mod 2^61 - 1: 
+// since 2^61 = 1 (mod M), the high bits of 
+// the 122-bit product can be folded onto the low bits 
+ll hashMul(ll a, ll b) {
+  unsigned __int128 x = (unsigned __int128) a * b;
+  ll r = (ll) (x & M) + (ll) (x >> 61);
+  return r >= M ? r - M : r;
+}
+
+ll hashAdd(ll a, ll b) {
+  ll r = a + b;
+  return r >= M ? r - M : r;
+}
+
+#else
+
+// M = 2^63 divides 2^64, so reducing the 
+// wrapped 64-bit result gives the right answer 
+ll hashMul(ll a, ll b) {
+  return (a * b) % M;
+}
+
+ll hashAdd(ll a, ll b) {
+  return (a + b) % M;
+}
+
+#endif
+
+ll hashKey(int key) {
+  return ((ll) key) % M;
+}
+
+ll hashPow(ll e) {
+  ll res = 1;
+  ll a = P % M;
+  while (e > 0) {
+    if (e & 1)
+      res = hashMul(res, a);
+    a = hashMul(a, a);
+    e >>= 1;
+  }
+  return res;
 }
 
 ll SplayTree::getHash() const {
@@ -115,14 +334,25 @@ int SplayTree::getSize() const {
   return root->size;
 }
 
+int SplayTree::getWeight() const {
+  if (root == nullptr) return 0;
+  return root->weight;
+}
+
 void _getInorder(const SplayTree& t, std::vector<int> &v) {
   if (t.root != nullptr)
     t.root->getInorder(v);
 }
 
+// appends the keys in order. root->size is the 
+// exact number of keys, and the walk follows 
+// successors, so there is no recursion 
+// (see parallel.h for a multithreaded version) 
 void SplayTree::getInorder(std::vector<int> &v) const {
-  if (root != nullptr)
-    root->getInorder(v);
+  if (root == nullptr) return;
+  v.reserve(v.size() + root->size);
+  for (STNode * n = minNode; n != nullptr; n = n->successor())
+    v.push_back(n->key);
 }
 
 void _getInorder(const STNode& t, std::vector<int> &v) {
@@ -152,6 +382,16 @@ void STNode::updateSizeFromChildren() {
   size = subtreeSize;
 }
 
+// set weight to lweight + count + rweight 
+void STNode::updateWeightFromChildren() {
+  int subtreeWeight = count; 
+  if (hasLeftChild())
+    subtreeWeight += left->weight;
+  if (hasRightChild())
+    subtreeWeight += right->weight;
+  weight = subtreeWeight;
+}
+
 // update all subtree sizes 
 // from this node to root 
 void STNode::updateAugToRoot() {
@@ -335,10 +575,12 @@ bool STNode::zigZag() {
 
 
 // splay until node is root 
+// (or, if top is given, until node 
+// is a child of top) 
 //
 // (no grandp) 
-// if node has parent but no grandparent, 
-// rotate at node->parent
+// if node has parent but no grandparent 
+// (below top), rotate at node->parent
 //
 // (zigzig)
 //
@@ -370,17 +612,19 @@ bool STNode::zigZag() {
 // rotate at node->parent
 // then 
 // rotate at the old grandparent 
-void SplayTree::splay(STNode *node) {
+void SplayTree::splay(STNode *node, STNode *top) {
   if (node == nullptr) { 
     assert(false);
     return;
   }
-  // splay until cur becomes root 
+  // splay until cur becomes root (child of top)
   STNode * cur = node;
-  while (cur->hasParent()) {
+  while (cur->parent != top) {
     // no grandparent 
-    if (! cur->hasGrandP())
+    if (cur->parent->parent == top) {
       cur->rotate();
+      STAT(stats->zigSteps++; stats->rotations++);
+    }
     else {
       // cur has grandparent and therefore 
       // cur has a parent 
@@ -389,23 +633,47 @@ void SplayTree::splay(STNode *node) {
       if (cur->zigZig()) {
         p->rotate();
         cur->rotate();
+        STAT(stats->zigZigSteps++; stats->rotations += 2);
       }
       // left/right or right/left 
       else if (cur->zigZag()) {
         cur->rotate();
         cur->rotate();
+        STAT(stats->zigZagSteps++; stats->rotations += 2);
       }
     }
   }
 
   // update root 
-  root = node;
+  if (top == nullptr)
+    root = node;
 }
 
 // insert new node with key k in splay tree 
 void SplayTree::insert(int k) {
+  STAT_OP(STAT_INSERT);
+  _insertKey(k);
+
+  for (TreeObserver * o : observers)
+    o->onInsert(k, 1);
+}
+
+void SplayTree::addObserver(TreeObserver * o) {
+  observers.push_back(o);
+}
+
+void SplayTree::removeObserver(TreeObserver * o) {
+  for (int i = 0; i < observers.size(); i++) {
+    if (observers[i] == o) {
+      observers.erase(observers.begin() + i);
+      return;
+    }
+  }
+}
+
+void SplayTree::_insertKey(int k) {
   // try finding first (without splaying)
-  STNode * n = _find(root, k);
+  STNode * n = _lookup(root, k);
   if (n != nullptr) {
     // TODO handle multiple of same key.. just use count?
     assert(false);
@@ -415,6 +683,8 @@ void SplayTree::insert(int k) {
   root->parent = nullptr;
 
   assert(insertedNodePtr != nullptr);
+  updateExtremes(insertedNodePtr);
+  keyLinked(k);
   // splay after inserting 
   splay(insertedNodePtr);
   insertedNodePtr = nullptr;
@@ -468,6 +738,14 @@ void SplayTree::replaceNode(STNode * n, STNode * m) {
 // remove a particular node 
 void SplayTree::removeNode(STNode * node) {
   assert(node != nullptr);
+  keyUnlinked(node->key);
+
+  // move cached extremes off the node 
+  // before its neighbours change 
+  if (node == minNode)
+    minNode = node->successor();
+  if (node == maxNode)
+    maxNode = node->predecessor();
 
   STNode * nodeToSplay = node->parent;
 
@@ -546,25 +824,136 @@ void SplayTree::removeNode(STNode * node) {
 
 // remove a node with key k 
 void SplayTree::remove(int k) {
+  STAT_OP(STAT_REMOVE);
   // find without splaying 
-  STNode * node = _find(root, k);
+  STNode * node = _lookup(root, k);
   if (node == nullptr) return; 
 
+  detachNode(node);
+
+  // deallocate memory for removed node. 
+  // its children were reset by detachNode, 
+  // so only this node is deleted 
+  freeNode(node);
+
+  for (TreeObserver * o : observers)
+    o->onRemove(k);
+}
+
+// unlink node from the tree and reset it to 
+// a single-node subtree so it can be 
+// deleted or linked in again 
+//
+// N.B. we have to set its left/right ptrs 
+// to null, otherwise deleting it would 
+// delete an entire subtree 
+void SplayTree::detachNode(STNode * node) {
   removeNode(node);
 
-  // deallocate memory for removed node 
-  //
-  // N.B. we have to set its left/right ptrs 
-  // to null first, otherwise an entire subtree is deleted
-  if (node->hasParent()) {
-    if (node->parent->left == node)
-      node->parent->left == nullptr;
-    if (node->parent->right == node)
-      node->parent->right == nullptr;
-  }
   node->left = nullptr; 
   node->right = nullptr;
-  delete node;
+  node->parent = nullptr;
+  node->updateAugmentations();
+}
+
+NodeHandle & NodeHandle::operator=(NodeHandle &&other) {
+  if (this != &other) {
+    if (node != nullptr)
+      releaseNode(node, allocator);
+    node = other.node;
+    allocator = other.allocator;
+    other.node = nullptr;
+  }
+  return *this;
+}
+
+NodeHandle::~NodeHandle() {
+  if (node != nullptr)
+    releaseNode(node, allocator);
+}
+
+int & NodeHandle::key() {
+  assert(node != nullptr);
+  return node->key;
+}
+
+// take node with key k out of the tree 
+NodeHandle SplayTree::extract(int k) {
+  STAT_OP(STAT_REMOVE);
+  STNode * node = _lookup(root, k);
+  if (node == nullptr) return NodeHandle();
+
+  detachNode(node);
+
+  for (TreeObserver * o : observers)
+    o->onRemove(k);
+  return NodeHandle(node, allocator);
+}
+
+// re-link node owned by nh 
+bool SplayTree::insert(NodeHandle &&nh) {
+  STAT_OP(STAT_INSERT);
+  if (nh.empty()) return false;
+
+  // a node from another allocator is copied 
+  // into one of ours 
+  if (nh.allocator != allocator) {
+    STNode * copy = allocNode(nh.node->key);
+    copy->count = nh.node->count;
+    copy->accesses = nh.node->accesses;
+    releaseNode(nh.node, nh.allocator);
+    nh.node = copy;
+    nh.allocator = allocator;
+  }
+
+  // key may have changed since extraction 
+  nh.node->updateAugmentations();
+
+  if (! _insertNode(nullptr, nh.node))
+    return false;
+
+  for (TreeObserver * o : observers)
+    o->onInsert(nh.node->key, nh.node->count);
+  nh.node = nullptr;
+  return true;
+}
+
+// change a key without reallocating its node 
+//
+// if newKey still lies between the predecessor 
+// and successor of the node, the key is changed 
+// in place: after splaying the node to the root 
+// only the root's hash depends on its key. 
+// otherwise the node is extracted and re-linked. 
+bool SplayTree::rekey(int oldKey, int newKey) {
+  STNode * node = _lookup(root, oldKey);
+  if (node == nullptr) return false;
+  if (oldKey == newKey) return true;
+  if (_lookup(root, newKey) != nullptr) return false;
+
+  splay(node);
+  bool aboveLeft = ! node->hasLeftChild() 
+                   || node->left->maximumLeaf()->key < newKey;
+  bool belowRight = ! node->hasRightChild() 
+                   || node->right->minimumLeaf()->key > newKey;
+
+  if (aboveLeft && belowRight) {
+    node->key = newKey;
+    node->updateAugmentations();
+    keyUnlinked(oldKey);
+    keyLinked(newKey);
+  }
+  else {
+    detachNode(node);
+    node->key = newKey;
+    node->updateAugmentations();
+    bool inserted = _insertNode(nullptr, node);
+    assert(inserted);
+  }
+
+  for (TreeObserver * o : observers)
+    o->onRekey(oldKey, newKey);
+  return true;
 }
 
 // swap two nodes, where first argument 
@@ -576,6 +965,12 @@ void SplayTree::swapNodeValues(STNode * n, STNode * m) {
   // }
   // assert(m != root);
   assert(n != nullptr && m != nullptr);
+  // the key set is the same, but cached 
+  // entries would point to the wrong nodes 
+  if (hotCache != nullptr) {
+    hotCache->invalidate(n->key);
+    hotCache->invalidate(m->key);
+  }
 
   int t = n->key;
   n->key = m->key;
@@ -596,6 +991,31 @@ STNode * STNode::minimumLeaf() {
   return this;
 }
 
+// inorder successor: 
+// - leftmost node of right subtree, or 
+// - first ancestor that has this node 
+//   in its left subtree 
+STNode * STNode::successor() {
+  if (hasRightChild())
+    return right->minimumLeaf();
+
+  STNode * cur = this;
+  while (cur->isRightChild())
+    cur = cur->parent;
+  return cur->parent;
+}
+
+// inorder predecessor (mirror of successor)
+STNode * STNode::predecessor() {
+  if (hasLeftChild())
+    return left->maximumLeaf();
+
+  STNode * cur = this;
+  while (cur->isLeftChild())
+    cur = cur->parent;
+  return cur->parent;
+}
+
 // insert new node with key k in 
 // subtree rooted at node and
 // return a pointer to the root
@@ -606,12 +1026,13 @@ STNode * STNode::minimumLeaf() {
 //   subtree rooted at node 
 STNode* SplayTree::_insert(STNode* node, int k) {
   if (node == nullptr) { 
-    STNode * newNode = new STNode(k); 
+    STNode * newNode = allocNode(k); 
     // set insertedNodePtr so new node 
     // can be splayed after insertion 
     insertedNodePtr = newNode;
     return newNode;
   }
+  STAT(stats->descentNodes++);
 
   if (k < node->key) 
     node->setLeftChild(_insert(node->left, k));
@@ -629,7 +1050,24 @@ STNode* SplayTree::_insert(STNode* node, int k) {
 
 // find node with key k in splay tree 
 STNode * SplayTree::find(int k) {
-  STNode* n = _find(root, k);
+  STAT_OP(STAT_FIND);
+  STNode * n = hotCache != nullptr ? hotCache->lookup(k) : nullptr;
+  if (n == nullptr) {
+    n = frozen ? _lookup(root, k) : _findAndSplay(k);
+    if (n != nullptr && hotCache != nullptr)
+      hotCache->store(k, n);
+  }
+  if (n != nullptr)
+    recordAccess(n);
+
+  for (TreeObserver * o : observers)
+    o->onFind(k);
+  return n;
+}
+
+// find(k) without notifying observers 
+STNode * SplayTree::_findAndSplay(int k) {
+  STNode* n = _lookup(root, k);
 
   // splay after accessing
   if (n != nullptr) 
@@ -638,9 +1076,722 @@ STNode * SplayTree::find(int k) {
   return n;
 }
 
+// walk up from node to the lowest ancestor 
+// whose subtree must contain k (if k is present). 
+//
+// going up from a left child, the parent key 
+// is an upper bound for the child's subtree. 
+// so if k > node->key and k < parent->key, 
+// k can only be in node's right subtree. 
+// (mirror for right children)
+//
+// if no such ancestor exists we end up 
+// at the root, which contains everything 
+STNode * SplayTree::_fingerStart(STNode * node, int k) {
+  if (node == nullptr) return root;
+
+  while (node->hasParent()) {
+    if (k == node->key) break;
+
+    STNode * p = node->parent;
+    if (k > node->key && node->isLeftChild() && k < p->key) break;
+    if (k < node->key && node->isRightChild() && k > p->key) break;
+    node = p;
+  }
+  return node;
+}
+
+// find key k starting from finger f 
+STNode * SplayTree::find(int k, Finger &f) {
+  STAT_OP(STAT_FIND);
+  STNode * n = _lookup(_fingerStart(f.node, k), k);
+
+  if (n != nullptr) {
+    if (! frozen)
+      splay(n);
+    f.node = n;
+    recordAccess(n);
+  }
+
+  for (TreeObserver * o : observers)
+    o->onFind(k);
+  return n;
+}
+
+// insert key k starting from finger f. 
+// a present key is left alone (use insertMulti 
+// for another copy): the new node is freed and 
+// neither the finger nor the observers see it 
+bool SplayTree::insert(int k, Finger &f) {
+  STAT_OP(STAT_INSERT);
+  STNode * newNode = allocNode(k);
+  if (! _insertNode(_fingerStart(f.node, k), newNode)) {
+    freeNode(newNode);
+    return false;
+  }
+  f.node = newNode;
+
+  for (TreeObserver * o : observers)
+    o->onInsert(k, 1);
+  return true;
+}
+
+// attach node as a new leaf below start
+// 
+// augmentations of its ancestors are not 
+// updated here: every ancestor of the new leaf 
+// is rotated (and updated) by the splay below. 
+bool SplayTree::_insertNode(STNode * start, STNode * node) {
+  if (root == nullptr) {
+    root = node;
+    updateExtremes(node);
+    keyLinked(node->key);
+    return true;
+  }
+
+  STNode * cur = start != nullptr ? start : root;
+  while (true) {
+    STAT(stats->descentNodes++);
+    if (node->key == cur->key) return false;
+
+    if (node->key < cur->key) {
+      if (! cur->hasLeftChild()) {
+        cur->setLeftChild(node);
+        break;
+      }
+      cur = cur->left;
+    }
+    else {
+      if (! cur->hasRightChild()) {
+        cur->setRightChild(node);
+        break;
+      }
+      cur = cur->right;
+    }
+  }
+
+  updateExtremes(node);
+  keyLinked(node->key);
+  splay(node);
+  return true;
+}
+
+void SplayTree::updateExtremes(STNode * node) {
+  if (minNode == nullptr || node->key < minNode->key)
+    minNode = node;
+  if (maxNode == nullptr || node->key > maxNode->key)
+    maxNode = node;
+}
+
+// drop one of several copies of node's key. 
+// logged as a removeOne, which replays the same 
+void SplayTree::popCopy(STNode * node) {
+  splay(node);
+  node->count--;
+  node->updateAugmentations();
+  for (TreeObserver * o : observers)
+    o->onRemoveOne(node->key);
+}
+
+// remove one copy of the min key and return it 
+//
+// with more copies left, the count is decremented 
+// and the node splayed, like removeOne. otherwise 
+// the min node has no left child, so it is 
+// unlinked by moving its right child up 
+// (no predecessor swap as in removeNode). 
+// its parent is then splayed, which also 
+// fixes the augmentations of every ancestor 
+int SplayTree::popMin() {
+  STAT_OP(STAT_REMOVE);
+  assert(minNode != nullptr);
+  STNode * node = minNode;
+  int k = node->key;
+  if (node->count > 1) {
+    popCopy(node);
+    return k;
+  }
+  keyUnlinked(k);
+
+  minNode = node->successor();
+  if (node == maxNode)
+    maxNode = nullptr;
+
+  STNode * p = node->parent;
+  replaceNode(node, node->right);
+  if (p != nullptr) {
+    p->updateAugmentations();
+    splay(p);
+  }
+
+  freeNode(node);
+
+  for (TreeObserver * o : observers)
+    o->onRemove(k);
+  return k;
+}
+
+// remove one copy of the max key and return it 
+// (mirror of popMin) 
+int SplayTree::popMax() {
+  STAT_OP(STAT_REMOVE);
+  assert(maxNode != nullptr);
+  STNode * node = maxNode;
+  int k = node->key;
+  if (node->count > 1) {
+    popCopy(node);
+    return k;
+  }
+  keyUnlinked(k);
+
+  maxNode = node->predecessor();
+  if (node == minNode)
+    minNode = nullptr;
+
+  STNode * p = node->parent;
+  replaceNode(node, node->left);
+  if (p != nullptr) {
+    p->updateAugmentations();
+    splay(p);
+  }
+
+  freeNode(node);
+
+  for (TreeObserver * o : observers)
+    o->onRemove(k);
+  return k;
+}
+
+// move finger to inorder successor 
+STNode * SplayTree::next(Finger &f) {
+  if (f.node == nullptr) return nullptr;
+
+  STNode * n = f.node->successor();
+  if (n != nullptr) {
+    if (! frozen)
+      splay(n);
+    f.node = n;
+  }
+  return n;
+}
+
+// move finger to inorder predecessor 
+STNode * SplayTree::prev(Finger &f) {
+  if (f.node == nullptr) return nullptr;
+
+  STNode * n = f.node->predecessor();
+  if (n != nullptr) {
+    if (! frozen)
+      splay(n);
+    f.node = n;
+  }
+  return n;
+}
+
+// node with largest key < k (no splaying)
+STNode * SplayTree::_lastBelow(int k) {
+  STNode * best = nullptr;
+  STNode * cur = root;
+  while (cur != nullptr) {
+    if (cur->key < k) {
+      best = cur;
+      cur = cur->right;
+    }
+    else 
+      cur = cur->left;
+  }
+  return best;
+}
+
+// node with smallest key > k (no splaying)
+STNode * SplayTree::_firstAbove(int k) {
+  STNode * best = nullptr;
+  STNode * cur = root;
+  while (cur != nullptr) {
+    if (cur->key > k) {
+      best = cur;
+      cur = cur->left;
+    }
+    else 
+      cur = cur->right;
+  }
+  return best;
+}
+
+// gather all keys in [lo, hi] into a single subtree 
+//
+// a = largest key < lo is splayed to the root, 
+// then b = smallest key > hi is splayed to 
+// just below a (b is in a's right subtree). 
+// everything strictly between a and b is 
+// then exactly the left subtree of b: 
+//
+//        a
+//         \
+//          b
+//         /
+//    [lo, hi]
+//
+// if a or b does not exist, the range is 
+// the right subtree of a / left subtree of b 
+// (or the whole tree). 
+STNode * SplayTree::isolateRange(int lo, int hi) {
+  STAT_OP(STAT_RANGE);
+  if (root == nullptr || lo > hi) return nullptr;
+
+  STNode * a = _lastBelow(lo);
+  STNode * b = _firstAbove(hi);
+
+  if (a == nullptr && b == nullptr) 
+    return root;
+  if (a == nullptr) {
+    splay(b);
+    return b->left;
+  }
+
+  splay(a);
+  if (b == nullptr) 
+    return a->right;
+
+  splay(b, a);
+  return b->left;
+}
+
+// remove all keys in [lo, hi] and 
+// return the number of keys removed 
+//
+// the range is cut out as one subtree 
+// and deallocated in bulk, so only a and b 
+// (see isolateRange) need new augmentations 
+int SplayTree::eraseRange(int lo, int hi) {
+  STAT_OP(STAT_RANGE);
+  STNode * range = isolateRange(lo, hi);
+  if (range == nullptr) return 0;
+
+  int removed = range->size;
+  STNode * p = range->parent;
+  replaceNode(range, nullptr);
+  range->parent = nullptr;
+
+  if (p != nullptr)
+    p->updateAugToRoot();
+
+  // if an extreme was cut out, the new extreme 
+  // is b or a (see isolateRange), which is 
+  // at or right below the root 
+  if (minNode->key >= lo && minNode->key <= hi)
+    minNode = root != nullptr ? root->minimumLeaf() : nullptr;
+  if (maxNode->key >= lo && maxNode->key <= hi)
+    maxNode = root != nullptr ? root->maximumLeaf() : nullptr;
+
+  subtreeUnlinked(range);
+  freeSubtree(range);
+
+  for (TreeObserver * o : observers)
+    o->onEraseRange(lo, hi);
+  return removed;
+}
+
+// remove all keys for which pred is true and 
+// return the number of keys removed 
+//
+// instead of removing nodes one at a time, 
+// the surviving nodes are collected in order 
+// and relinked as a balanced tree in O(n) 
+int SplayTree::eraseIf(std::function<bool(int)> pred) {
+  STAT_OP(STAT_RANGE);
+  std::vector<STNode *> nodes;
+  if (root != nullptr) {
+    nodes.reserve(root->size);
+    _collectNodes(root, nodes);
+  }
+
+  int kept = 0;
+  for (STNode * n : nodes) {
+    if (pred(n->key)) {
+      for (TreeObserver * o : observers)
+        o->onRemove(n->key);
+      freeNode(n);
+    }
+    else 
+      nodes[kept++] = n;
+  }
+  int removed = nodes.size() - kept;
+  nodes.resize(kept);
+
+  root = nullptr;
+  buildFromSorted(nodes);
+  return removed;
+}
+
+// store node pointers of subtree in inorder. 
+// iterative, with an explicit stack, since the 
+// subtree can be a path (like freeSubtree) 
+void SplayTree::_collectNodes(STNode * node, std::vector<STNode *> &v) {
+  std::vector<STNode *> stack;
+  while (node != nullptr || ! stack.empty()) {
+    while (node != nullptr) {
+      stack.push_back(node);
+      node = node->left;
+    }
+    node = stack.back();
+    stack.pop_back();
+    v.push_back(node);
+    node = node->right;
+  }
+}
+
+// link nodes[lo..hi] (sorted) into a balanced 
+// subtree and return its root. 
+// augmentations are recomputed bottom-up 
+// (unless recomputeAug is false). 
+STNode * SplayTree::_buildBalanced(std::vector<STNode *> &nodes, 
+                                   int lo, int hi, bool recomputeAug) {
+  if (lo > hi) return nullptr;
+
+  int mid = lo + (hi - lo) / 2;
+  STNode * node = nodes[mid];
+  node->setLeftChild(_buildBalanced(nodes, lo, mid - 1, recomputeAug));
+  node->setRightChild(_buildBalanced(nodes, mid + 1, hi, recomputeAug));
+  if (recomputeAug)
+    node->updateAugmentations();
+  return node;
+}
+
+// replace the (empty) tree with sorted, 
+// detached nodes linked as a balanced tree. 
+//
+// if recomputeAug is false, the caller has 
+// already filled in size/weight/hash for the 
+// shape built here (node mid = (lo+hi)/2 of 
+// each range is its root) and nothing is hashed 
+void SplayTree::buildFromSorted(std::vector<STNode *> &nodes, bool recomputeAug) {
+  assert(root == nullptr);
+
+  root = _buildBalanced(nodes, 0, (int) nodes.size() - 1, recomputeAug);
+  if (root != nullptr)
+    root->parent = nullptr;
+
+  minNode = nodes.empty() ? nullptr : nodes.front();
+  maxNode = nodes.empty() ? nullptr : nodes.back();
+
+  // the nodes may come from anywhere 
+  // (eraseIf, a snapshot, ...) 
+  if (filter != nullptr)
+    rebuildFilter(filter->getCapacity());
+  if (hotCache != nullptr)
+    hotCache->clear();
+}
+
+// copy the nodes into the run in preorder, then 
+// relink the copies. each old node's parent 
+// field is overwritten with the address of its 
+// copy once every copy is made, so the old 
+// pointers in the copies can be followed to 
+// their new targets without a map 
+bool SplayTree::compact() {
+  if (allocator == nullptr) return false;
+  if (root == nullptr) return true;
+
+  int n = root->size;
+  STNode * run = (STNode *) allocator->allocateRun(n);
+  if (run == nullptr) return false;
+  STAT(stats->nodeAllocs += n);
+
+  std::vector<STNode *> old;
+  old.reserve(n);
+  std::vector<STNode *> stack(1, root);
+  while (! stack.empty()) {
+    STNode * node = stack.back();
+    stack.pop_back();
+    old.push_back(node);
+    if (node->hasRightChild()) stack.push_back(node->right);
+    if (node->hasLeftChild()) stack.push_back(node->left);
+  }
+  assert(old.size() == n);
+
+  for (int i = 0; i < n; i++)
+    new (&run[i]) STNode(*old[i]);
+  for (int i = 0; i < n; i++)
+    old[i]->parent = &run[i];
+
+  for (int i = 0; i < n; i++) {
+    STNode &c = run[i];
+    if (c.left != nullptr) c.left = c.left->parent;
+    if (c.right != nullptr) c.right = c.right->parent;
+    if (c.parent != nullptr) c.parent = c.parent->parent;
+  }
+  root = root->parent;
+  minNode = minNode->parent;
+  maxNode = maxNode->parent;
+  // the cache holds node pointers, the 
+  // filter only keys 
+  if (hotCache != nullptr)
+    hotCache->clear();
+
+  for (STNode * node : old)
+    freeNode(node);
+  return true;
+}
+
+void SplayTree::recordAccess(STNode * node) {
+  if (node->accesses != UINT_MAX)
+    node->accesses++;
+  if (autoRebuildEvery > 0 && ++accessesSinceRebuild >= autoRebuildEvery)
+    rebuildOptimal();
+}
+
+void SplayTree::setAutoRebuild(long long n) {
+  autoRebuildEvery = n;
+  accessesSinceRebuild = 0;
+}
+
+// weight-balanced subtree of nodes[lo..hi], where 
+// prefix[i] is the total weight of nodes[0..i-1]. 
+// the root is the node whose weight interval 
+// holds the midpoint of the range's weight, so 
+// both sides have at most half of it and the 
+// depth is at most log2(total weight) + 1 
+STNode * SplayTree::_buildWeighted(std::vector<STNode *> &nodes, 
+                                   const std::vector<unsigned long long> &prefix, 
+                                   int lo, int hi) {
+  if (lo > hi) return nullptr;
+
+  unsigned long long mid = prefix[lo] + (prefix[hi + 1] - prefix[lo]) / 2;
+  int m = std::upper_bound(prefix.begin() + lo, prefix.begin() + hi + 2, mid) 
+          - prefix.begin() - 1;
+
+  STNode * node = nodes[m];
+  node->setLeftChild(_buildWeighted(nodes, prefix, lo, m - 1));
+  node->setRightChild(_buildWeighted(nodes, prefix, m + 1, hi));
+  node->updateAugmentations();
+  return node;
+}
+
+// the nodes stay the same, so fingers, 
+// handles into the tree, the filter and 
+// the hot-key cache all stay valid 
+void SplayTree::rebuildOptimal() {
+  accessesSinceRebuild = 0;
+  if (root == nullptr) return;
+
+  std::vector<STNode *> nodes;
+  nodes.reserve(root->size);
+  for (STNode * n = minNode; n != nullptr; n = n->successor())
+    nodes.push_back(n);
+
+  std::vector<unsigned long long> prefix(nodes.size() + 1, 0);
+  for (size_t i = 0; i < nodes.size(); i++) {
+    prefix[i + 1] = prefix[i] + nodes[i]->accesses + 1;
+    nodes[i]->accesses /= 2;
+  }
+
+  root = _buildWeighted(nodes, prefix, 0, (int) nodes.size() - 1);
+  root->parent = nullptr;
+}
+
+// add one copy of key k 
+//
+// an existing node is splayed to the root 
+// first, so only the root's weight changes 
+void SplayTree::insertMulti(int k) {
+  STAT_OP(STAT_INSERT);
+  STNode * node = _findAndSplay(k);
+  if (node == nullptr) 
+    _insertKey(k);
+  else {
+    node->count++;
+    node->updateAugmentations();
+  }
+
+  for (TreeObserver * o : observers)
+    o->onInsertMulti(k);
+}
+
+// remove one copy of key k. 
+// returns false if k is absent 
+bool SplayTree::removeOne(int k) {
+  STAT_OP(STAT_REMOVE);
+  STNode * node = _findAndSplay(k);
+  if (node == nullptr) return false;
+
+  if (node->count > 1) {
+    node->count--;
+    node->updateAugmentations();
+  }
+  else {
+    detachNode(node);
+    freeNode(node);
+  }
+
+  for (TreeObserver * o : observers)
+    o->onRemoveOne(k);
+  return true;
+}
+
+// number of copies of key k (0 if absent) 
+//
+// a read, not a find: nothing is splayed, and 
+// observers, access counts and the per-op stats 
+// don't see it, so a trace replays to the same 
+// shape whether or not the tree was asked 
+int SplayTree::getCount(int k) {
+  STNode * node = _lookup(root, k);
+  return node == nullptr ? 0 : node->count;
+}
+
+// node holding the i-th smallest element 
+//
+// at each node, elements are ordered 
+// left subtree < this node (count copies) < right subtree 
+STNode * SplayTree::select(int i) {
+  STAT_OP(STAT_SELECT);
+  for (TreeObserver * o : observers)
+    o->onSelect(i);
+  if (i < 0 || i >= getWeight()) return nullptr;
+
+  STNode * cur = root;
+  while (true) {
+    STAT(stats->descentNodes++);
+    int lweight = cur->hasLeftChild() ? cur->left->weight : 0;
+    if (i < lweight) 
+      cur = cur->left;
+    else if (i < lweight + cur->count) 
+      break;
+    else {
+      i -= lweight + cur->count;
+      cur = cur->right;
+    }
+  }
+
+  if (! frozen)
+    splay(cur);
+  return cur;
+}
+
+// number of elements < k 
+//
+// the last node on the search path is 
+// splayed to pay for the descent 
+int SplayTree::rank(int k) {
+  STAT_OP(STAT_RANK);
+  int r = 0;
+  STNode * last = nullptr;
+  STNode * cur = root;
+  while (cur != nullptr) {
+    STAT(stats->descentNodes++);
+    last = cur;
+    if (k <= cur->key) 
+      cur = cur->left;
+    else {
+      r += cur->count;
+      if (cur->hasLeftChild())
+        r += cur->left->weight;
+      cur = cur->right;
+    }
+  }
+
+  if (last != nullptr && ! frozen)
+    splay(last);
+
+  for (TreeObserver * o : observers)
+    o->onRank(k);
+  return r;
+}
+
+// find key k below n, unless the filter says 
+// it's absent. every lookup that reaches the 
+// filter is counted, for the filter stats 
+STNode * SplayTree::_lookup(STNode * n, int k) {
+  if (filter == nullptr) return _find(n, k);
+
+  filter->lookups++;
+  if (! filter->mayContain(k)) {
+    filter->definiteMisses++;
+    return nullptr;
+  }
+  STNode * found = _find(n, k);
+  if (found == nullptr)
+    filter->falsePositives++;
+  return found;
+}
+
+// a new node can't have a cache entry, its 
+// key's entry went when the old node did 
+void SplayTree::keyLinked(int k) {
+  if (filter == nullptr) return;
+  filter->add(k);
+  if (filter->overfull())
+    rebuildFilter(2 * filter->getCapacity());
+}
+
+void SplayTree::keyUnlinked(int k) {
+  if (filter != nullptr)
+    filter->remove(k);
+  if (hotCache != nullptr)
+    hotCache->invalidate(k);
+}
+
+// remove every key of a subtree that is about 
+// to be freed (no recursion, as in freeSubtree). 
+// the cache is cheaper to clear than to walk 
+void SplayTree::subtreeUnlinked(STNode * node) {
+  if (hotCache != nullptr)
+    hotCache->clear();
+  if (filter == nullptr || node == nullptr) return;
+  std::vector<STNode *> stack(1, node);
+  while (! stack.empty()) {
+    STNode * n = stack.back();
+    stack.pop_back();
+    filter->remove(n->key);
+    if (n->hasLeftChild()) stack.push_back(n->left);
+    if (n->hasRightChild()) stack.push_back(n->right);
+  }
+}
+
+// the stats carry over to the new filter 
+void SplayTree::rebuildFilter(long long capacity) {
+  long long n = getSize();
+  while (2 * capacity < n)
+    capacity *= 2;
+
+  if (capacity != filter->getCapacity()) {
+    KeyFilter * f = new KeyFilter(capacity, filter->getFpRate());
+    f->lookups = filter->lookups;
+    f->definiteMisses = filter->definiteMisses;
+    f->falsePositives = filter->falsePositives;
+    f->rebuilds = filter->rebuilds + 1;
+    filter.reset(f);
+  }
+  else
+    filter->clear();
+
+  for (STNode * node = minNode; node != nullptr; node = node->successor())
+    filter->add(node->key);
+}
+
+void SplayTree::enableFilter(long long expectedKeys, double fpRate) {
+  filter.reset(new KeyFilter(expectedKeys, fpRate));
+  rebuildFilter(filter->getCapacity());
+  filter->rebuilds = 0;
+}
+
+void SplayTree::disableFilter() {
+  filter.reset();
+}
+
+void SplayTree::enableHotCache(int slots) {
+  hotCache.reset(new HotKeyCache(slots));
+}
+
+void SplayTree::disableHotCache() {
+  hotCache.reset();
+}
+
 // find key k in subtree rooted at node 
 STNode * SplayTree::_find(STNode* node, int k) {
   if (! node) return nullptr;  
+  STAT(stats->descentNodes++);
 
   // print address 
   // std::cout << node << std::endl;
@@ -2,6 +2,15 @@
 #define SPLAY_H
 
 #include<vector>
+#include<functional>
+#include<utility>
+#include<memory>
+#include "filter.h"
+#include "hot-cache.h"
+
+#ifdef SPLAY_STATS
+#include "stats.h"
+#endif
 
 // splay tree invariants: 
 // - at most one of each key 
@@ -15,11 +24,40 @@ typedef unsigned long long ll;
 const ll P = 104729;
 
 // mod by M in hash
+//
+// by default M = 2^63, which the unsigned overflow 
+// makes cheap, but a power-of-two modulus makes 
+// polynomial hashes collide easily on structured 
+// input. compile with -DSPLAY_HASH_M61 to use the 
+// Mersenne prime 2^61 - 1 instead (slower multiply, 
+// far fewer collisions). 
+//
+// SPLAY_HASH_MODE identifies the hash in 
+// persisted files (see snapshot.h)
+#ifdef SPLAY_HASH_M61
+const ll M = (1ULL<<61) - 1;
+const unsigned SPLAY_HASH_MODE = 1;
+#else
 const ll M = 1UL<<63;
+const unsigned SPLAY_HASH_MODE = 0;
+#endif
 
 // binary exponentiation
 ll binpow(ll a, ll b);
 
+// hash arithmetic mod M. 
+// a and b must already be reduced mod M 
+ll hashMul(ll a, ll b);
+ll hashAdd(ll a, ll b);
+
+// key reduced mod M, and P^e mod M 
+ll hashKey(int key);
+ll hashPow(ll e);
+
+// polynomial hash of a subtree with left subtree 
+// (lhash, ln keys), root key and right subtree rhash
+ll combineHash(ll lhash, ll ln, int key, ll rhash);
+
 class STNode {
 
   public:
@@ -53,13 +91,31 @@ class STNode {
     // subtree size
     int size; 
 
+    // multiset support: 
+    // count is the multiplicity of this key and 
+    // weight is the sum of counts in this subtree. 
+    //
+    // size and hash only look at distinct keys, 
+    // so they are unaffected by counts 
+    int count;
+    int weight;
+
+    // successful finds of this key, the weights 
+    // SplayTree::rebuildOptimal builds from. 
+    // halved by each rebuild, so old accesses 
+    // fade out. saturates instead of wrapping 
+    unsigned accesses;
+
     STNode(int k) 
       : left(nullptr), 
         right(nullptr), 
         parent(nullptr),
         size(1),
         key(k), 
-        hash(k % M) { }
+        hash(hashKey(k)),
+        count(1),
+        weight(1),
+        accesses(0) { }
 
     ~STNode();
 
@@ -86,6 +142,9 @@ class STNode {
     // set size to lsize + 1 + rsize 
     void updateSizeFromChildren();
 
+    // set weight to lweight + count + rweight 
+    void updateWeightFromChildren();
+
     // update polynomial hash for this node
     // based on children and subtree sizes
     void updateHashFromChildren();
@@ -119,11 +178,122 @@ class STNode {
     // min value node in this subtree 
     STNode * minimumLeaf();
 
+    // inorder successor/predecessor 
+    // (found with parent pointers, no splaying)
+    STNode * successor();
+    STNode * predecessor();
+
     // testing/debugging function 
     // for printing parent, node, left child, right child
     void printNeighbors();
 };
 
+// handle to a node in a splay tree. 
+//
+// a finger remembers the most recently 
+// accessed node so that the next search can 
+// start from there instead of from the root. 
+// searching from a finger walks up until 
+// the key must be in the current subtree and 
+// then walks back down, so nearby keys are 
+// cheap to reach (O(log d) amortized, where d 
+// is the rank distance from the finger). 
+//
+// N.B. a finger is invalidated when the node 
+// it points to is removed from the tree 
+class Finger {
+  public:
+    STNode * node;
+
+    Finger() : node(nullptr) { }
+    Finger(STNode * n) : node(n) { }
+
+    bool isSet() const { return node != nullptr; }
+};
+
+// where a tree's nodes come from (see 
+// SplayTree(NodeAllocator *) and forest.h). 
+// allocate returns uninitialized memory for 
+// one STNode, release takes back memory from 
+// allocate (or from a run) whose node has 
+// been destroyed. without an allocator, nodes 
+// are plain new/delete 
+class NodeAllocator {
+  public:
+    virtual ~NodeAllocator() { }
+
+    virtual void * allocate() = 0;
+    virtual void release(void * p) = 0;
+
+    // memory for n nodes in one contiguous block, 
+    // released node by node later, or null if the 
+    // allocator can't (see SplayTree::compact) 
+    virtual void * allocateRun(int n) { return nullptr; }
+};
+
+// owns a single node that was taken out of 
+// a splay tree with SplayTree::extract. 
+// 
+// the node can be put back (into the same 
+// or another tree) with SplayTree::insert, 
+// which re-links it instead of allocating 
+// a new node. the key can be changed 
+// in between. if the handle still owns a 
+// node when it is destroyed, the node is deleted. 
+class NodeHandle {
+  private:
+    STNode * node;
+    // the node's allocator (null for the heap) 
+    NodeAllocator * allocator;
+
+    NodeHandle(STNode * n, NodeAllocator * a) : node(n), allocator(a) { }
+    friend class SplayTree;
+
+  public:
+    NodeHandle() : node(nullptr), allocator(nullptr) { }
+    NodeHandle(NodeHandle &&other) : node(other.node), allocator(other.allocator) { other.node = nullptr; }
+    NodeHandle & operator=(NodeHandle &&other);
+    ~NodeHandle();
+
+    // move-only 
+    NodeHandle(const NodeHandle &) = delete;
+    NodeHandle & operator=(const NodeHandle &) = delete;
+
+    bool empty() const { return node == nullptr; }
+
+    // precondition: ! empty()
+    int & key();
+};
+
+// receives every mutation of a tree it has been 
+// attached to (see SplayTree::addObserver), e.g. 
+// for logging. each public operation reports 
+// exactly one event (eraseIf reports one 
+// onRemove per removed key). 
+//
+// count is the multiplicity of an inserted node, 
+// which is only > 1 for a re-linked NodeHandle 
+//
+// reads that splay (find, rank, select) are 
+// reported too, since they change the shape of 
+// the tree. a trace of all events replays to 
+// the same keys and counts (see trace.h) 
+class TreeObserver {
+  public:
+    virtual ~TreeObserver() { }
+
+    virtual void onInsert(int key, int count) { }
+    virtual void onRemove(int key) { }
+    virtual void onEraseRange(int lo, int hi) { }
+    virtual void onInsertMulti(int key) { }
+    virtual void onRemoveOne(int key) { }
+    virtual void onRekey(int oldKey, int newKey) { }
+
+    virtual void onFind(int key) { }
+    virtual void onRank(int key) { }
+    virtual void onSelect(int i) { }
+};
+
 class SplayTree {
 
   private:
@@ -131,11 +301,103 @@ class SplayTree {
     // node so it can be splayed after insertion 
     STNode * insertedNodePtr; 
 
-    void splay(STNode *node);
+    // cached extreme nodes (null if tree is empty). 
+    // rotations don't change which node holds 
+    // the min/max key, so these only need to be 
+    // maintained when nodes are linked or unlinked 
+    STNode * minNode;
+    STNode * maxNode;
+
+    // update cached extremes for a newly linked node 
+    void updateExtremes(STNode * node);
+
+    std::vector<TreeObserver *> observers;
+
+    // access-weighted rebuilds (see rebuildOptimal). 
+    // a frozen tree doesn't splay on reads 
+    bool frozen;
+    long long autoRebuildEvery;
+    long long accessesSinceRebuild;
+
+    // count a successful find of node, and 
+    // rebuild if the auto-rebuild period is up 
+    void recordAccess(STNode * node);
+
+#ifdef SPLAY_STATS
+    // on the heap, the histograms are large 
+    std::unique_ptr<SplayStats> stats;
+#endif
+
+    // optional membership filter, null unless 
+    // enabled (see enableFilter) 
+    std::unique_ptr<KeyFilter> filter;
+
+    // _find(n, key), except that keys the filter 
+    // rules out return null without a descent 
+    STNode * _lookup(STNode * n, int key);
+
+    // optional key -> node cache in front of 
+    // find, null unless enabled (see enableHotCache) 
+    std::unique_ptr<HotKeyCache> hotCache;
+
+    // keep the filter and the hot-key cache in 
+    // step with linked and unlinked nodes 
+    // (no-ops without them) 
+    void keyLinked(int key);
+    void keyUnlinked(int key);
+    void subtreeUnlinked(STNode * node);
+    // refill the filter from the tree's keys, 
+    // sized for capacity keys 
+    void rebuildFilter(long long capacity);
+
+    // insert(int) without notifying observers 
+    void _insertKey(int key);
+
+    void splay(STNode *node, STNode *top = nullptr);
     STNode * _find(STNode* n, int key);
+    // find(key) without notifying observers 
+    STNode * _findAndSplay(int key);
     STNode * _insert(STNode* n, int key);
     void removeNode(STNode * node);
 
+    // remove node from tree and reset its 
+    // pointers and augmentations, 
+    // without deallocating it 
+    void detachNode(STNode * node);
+
+    // link an unattached node into the tree below start 
+    // (or below the root if start is null) and splay it. 
+    // returns false if the key is already present 
+    bool _insertNode(STNode * start, STNode * node);
+
+    // neighbours of a key (no splaying)
+    STNode * _lastBelow(int k);
+    STNode * _firstAbove(int k);
+
+    void _collectNodes(STNode * node, std::vector<STNode *> &v);
+    STNode * _buildBalanced(std::vector<STNode *> &nodes, 
+                            int lo, int hi, bool recomputeAug);
+    STNode * _buildWeighted(std::vector<STNode *> &nodes, 
+                            const std::vector<unsigned long long> &prefix, 
+                            int lo, int hi);
+
+    // null for new/delete 
+    NodeAllocator * allocator;
+
+    // destroy a detached node and give its 
+    // memory back to the allocator 
+    void freeNode(STNode * node);
+
+    // deallocate a detached subtree 
+    void freeSubtree(STNode * node);
+
+    // pop one of several copies (popMin/popMax) 
+    void popCopy(STNode * node);
+
+    // walk up from node until the subtree 
+    // rooted at the returned node must contain k
+    STNode * _fingerStart(STNode * node, int k);
+
     void _printInorder(STNode *node);
 
   public:
@@ -143,24 +405,211 @@ class SplayTree {
     STNode * find(int key);
     void insert(int key);
     void remove(int key);
+
+    // finger search/insert: start from f.node 
+    // (or from the root if f is not set).
+    // on success f is moved to the accessed node.
+    // insert returns false if key is present
+    STNode * find(int key, Finger &f);
+    bool insert(int key, Finger &f);
+
+    // take node with key out of the tree without 
+    // deallocating it. handle is empty if key is absent
+    NodeHandle extract(int key);
+
+    // re-link an extracted node. returns false 
+    // (and the handle keeps the node) if its key 
+    // is already present 
+    bool insert(NodeHandle &&nh);
+
+    // change key oldKey to newKey, reusing the node. 
+    // returns false if oldKey is absent or 
+    // newKey is already present 
+    bool rekey(int oldKey, int newKey);
+
+    // restructure the tree so that all keys in [lo, hi] 
+    // form a single subtree and return its root 
+    // (nullptr if there are no such keys) 
+    STNode * isolateRange(int lo, int hi);
+
+    // bulk removal. both return number of keys removed
+    int eraseRange(int lo, int hi);
+    int eraseIf(std::function<bool(int)> pred);
+
+    // double-ended priority queue operations. 
+    // peeks are O(1) and return nullptr if empty.
+    // pops remove one copy of the min/max key 
+    // (the node only with its last copy) and 
+    // return it. 
+    // precondition (pops): tree is not empty 
+    STNode * peekMin() const { return minNode; }
+    STNode * peekMax() const { return maxNode; }
+    int popMin();
+    int popMax();
+
+    // multiset operations. 
+    // insertMulti adds one copy of key, 
+    // removeOne removes one copy (and the node 
+    // once its count reaches 0). 
+    // remove() still removes every copy. 
+    void insertMulti(int key);
+    bool removeOne(int key);
+    int getCount(int key);
+
+    // order statistics over all copies of all keys 
+    // (equal to distinct keys if every count is 1). 
+    //
+    // select(i) returns the node holding the i-th 
+    // smallest element (0-indexed) or nullptr if 
+    // i is out of range. rank(k) is the number 
+    // of elements < k. both splay. 
+    STNode * select(int i);
+    int rank(int key);
+
+    // a detached node with key from this tree's 
+    // allocator, e.g. for buildFromSorted 
+    STNode * allocNode(int key);
+    NodeAllocator * getAllocator() const { return allocator; }
+
+    // link sorted, detached nodes into a balanced tree 
+    // in O(n), without splaying. the nodes must come 
+    // from allocNode (or new, without an allocator). 
+    // precondition: tree is empty
+    void buildFromSorted(std::vector<STNode *> &nodes, bool recomputeAug = true);
+
+    // move every node into one block from the 
+    // allocator's allocateRun, in preorder, so a 
+    // descent reads memory front to back and the 
+    // old, scattered nodes are released. the shape 
+    // and augmentations are unchanged, but node 
+    // pointers (fingers, peekMin, ..) are not. 
+    // false (and nothing moves) if there is no 
+    // allocator or it can't allocate runs 
+    bool compact();
+
+    // relink the tree into a near-optimal static 
+    // BST for the access counts of its nodes, in 
+    // O(n log n): the root of every subtree is the 
+    // node whose weight spans the middle of the 
+    // subtree's total weight (weight = accesses + 1), 
+    // so a node is at depth O(log(W / w)), within 
+    // a constant of the optimal tree's cost. 
+    // augmentations are recomputed bottom-up and 
+    // the counts are halved. 
+    //
+    // observers aren't told, so a trace of a tree 
+    // that was rebuilt doesn't replay to its shape 
+    void rebuildOptimal();
+
+    // a frozen tree keeps its shape on reads: find, 
+    // rank, select and finger moves don't splay 
+    // (updates and the range operations still do). 
+    // that's what keeps a rebuilt tree optimal. 
+    void setFrozen(bool f) { frozen = f; }
+    bool isFrozen() const { return frozen; }
+
+    // rebuild after every n successful finds 
+    // (0, the default, turns it off). with a frozen 
+    // tree this tracks a stable skewed workload 
+    // with a static tree that is refreshed now 
+    // and then, and since the counts are halved 
+    // each time, follows it when it drifts 
+    void setAutoRebuild(long long n);
+
+    // attach/detach an observer (not owned by the tree)
+    void addObserver(TreeObserver * o);
+    void removeObserver(TreeObserver * o);
+
+    // keep a membership filter of the keys (see 
+    // filter.h) so that find, insert, remove and 
+    // the other point operations answer most 
+    // lookups of absent keys without touching 
+    // a node. misses don't splay, so the tree 
+    // evolves exactly as it would without it. 
+    //
+    // the filter is sized for expectedKeys at 
+    // a false positive rate of about fpRate, and 
+    // rebuilt twice as large if the tree grows 
+    // past twice that. enabling it again 
+    // resizes it (and resets its stats) 
+    void enableFilter(long long expectedKeys, double fpRate = 0.01);
+    void disableFilter();
+    bool hasFilter() const { return filter != nullptr; }
+    // precondition: hasFilter() 
+    FilterStats getFilterStats() const { return filter->getStats(); }
+
+    // cache the nodes of recently found keys (see 
+    // hot-cache.h). find returns a cached node 
+    // without descending or splaying, so hot keys 
+    // stop rotating each other around, at the price 
+    // of find no longer moving them to the root. 
+    // everything else (including the multiset 
+    // operations) bypasses the cache. 
+    //
+    // slots is rounded up to a power of two. 
+    // enabling it again starts an empty cache 
+    void enableHotCache(int slots = 1024);
+    void disableHotCache();
+    bool hasHotCache() const { return hotCache != nullptr; }
+    // precondition: hasHotCache() 
+    HotCacheStats getHotCacheStats() const { return hotCache->getStats(); }
+
+    // move finger to inorder successor/predecessor. 
+    // returns nullptr (and leaves f alone) 
+    // if there is no such node 
+    STNode * next(Finger &f);
+    STNode * prev(Finger &f);
     void swapNodeValues(STNode * n, STNode * m);
 
     // replace node n with node m 
     void replaceNode(STNode * n, STNode * m);
 
-    SplayTree() : root(nullptr) { }
+    // nodes from allocator (not owned by the 
+    // tree), or new/delete if it is null 
+    explicit SplayTree(NodeAllocator * allocator = nullptr) 
+      : root(nullptr), 
+        minNode(nullptr), 
+        maxNode(nullptr), 
+        frozen(false), 
+        autoRebuildEvery(0), 
+        accessesSinceRebuild(0) 
+#ifdef SPLAY_STATS
+        , stats(new SplayStats())
+#endif
+        , allocator(allocator)
+        { }
     ~SplayTree();
 
+#ifdef SPLAY_STATS
+    // copy of the statistics so far (see stats.h) 
+    SplayStats getStats() const { return *stats; }
+    void resetStats() { stats->reset(); }
+#endif
+
     void printInorder();
 
     void getInorder(std::vector<int> &v) const;
     int getSize() const;
+    int getWeight() const;
     ll getHash()  const;
 };
 
 // compare based on hash
 bool operator== (const SplayTree& t1, const SplayTree& t2);
 
+// key ranges [lo, hi] where two trees differ 
+// (a key present in only one tree, or with 
+// different counts). every key of either tree in 
+// a returned range differs, and ranges are sorted. 
+//
+// aligned key ranges are compared by the 
+// (size, weight, hash) of the subtree isolateRange 
+// gathers them into, and only unequal ranges are 
+// split further, so the cost grows with the number 
+// of differences rather than the tree size. 
+// both trees are splayed 
+std::vector<std::pair<int, int> > diff(SplayTree &a, SplayTree &b);
+
 void _getInorder(const SplayTree& t, std::vector<int> &v);
 void _getInorder(const STNode& t, std::vector<int> &v);
 #endif
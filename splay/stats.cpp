@@ -0,0 +1,128 @@
+#include <cstdio>
+#include "stats.h"
+
+const char * statOpName(int op) {
+  static const char * names[STAT_NUM_OPS] = {
+    "find", "insert", "remove", "rank", "select", "range"
+  };
+  return op >= 0 && op < STAT_NUM_OPS ? names[op] : "?";
+}
+
+SplayStats::SplayStats() {
+  reset();
+}
+
+void SplayStats::reset() {
+  rotations = 0;
+  zigSteps = zigZigSteps = zigZagSteps = 0;
+  descentNodes = 0;
+  nodeAllocs = nodeFrees = 0;
+  for (OpStats &o : ops) {
+    o.count = 0;
+    o.latency.reset();
+    o.depth.reset();
+    o.rotations.reset();
+  }
+  inOp = false;
+}
+
+std::string SplayStats::toText() const {
+  char buf[256];
+  std::string out;
+
+  snprintf(buf, sizeof(buf),
+           "rotations %llu (zig %llu, zig-zig %llu, zig-zag %llu)\n"
+           "descent nodes %llu\n"
+           "nodes allocated %llu, freed %llu\n",
+           (unsigned long long) rotations, (unsigned long long) zigSteps,
+           (unsigned long long) zigZigSteps, (unsigned long long) zigZagSteps,
+           (unsigned long long) descentNodes,
+           (unsigned long long) nodeAllocs, (unsigned long long) nodeFrees);
+  out += buf;
+
+  snprintf(buf, sizeof(buf), "%-7s %10s %8s %8s %8s %10s %9s %9s %8s %8s\n",
+           "op", "count", "p50 ns", "p99 ns", "p999 ns",
+           "depth avg", "depth p99", "depth max", "rot avg", "rot max");
+  out += buf;
+
+  for (int i = 0; i < STAT_NUM_OPS; i++) {
+    const OpStats &o = ops[i];
+    if (o.count == 0) continue;
+    snprintf(buf, sizeof(buf), "%-7s %10llu %8llu %8llu %8llu %10.2f %9llu %9llu %8.2f %8llu\n",
+             statOpName(i), (unsigned long long) o.count,
+             (unsigned long long) o.latency.percentile(0.5),
+             (unsigned long long) o.latency.percentile(0.99),
+             (unsigned long long) o.latency.percentile(0.999),
+             o.depth.mean(),
+             (unsigned long long) o.depth.percentile(0.99),
+             (unsigned long long) o.depth.max(),
+             o.rotations.mean(),
+             (unsigned long long) o.rotations.max());
+    out += buf;
+  }
+  return out;
+}
+
+static std::string histogramJSON(const LatencyHistogram &h) {
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "{\"mean\": %.2f, \"p50\": %llu, \"p99\": %llu, "
+           "\"p999\": %llu, \"max\": %llu}",
+           h.mean(),
+           (unsigned long long) h.percentile(0.5),
+           (unsigned long long) h.percentile(0.99),
+           (unsigned long long) h.percentile(0.999),
+           (unsigned long long) h.max());
+  return buf;
+}
+
+std::string SplayStats::toJSON() const {
+  char buf[256];
+  std::string out;
+
+  snprintf(buf, sizeof(buf),
+           "{\"rotations\": %llu, \"zig\": %llu, \"zigZig\": %llu, "
+           "\"zigZag\": %llu, \"descentNodes\": %llu, \"nodeAllocs\": %llu, "
+           "\"nodeFrees\": %llu, \"ops\": {",
+           (unsigned long long) rotations, (unsigned long long) zigSteps,
+           (unsigned long long) zigZigSteps, (unsigned long long) zigZagSteps,
+           (unsigned long long) descentNodes, (unsigned long long) nodeAllocs, (unsigned long long) nodeFrees);
+  out += buf;
+
+  for (int i = 0; i < STAT_NUM_OPS; i++) {
+    const OpStats &o = ops[i];
+    snprintf(buf, sizeof(buf), "%s\"%s\": {\"count\": %llu, \"latencyNs\": ",
+             i > 0 ? ", " : "", statOpName(i), (unsigned long long) o.count);
+    out += buf;
+    out += histogramJSON(o.latency);
+    out += ", \"depth\": ";
+    out += histogramJSON(o.depth);
+    out += ", \"rotations\": ";
+    out += histogramJSON(o.rotations);
+    out += "}";
+  }
+  out += "}}";
+  return out;
+}
+
+StatScope::StatScope(SplayStats * s, int o)
+  : stats(s), op(o), active(! s->inOp) {
+  if (! active) return;
+  stats->inOp = true;
+  rotationsBefore = stats->rotations;
+  descentBefore = stats->descentNodes;
+  start = std::chrono::steady_clock::now();
+}
+
+StatScope::~StatScope() {
+  if (! active) return;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+
+  OpStats &o = stats->ops[op];
+  o.count++;
+  o.latency.record(ns);
+  o.depth.record(stats->descentNodes - descentBefore);
+  o.rotations.record(stats->rotations - rotationsBefore);
+  stats->inOp = false;
+}
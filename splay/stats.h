@@ -0,0 +1,99 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "histogram.h"
+
+// runtime statistics for a SplayTree, only
+// compiled in with -DSPLAY_STATS (make test-stats).
+//
+// they show whether a tree is adapting to its
+// workload: with a good fit most accesses reach
+// shallow nodes, while a thrashing tree keeps
+// descending and rotating long paths (see the
+// depth and rotation histograms).
+
+// public operations are grouped by kind.
+// nested calls (insertMulti calling find, ...)
+// only count as the outer operation
+enum StatOp {
+  STAT_FIND,      // find
+  STAT_INSERT,    // insert, insertMulti
+  STAT_REMOVE,    // remove, removeOne, extract, popMin/Max
+  STAT_RANK,      // rank
+  STAT_SELECT,    // select
+  STAT_RANGE,     // isolateRange, eraseRange, eraseIf
+  STAT_NUM_OPS
+};
+
+const char * statOpName(int op);
+
+struct OpStats {
+  uint64_t count;
+  // wall time of each call in ns
+  LatencyHistogram latency;
+  // nodes visited by the search descents of each
+  // call (find, insert, rank, select and the
+  // lookups inside the other operations). misses,
+  // frozen finds and the like count too, though
+  // they don't splay. hot cache hits and keys the
+  // filter rules out don't descend at all
+  LatencyHistogram depth;
+  // rotations done by each call, i.e. the depth
+  // of the node(s) it splayed to the top
+  LatencyHistogram rotations;
+};
+
+class SplayStats {
+  public:
+    uint64_t rotations;
+
+    // splay steps, see SplayTree::splay.
+    // zig-zig steps are what keeps splay trees
+    // balanced, a run of zig-zags straightens a path
+    uint64_t zigSteps;
+    uint64_t zigZigSteps;
+    uint64_t zigZagSteps;
+
+    // nodes visited by search descents
+    uint64_t descentNodes;
+
+    // nodes allocated and freed by this tree
+    // (allocNode / freeNode, so loads through
+    // buildFromSorted and compact count too, but
+    // NodeHandles moving in or out don't)
+    uint64_t nodeAllocs;
+    uint64_t nodeFrees;
+
+    OpStats ops[STAT_NUM_OPS];
+
+    SplayStats();
+    void reset();
+
+    std::string toText() const;
+    std::string toJSON() const;
+
+  private:
+    // the outermost operation in progress, if any
+    friend class StatScope;
+    bool inOp;
+};
+
+// times one public operation (see SplayTree)
+class StatScope {
+  private:
+    SplayStats * stats;
+    int op;
+    bool active;
+    uint64_t rotationsBefore;
+    uint64_t descentBefore;
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    StatScope(SplayStats * s, int op);
+    ~StatScope();
+};
+
+#endif
@@ -0,0 +1,452 @@
+#include <atomic>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "stress.h"
+#include "splay.h"
+#include "test-utils.h"
+
+using namespace std;
+
+// splitmix64, so neighbouring worker
+// numbers give unrelated seeds
+uint64_t stressWorkerSeed(uint64_t seed, int worker) {
+  uint64_t z = seed + 0x9e3779b97f4a7c15ULL * (uint64_t) (worker + 1);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// the reference: a std::map from key to count
+// for membership, order and multiplicities, and
+// a Fenwick tree of the counts over the key range
+// for rank and select (over all copies) in
+// O(log n) (std::distance on the map would be
+// O(n) per query)
+class Reference {
+  private:
+    vector<int> fenwick;
+    int logRange;
+
+    void add(int key, int d) {
+      weight += d;
+      for (int i = key + 1; i < fenwick.size(); i += i & -i)
+        fenwick[i] += d;
+    }
+
+  public:
+    map<int, int> keys;
+    long long weight;
+
+    Reference(int keyRange) : fenwick(keyRange + 1, 0), logRange(0), weight(0) {
+      while ((1 << (logRange + 1)) <= keyRange) logRange++;
+    }
+
+    int count(int key) const {
+      auto it = keys.find(key);
+      return it == keys.end() ? 0 : it->second;
+    }
+
+    // a new key with n copies, false if present
+    bool insert(int key, int n = 1) {
+      if (! keys.insert({key, n}).second) return false;
+      add(key, n);
+      return true;
+    }
+
+    void insertCopy(int key) {
+      keys[key]++;
+      add(key, 1);
+    }
+
+    bool removeCopy(int key) {
+      auto it = keys.find(key);
+      if (it == keys.end()) return false;
+      if (--it->second == 0)
+        keys.erase(it);
+      add(key, -1);
+      return true;
+    }
+
+    // remove every copy, returns how many
+    int erase(int key) {
+      auto it = keys.find(key);
+      if (it == keys.end()) return 0;
+      int n = it->second;
+      keys.erase(it);
+      add(key, -n);
+      return n;
+    }
+
+    // number of elements < key
+    int rank(int key) const {
+      int r = 0;
+      for (int i = key; i > 0; i -= i & -i)
+        r += fenwick[i];
+      return r;
+    }
+
+    // the key of the i-th smallest element
+    // (0-indexed), precondition: i < weight
+    int select(int i) const {
+      int pos = 0;
+      for (int step = 1 << logRange; step > 0; step >>= 1) {
+        if (pos + step < fenwick.size() && fenwick[pos + step] <= i) {
+          pos += step;
+          i -= fenwick[pos];
+        }
+      }
+      return pos;
+    }
+};
+
+enum StressOp {
+  OP_INSERT, OP_FIND, OP_REMOVE, OP_RANK, OP_SELECT,
+  OP_RANGE, OP_FINGER_FIND, OP_FINGER_INSERT, OP_NEXT, OP_PREV,
+  OP_INSERT_MULTI, OP_REMOVE_ONE, OP_REKEY, OP_EXTRACT,
+  OP_ERASE_RANGE, OP_POP, OP_ERASE_IF, OP_REBUILD
+};
+
+static const char * opNames[] = {
+  "insert", "find", "remove", "rank", "select",
+  "range", "fingerFind", "fingerInsert", "next", "prev",
+  "insertMulti", "removeOne", "rekey", "extract",
+  "eraseRange", "pop", "eraseIf", "rebuild"
+};
+
+// mostly the basic operations, then finger
+// and multiset ones, with a few structural ones
+// (rekey, extract, bulk erases, pops, rebuilds)
+// mixed in. out of 1000
+static StressOp pickOp(uint64_t x) {
+  int p = x % 1000;
+  if (p < 250) return OP_INSERT;
+  if (p < 450) return OP_FIND;
+  if (p < 600) return OP_REMOVE;
+  if (p < 670) return OP_RANK;
+  if (p < 730) return OP_SELECT;
+  if (p < 780) return OP_RANGE;
+  if (p < 820) return OP_FINGER_FIND;
+  if (p < 850) return OP_FINGER_INSERT;
+  if (p < 875) return OP_NEXT;
+  if (p < 900) return OP_PREV;
+  if (p < 930) return OP_INSERT_MULTI;
+  if (p < 960) return OP_REMOVE_ONE;
+  if (p < 975) return OP_REKEY;
+  if (p < 985) return OP_EXTRACT;
+  if (p < 990) return OP_ERASE_RANGE;
+  if (p < 997) return OP_POP;
+  if (p < 998) return OP_ERASE_IF;
+  return OP_REBUILD;
+}
+
+// the keys and counts of the tree agree with
+// the reference. walks the nodes, so nothing
+// splays
+static bool sameKeys(SplayTree &t, const Reference &ref) {
+  auto it = ref.keys.begin();
+  for (STNode * n = t.peekMin(); n != nullptr; n = n->successor(), it++) {
+    if (it == ref.keys.end() || n->key != it->first || n->count != it->second)
+      return false;
+  }
+  return it == ref.keys.end();
+}
+
+// one operation on both, false (with why
+// set) if the results differ. f is the finger
+// of the finger operations, reset by every
+// operation that may free its node
+static bool step(SplayTree &t, Reference &ref, Finger &f, mt19937_64 &rng,
+                 const StressConfig &c, string &what, string &why) {
+  int keyRange = c.keyRange;
+  StressOp op = pickOp(rng());
+  int k = rng() % keyRange;
+  ostringstream w;
+  w << opNames[op] << " " << k;
+
+  bool ok = true;
+  switch (op) {
+    case OP_INSERT:
+      // inserting a present key is a
+      // precondition violation for the tree
+      if (ref.insert(k))
+        t.insert(k);
+      else
+        ok = t.find(k) != nullptr;
+      break;
+
+    case OP_FIND: {
+      STNode * n = t.find(k);
+      bool present = ref.count(k) > 0;
+      ok = (n != nullptr) == present && (n == nullptr || n->key == k);
+      // a cache hit or a frozen tree doesn't splay
+      if (ok && present && ! c.hotCache && ! c.frozen) ok = t.root == n;
+      break;
+    }
+
+    case OP_REMOVE:
+      ref.erase(k);
+      t.remove(k);
+      ok = t.find(k) == nullptr;
+      f = Finger();
+      break;
+
+    case OP_RANK:
+      ok = t.rank(k) == ref.rank(k);
+      break;
+
+    case OP_SELECT: {
+      // a few out-of-range indexes too
+      int i = (int) (rng() % (ref.weight + 2)) - 1;
+      w.str("");
+      w << "select " << i;
+      STNode * n = t.select(i);
+      if (i < 0 || i >= ref.weight)
+        ok = n == nullptr;
+      else
+        ok = n != nullptr && n->key == ref.select(i);
+      break;
+    }
+
+    case OP_RANGE: {
+      // short ranges mostly, sometimes empty
+      // or reversed ones
+      int hi = k + (int) (rng() % 64) - 4;
+      w << " " << hi;
+      STNode * sub = t.isolateRange(k, hi);
+      auto first = ref.keys.lower_bound(k);
+      auto end = ref.keys.upper_bound(hi);
+      long long expected = 0;
+      for (auto it = first; k <= hi && it != end; it++)
+        expected++;
+      if (expected == 0)
+        ok = sub == nullptr;
+      else
+        ok = sub != nullptr && sub->size == expected
+             && sub->minimumLeaf()->key == first->first
+             && sub->maximumLeaf()->key == prev(end)->first;
+      break;
+    }
+
+    case OP_FINGER_FIND: {
+      STNode * before = f.node;
+      STNode * n = t.find(k, f);
+      bool present = ref.count(k) > 0;
+      ok = (n != nullptr) == present && (n == nullptr || n->key == k)
+           && f.node == (present ? n : before);
+      break;
+    }
+
+    case OP_FINGER_INSERT: {
+      STNode * before = f.node;
+      bool expected = ref.insert(k);
+      ok = t.insert(k, f) == expected
+           && (expected ? f.node != nullptr && f.node->key == k : f.node == before);
+      break;
+    }
+
+    case OP_NEXT:
+    case OP_PREV: {
+      if (! f.isSet()) {
+        ok = (op == OP_NEXT ? t.next(f) : t.prev(f)) == nullptr;
+        break;
+      }
+      int from = f.node->key;
+      w.str("");
+      w << opNames[op] << " from " << from;
+      auto it = ref.keys.find(from);
+      bool atEnd = op == OP_NEXT ? next(it) == ref.keys.end() : it == ref.keys.begin();
+      STNode * n = op == OP_NEXT ? t.next(f) : t.prev(f);
+      if (atEnd)
+        ok = n == nullptr && f.node->key == from;
+      else {
+        int expected = op == OP_NEXT ? next(it)->first : prev(it)->first;
+        ok = n != nullptr && n->key == expected && f.node == n;
+        if (ok && ! c.frozen) ok = t.root == n;
+      }
+      break;
+    }
+
+    case OP_INSERT_MULTI:
+      ref.insertCopy(k);
+      t.insertMulti(k);
+      break;
+
+    case OP_REMOVE_ONE:
+      ok = t.removeOne(k) == ref.removeCopy(k);
+      f = Finger();
+      break;
+
+    case OP_REKEY: {
+      int to = rng() % keyRange;
+      w << " " << to;
+      bool expected = ref.count(k) > 0
+                      && (k == to || ref.count(to) == 0);
+      ok = t.rekey(k, to) == expected;
+      if (expected && k != to)
+        ref.insert(to, ref.erase(k));
+      break;
+    }
+
+    case OP_EXTRACT: {
+      // take the node out and put it back under
+      // another key, with its copies
+      int to = rng() % keyRange;
+      w << " " << to;
+      NodeHandle nh = t.extract(k);
+      int copies = ref.erase(k);
+      ok = nh.empty() == (copies == 0);
+      if (ok && copies > 0) {
+        nh.key() = to;
+        bool expected = ref.insert(to, copies);
+        // on a present key the handle keeps
+        // the node and frees it
+        ok = t.insert(std::move(nh)) == expected;
+      }
+      f = Finger();
+      break;
+    }
+
+    case OP_ERASE_RANGE: {
+      int hi = k + (int) (rng() % 256);
+      w << " " << hi;
+      int expected = 0;
+      auto it = ref.keys.lower_bound(k);
+      while (it != ref.keys.end() && it->first <= hi) {
+        int key = (it++)->first;
+        ref.erase(key);
+        expected++;
+      }
+      ok = t.eraseRange(k, hi) == expected;
+      f = Finger();
+      break;
+    }
+
+    case OP_POP:
+      if (ref.keys.empty()) {
+        ok = t.peekMin() == nullptr && t.peekMax() == nullptr;
+        break;
+      }
+      // one copy at a time
+      if (k & 1) {
+        int expected = ref.keys.begin()->first;
+        ref.removeCopy(expected);
+        ok = t.popMin() == expected;
+      }
+      else {
+        int expected = ref.keys.rbegin()->first;
+        ref.removeCopy(expected);
+        ok = t.popMax() == expected;
+      }
+      f = Finger();
+      break;
+
+    case OP_ERASE_IF: {
+      // every third key of a window
+      int hi = k + 256;
+      w << " " << hi;
+      auto pred = [&](int key) { return key >= k && key < hi && key % 3 == 0; };
+      int expected = 0;
+      for (auto it = ref.keys.lower_bound(k); it != ref.keys.end() && it->first < hi; ) {
+        int key = (it++)->first;
+        if (pred(key)) {
+          ref.erase(key);
+          expected++;
+        }
+      }
+      ok = t.eraseIf(pred) == expected;
+      f = Finger();
+      break;
+    }
+
+    case OP_REBUILD:
+      t.rebuildOptimal();
+      ok = t.root == nullptr || t.root->parent == nullptr;
+      break;
+  }
+
+  what = w.str();
+  if (! ok)
+    why = "wrong result";
+  else if (t.getSize() != ref.keys.size()) {
+    ok = false;
+    why = "size " + to_string(t.getSize()) + ", expected "
+          + to_string(ref.keys.size());
+  }
+  else if (t.getWeight() != ref.weight) {
+    ok = false;
+    why = "weight " + to_string(t.getWeight()) + ", expected "
+          + to_string(ref.weight);
+  }
+  return ok;
+}
+
+bool runStress(const StressConfig &c, StressResult &r,
+               const atomic<bool> * stop, atomic<long long> * progress) {
+  SplayTree t;
+  if (c.filter)
+    t.enableFilter(64);
+  if (c.hotCache)
+    t.enableHotCache(16);
+  if (c.frozen) {
+    t.setFrozen(true);
+    t.setAutoRebuild(5000);
+  }
+  Reference ref(c.keyRange);
+  Finger f;
+  mt19937_64 rng(c.seed);
+
+  r.ok = true;
+  r.ops = 0;
+  r.failedOp = -1;
+  r.why.clear();
+
+  string what, why;
+  long long reported = 0;
+  for (long long i = 0; i < c.ops; i++) {
+    if ((i & 4095) == 0) {
+      if (stop != nullptr && *stop) break;
+      if (progress != nullptr) *progress += i - reported;
+      reported = i;
+    }
+
+    r.ops++;
+    if (! step(t, ref, f, rng, c, what, why)) {
+      r.ok = false;
+      r.why = what + ": " + why;
+    }
+    else if (c.validateEvery > 0 && (i + 1) % c.validateEvery == 0) {
+      if (! validateTree(t, 1, &why)) {
+        r.ok = false;
+        r.why = "after " + what + ": " + why;
+      }
+      else if (! sameKeys(t, ref)) {
+        r.ok = false;
+        r.why = "after " + what + ": keys differ from the reference";
+      }
+      else if (c.filter && t.getFilterStats().keys != t.getSize()) {
+        r.ok = false;
+        r.why = "after " + what + ": filter out of sync";
+      }
+    }
+
+    if (! r.ok) {
+      r.failedOp = i;
+      break;
+    }
+  }
+
+  if (progress != nullptr)
+    *progress += r.ops - reported;
+
+  if (r.ok && ! validateTree(t, 1, &why)) {
+    r.ok = false;
+    r.why = "at the end: " + why;
+  }
+  r.size = t.getSize();
+  r.hash = t.getHash();
+  return r.ok;
+}
@@ -0,0 +1,83 @@
+#ifndef STRESS_H
+#define STRESS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// randomized differential testing of SplayTree
+// against a multiset reference, a std::map from
+// key to count (see fuzz.cpp for the
+// multithreaded driver).
+//
+// a run applies a long random sequence of
+// insert / find / remove / range / rank / select,
+// finger find / insert / next / prev and
+// insertMulti / removeOne operations (and a few
+// rekey, extract, eraseRange, pop, eraseIf and
+// rebuild ones) to a tree and to the reference,
+// and checks every result, the size and the
+// weight after every operation. every
+// validateEvery operations the whole tree is
+// checked with validateTree and compared against
+// the reference key by key and count by count.
+//
+// everything is derived from the seed, so a run
+// is reproducible: the same config fails at the
+// same operation every time.
+
+struct StressConfig {
+  uint64_t seed;
+  long long ops;
+  // keys are drawn from [0, keyRange). small
+  // ranges mean many hits and duplicate inserts,
+  // large ones mostly misses
+  int keyRange;
+  long long validateEvery;
+  // run the tree with a membership filter
+  // (see SplayTree::enableFilter), sized for a
+  // small tree so it also gets rebuilt
+  bool filter;
+  // and/or with a small hot-key cache, so
+  // finds often don't splay
+  bool hotCache;
+  // and/or frozen (reads don't splay) with
+  // periodic access-weighted rebuilds
+  bool frozen;
+
+  StressConfig()
+    : seed(1),
+      ops(100000),
+      keyRange(1 << 14),
+      validateEvery(10000),
+      filter(false),
+      hotCache(false),
+      frozen(false) { }
+};
+
+struct StressResult {
+  bool ok;
+  // operations applied, including the failing one
+  long long ops;
+  // index of the failing operation, -1 if none
+  long long failedOp;
+  std::string why;
+  // size and hash of the final tree, so that
+  // runs can be compared for reproducibility
+  int size;
+  long long hash;
+};
+
+// seed for one worker of a multithreaded run,
+// so each worker's run can be repeated alone
+uint64_t stressWorkerSeed(uint64_t seed, int worker);
+
+// run c on a fresh tree. stop (if given) is polled
+// every few thousand operations to end the run
+// early, and progress (if given) counts the
+// operations done so far
+bool runStress(const StressConfig &c, StressResult &r,
+               const std::atomic<bool> * stop = nullptr,
+               std::atomic<long long> * progress = nullptr);
+
+#endif
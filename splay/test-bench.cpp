@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "test-bench.h"
+#include "btree.h"
+#include "histogram.h"
+#include "perf-counters.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( BenchSupportTest );
+
+// check key counts, ordering and that all 
+// leaves are at the same depth. 
+// returns the number of keys below node 
+static long long checkBTree(BTNode * node, bool isRoot, int depth, 
+                            int &leafDepth, long long lo, long long hi) {
+  CPPUNIT_ASSERT(node->n <= 2 * BTREE_T - 1);
+  CPPUNIT_ASSERT(isRoot || node->n >= BTREE_T - 1);
+  for (int i = 0; i < node->n; i++) {
+    CPPUNIT_ASSERT(node->keys[i] > lo && node->keys[i] < hi);
+    if (i > 0) CPPUNIT_ASSERT(node->keys[i - 1] < node->keys[i]);
+  }
+
+  if (node->leaf) {
+    if (leafDepth < 0) leafDepth = depth;
+    CPPUNIT_ASSERT(leafDepth == depth);
+    return node->n;
+  }
+
+  long long total = node->n;
+  for (int i = 0; i <= node->n; i++) {
+    long long clo = i == 0 ? lo : node->keys[i - 1];
+    long long chi = i == node->n ? hi : node->keys[i];
+    total += checkBTree(node->child[i], false, depth + 1, leafDepth, clo, chi);
+  }
+  return total;
+}
+
+// random inserts/removes (with repeats and misses), 
+// enough to grow and shrink the tree by several levels 
+void BenchSupportTest::testBTreeMatchesSet() {
+  BTree bt;
+  set<int> s;
+
+  srand(36);
+  for (int i = 0; i < 60000; i++) {
+    int k = rand() % 20000;
+    // insert-heavy first half, remove-heavy second 
+    bool ins = (rand() % 10) < (i < 30000 ? 7 : 3);
+    if (ins)
+      CPPUNIT_ASSERT(bt.insert(k) == s.insert(k).second);
+    else 
+      CPPUNIT_ASSERT(bt.remove(k) == (s.erase(k) > 0));
+
+    if (i % 5000 == 0 && bt.root != nullptr) {
+      int leafDepth = -1;
+      CPPUNIT_ASSERT(checkBTree(bt.root, true, 0, leafDepth, 
+                                -(1LL << 40), 1LL << 40) == (long long) s.size());
+    }
+  }
+
+  CPPUNIT_ASSERT(bt.getSize() == (long long) s.size());
+  for (int k = -5; k < 20005; k++)
+    CPPUNIT_ASSERT(bt.find(k) == (s.count(k) > 0));
+
+  for (int j = 0; j < 200; j++) {
+    int lo = rand() % 20000;
+    int hi = lo + rand() % 500;
+    long long sum = 0;
+    for (auto it = s.lower_bound(lo); it != s.end() && *it <= hi; ++it)
+      sum += *it;
+    CPPUNIT_ASSERT(bt.sumRange(lo, hi) == sum);
+  }
+
+  // drain it completely 
+  vector<int> keys(s.begin(), s.end());
+  shuffle(keys.begin(), keys.end(), mt19937(1));
+  for (int k : keys)
+    CPPUNIT_ASSERT(bt.remove(k));
+  CPPUNIT_ASSERT(bt.root == nullptr && bt.getSize() == 0);
+}
+
+// percentiles are within one bucket (~3%) of 
+// the exact nearest-rank value 
+void BenchSupportTest::testHistogramPercentiles() {
+  LatencyHistogram h;
+  CPPUNIT_ASSERT(h.percentile(0.5) == 0);
+
+  vector<uint64_t> vs;
+  srand(7);
+  for (int i = 0; i < 100000; i++) {
+    // heavy tail: mostly small, a few huge 
+    uint64_t v = rand() % 1000;
+    if (i % 100 == 0) v *= 1000;
+    if (i % 10000 == 0) v = 1ULL << 40;
+    vs.push_back(v);
+    h.record(v);
+  }
+  sort(vs.begin(), vs.end());
+
+  CPPUNIT_ASSERT(h.count() == vs.size());
+  CPPUNIT_ASSERT(h.min() == vs.front() && h.max() == vs.back());
+  for (double q : {0.0, 0.5, 0.9, 0.99, 0.999, 1.0}) {
+    uint64_t exact = vs[max(0, (int) ceil(q * vs.size()) - 1)];
+    uint64_t got = h.percentile(q);
+    CPPUNIT_ASSERT(got >= exact);
+    CPPUNIT_ASSERT(got <= exact + exact / 32 + 1);
+  }
+
+  // merging two halves is the same as recording everything 
+  LatencyHistogram a, b;
+  for (int i = 0; i < vs.size(); i++)
+    (i % 2 ? a : b).record(vs[i]);
+  a.merge(b);
+  for (double q : {0.5, 0.99, 0.999})
+    CPPUNIT_ASSERT(a.percentile(q) == h.percentile(q));
+
+  h.reset();
+  CPPUNIT_ASSERT(h.count() == 0 && h.max() == 0);
+}
+
+// counters may or may not be allowed here, but 
+// unavailable ones must read as 0 and never fail 
+void BenchSupportTest::testPerfCountersFallback() {
+  PerfCounters pc;
+  for (int e = 0; e < PERF_NUM_EVENTS; e++)
+    CPPUNIT_ASSERT(! pc.available(e) && pc.value(e) == 0);
+
+  bool any = pc.open();
+  CPPUNIT_ASSERT(any == pc.anyAvailable());
+
+  volatile long long sum = 0;
+  pc.start();
+  for (int i = 0; i < 100000; i++)
+    sum += i;
+  pc.stop();
+
+  for (int e = 0; e < PERF_NUM_EVENTS; e++)
+    if (! pc.available(e))
+      CPPUNIT_ASSERT(pc.value(e) == 0);
+  if (pc.available(PERF_INSTRUCTIONS))
+    CPPUNIT_ASSERT(pc.value(PERF_INSTRUCTIONS) >= 100000);
+
+  pc.close();
+  CPPUNIT_ASSERT(! pc.anyAvailable());
+}
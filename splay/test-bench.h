@@ -0,0 +1,25 @@
+#ifndef TEST_BENCH_H
+#define TEST_BENCH_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "btree.h"
+#include "histogram.h"
+#include "perf-counters.h"
+
+// the benchmark baselines and measurements 
+// have to be right before their numbers mean anything 
+class BenchSupportTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(BenchSupportTest);
+  CPPUNIT_TEST(testBTreeMatchesSet);
+  CPPUNIT_TEST(testHistogramPercentiles);
+  CPPUNIT_TEST(testPerfCountersFallback);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testBTreeMatchesSet();
+    void testHistogramPercentiles();
+    void testPerfCountersFallback();
+};
+
+#endif 
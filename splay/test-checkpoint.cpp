@@ -0,0 +1,232 @@
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include "test-checkpoint.h"
+#include "test-utils.h"
+#include "checkpoint.h"
+#include "snapshot.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CheckpointTest );
+
+void CheckpointTest::setUp() {
+  dir = tempDir("splay-checkpoint");
+}
+
+void CheckpointTest::tearDown() {
+  removeDir(dir);
+}
+
+// a few changed keys only rewrite a few chunks 
+void CheckpointTest::testDeltaOnlyChangedChunks() {
+  SplayTree t;
+  for (int i = 0; i < 10000; i++)
+    t.insert(2*i);
+
+  IncrementalCheckpointer ckpt(dir, 100);
+  CPPUNIT_ASSERT(ckpt.writeBase(t));
+  CPPUNIT_ASSERT(ckpt.chunkCount() == 100);
+  CPPUNIT_ASSERT(ckpt.lastChunksWritten() == 100);
+  long long baseBytes = ckpt.lastBytesWritten();
+
+  // nothing changed, nothing written 
+  t.find(500);
+  CPPUNIT_ASSERT(ckpt.writeDelta(t));
+  CPPUNIT_ASSERT(ckpt.lastChunksWritten() == 0);
+
+  // keys 1, 5001 and 19999 fall into 3 different chunks 
+  t.insert(1);
+  t.insert(5001);
+  t.remove(19998);
+  t.insert(19999);
+  CPPUNIT_ASSERT(ckpt.writeDelta(t));
+  CPPUNIT_ASSERT(ckpt.lastChunksWritten() == 3);
+  CPPUNIT_ASSERT(ckpt.lastBytesWritten() * 20 < baseBytes);
+
+  // keys beyond the last bound go to the last chunk 
+  t.insert(50000);
+  CPPUNIT_ASSERT(ckpt.writeDelta(t));
+  CPPUNIT_ASSERT(ckpt.lastChunksWritten() == 1);
+
+  // a copy moving between keys of one chunk keeps 
+  // its size, weight and hash, but not its counts 
+  t.insertMulti(10);
+  t.insertMulti(12);
+  CPPUNIT_ASSERT(ckpt.writeDelta(t));
+  CPPUNIT_ASSERT(ckpt.lastChunksWritten() == 1);
+  t.insertMulti(10);
+  t.removeOne(12);
+  CPPUNIT_ASSERT(ckpt.writeDelta(t));
+  CPPUNIT_ASSERT(ckpt.lastChunksWritten() == 1);
+
+  SplayTree loaded;
+  IncrementalCheckpointer reader(dir, 100);
+  CPPUNIT_ASSERT(reader.load(loaded));
+  CPPUNIT_ASSERT(loaded.getCount(10) == 3);
+  CPPUNIT_ASSERT(loaded.getCount(12) == 1);
+}
+
+// base + several deltas rebuild the same tree 
+void CheckpointTest::testLoadBaseAndDeltas() {
+  SplayTree t;
+  for (int i : randomInts(3000, 16, 100000))
+    t.insert(i);
+
+  IncrementalCheckpointer ckpt(dir, 64);
+  CPPUNIT_ASSERT(ckpt.writeDelta(t));   // no base yet: writes one 
+
+  for (int round = 0; round < 5; round++) {
+    for (int j = 0; j < 50; j++) {
+      int k = rand() % 100000;
+      if (t.find(k) != nullptr)
+        t.remove(k);
+      else 
+        t.insertMulti(k);
+    }
+    t.eraseRange(round * 1000, round * 1000 + 300);
+    CPPUNIT_ASSERT(ckpt.writeDelta(t));
+
+    SplayTree loaded;
+    IncrementalCheckpointer reader(dir, 64);
+    CPPUNIT_ASSERT(reader.load(loaded));
+    CPPUNIT_ASSERT(loaded == t);
+    CPPUNIT_ASSERT(loaded.getWeight() == t.getWeight());
+
+    SubtreeSizePred sspred;
+    SubtreeHashPred shpred;
+    CPPUNIT_ASSERT(sspred.testTree(loaded));
+    CPPUNIT_ASSERT(shpred.testTree(loaded));
+  }
+
+  // a loaded checkpointer continues the delta chain 
+  SplayTree loaded;
+  IncrementalCheckpointer resumed(dir, 64);
+  CPPUNIT_ASSERT(resumed.load(loaded));
+  loaded.insert(-5);
+  CPPUNIT_ASSERT(resumed.writeDelta(loaded));
+  CPPUNIT_ASSERT(resumed.lastChunksWritten() == 1);
+
+  SplayTree again;
+  IncrementalCheckpointer reader(dir, 64);
+  CPPUNIT_ASSERT(reader.load(again));
+  CPPUNIT_ASSERT(again == loaded);
+
+  // a new base makes the old deltas stale 
+  CPPUNIT_ASSERT(resumed.writeBase(loaded));
+  SplayTree fromBase;
+  IncrementalCheckpointer reader2(dir, 64);
+  CPPUNIT_ASSERT(reader2.load(fromBase));
+  CPPUNIT_ASSERT(fromBase == loaded);
+}
+
+// patch the base header with a valid header 
+// checksum, so only the field checks catch it 
+static void patchHeader(const string &path, uint64_t numChunks, uint64_t numEntries) {
+  FILE * f = fopen(path.c_str(), "r+b");
+  CheckpointHeader h;
+  CPPUNIT_ASSERT(fread(&h, sizeof(h), 1, f) == 1);
+  h.numChunks = numChunks;
+  h.numEntries = numEntries;
+  h.headerChecksum = checksumBytes(&h, offsetof(CheckpointHeader, headerChecksum));
+  fseek(f, 0, SEEK_SET);
+  CPPUNIT_ASSERT(fwrite(&h, sizeof(h), 1, f) == 1);
+  fclose(f);
+}
+
+// a damaged or inconsistent base header is 
+// rejected before anything is sized from it 
+void CheckpointTest::testCorruptHeader() {
+  SplayTree t;
+  for (int i = 0; i < 1000; i++)
+    t.insert(i);
+  IncrementalCheckpointer ckpt(dir, 100);
+  CPPUNIT_ASSERT(ckpt.writeBase(t));
+  string base = dir + "/base.ckpt";
+
+  // a flipped bit in the header 
+  FILE * f = fopen(base.c_str(), "r+b");
+  fseek(f, offsetof(CheckpointHeader, numChunks), SEEK_SET);
+  int c = fgetc(f);
+  fseek(f, offsetof(CheckpointHeader, numChunks), SEEK_SET);
+  fputc(c ^ 1, f);
+  fclose(f);
+  SplayTree loaded;
+  IncrementalCheckpointer reader(dir, 100);
+  CPPUNIT_ASSERT(! reader.load(loaded));
+
+  // fewer entries than chunks, and more chunks 
+  // than the file can hold 
+  CPPUNIT_ASSERT(ckpt.writeBase(t));
+  patchHeader(base, 10, 5);
+  CPPUNIT_ASSERT(! reader.load(loaded));
+  patchHeader(base, 1ULL << 40, 1ULL << 40);
+  CPPUNIT_ASSERT(! reader.load(loaded));
+
+  patchHeader(base, 10, 10);
+  CPPUNIT_ASSERT(reader.load(loaded));
+  CPPUNIT_ASSERT(loaded == t);
+}
+
+static string readBytes(const string &path) {
+  string data;
+  FILE * f = fopen(path.c_str(), "rb");
+  CPPUNIT_ASSERT(f != nullptr);
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.append(buf, n);
+  fclose(f);
+  return data;
+}
+
+static void writeBytes(const string &path, const string &data) {
+  FILE * f = fopen(path.c_str(), "wb");
+  fwrite(data.data(), 1, data.size(), f);
+  fclose(f);
+}
+
+// a fresh checkpointer writes a new base over an 
+// old one with deltas, and the process dies after 
+// the rename but before the deltas are removed. 
+// the old deltas must not apply to the new base 
+void CheckpointTest::testStaleDeltasAfterCrash() {
+  SplayTree t;
+  for (int i = 0; i < 1000; i++)
+    t.insert(i);
+  {
+    IncrementalCheckpointer ckpt(dir, 100);
+    CPPUNIT_ASSERT(ckpt.writeBase(t));
+    t.insert(5000);
+    t.remove(10);
+    CPPUNIT_ASSERT(ckpt.writeDelta(t));
+    t.remove(500);
+    CPPUNIT_ASSERT(ckpt.writeDelta(t));
+  }
+  string delta1 = readBytes(dir + "/delta-000001.ckpt");
+  string delta2 = readBytes(dir + "/delta-000002.ckpt");
+
+  // a different tree, from a checkpointer that 
+  // never loaded the old base 
+  SplayTree other;
+  for (int i = 0; i < 1000; i++)
+    other.insert(3 * i);
+  IncrementalCheckpointer fresh(dir, 100);
+  CPPUNIT_ASSERT(fresh.writeBase(other));
+  writeBytes(dir + "/delta-000001.ckpt", delta1);
+  writeBytes(dir + "/delta-000002.ckpt", delta2);
+
+  SplayTree loaded;
+  IncrementalCheckpointer reader(dir, 100);
+  CPPUNIT_ASSERT(reader.load(loaded));
+  CPPUNIT_ASSERT(loaded == other);
+
+  // and the chain continues past the stale files 
+  loaded.insert(1);
+  CPPUNIT_ASSERT(reader.writeDelta(loaded));
+  SplayTree again;
+  IncrementalCheckpointer reader2(dir, 100);
+  CPPUNIT_ASSERT(reader2.load(again));
+  CPPUNIT_ASSERT(again == loaded);
+}
@@ -0,0 +1,29 @@
+#ifndef TEST_CHECKPOINT_H
+#define TEST_CHECKPOINT_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "checkpoint.h"
+
+class CheckpointTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(CheckpointTest);
+  CPPUNIT_TEST(testDeltaOnlyChangedChunks);
+  CPPUNIT_TEST(testLoadBaseAndDeltas);
+  CPPUNIT_TEST(testCorruptHeader);
+  CPPUNIT_TEST(testStaleDeltasAfterCrash);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+
+    void testDeltaOnlyChangedChunks();
+    void testLoadBaseAndDeltas();
+    void testCorruptHeader();
+    void testStaleDeltasAfterCrash();
+
+  private:
+    std::string dir;
+};
+
+#endif 
@@ -0,0 +1,164 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "test-disk-splay.h"
+#include "test-utils.h"
+#include "splay.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( DiskSplayTest );
+
+void DiskSplayTest::setUp() {
+  path = tempFile("splay-disk");
+}
+
+void DiskSplayTest::tearDown() {
+  remove(path.c_str());
+}
+
+static void copyFile(const string &from, const string &to) {
+  FILE * in = fopen(from.c_str(), "rb");
+  FILE * out = fopen(to.c_str(), "wb");
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+    fwrite(buf, 1, n, out);
+  fclose(in);
+  fclose(out);
+}
+
+// same operations on both trees give the same 
+// root, hash and answers, with a pool much 
+// smaller than the tree 
+void DiskSplayTest::testMatchesSplayTree() {
+  DiskSplayTree d;
+  CPPUNIT_ASSERT(d.open(path, 8));
+  SplayTree t;
+
+  CPPUNIT_ASSERT(d.getSize() == 0 && d.getHash() == 0);
+  srand(47);
+  for (int i = 0; i < 20000; i++) {
+    int k = rand() % 5000;
+    int op = rand() % 5;
+    if (op == 0 || op == 1) {
+      if (t.find(k) == nullptr)
+        t.insert(k);
+      if (! d.find(k))
+        d.insert(k);
+    } else if (op == 2) {
+      CPPUNIT_ASSERT(d.find(k) == (t.find(k) != nullptr));
+    } else if (op == 3) {
+      t.remove(k);
+      d.remove(k);
+    } else if (rand() % 2 == 0) {
+      CPPUNIT_ASSERT(d.rank(k) == t.rank(k));
+    } else {
+      int key = -1;
+      int j = t.getSize() == 0 ? 0 : rand() % (t.getSize() + 1);
+      STNode * n = t.select(j);
+      CPPUNIT_ASSERT(d.select(j, key) == (n != nullptr));
+      if (n != nullptr)
+        CPPUNIT_ASSERT(key == n->key);
+    }
+
+    CPPUNIT_ASSERT(d.getSize() == t.getSize());
+    if (t.root != nullptr)
+      CPPUNIT_ASSERT(d.rootKey() == t.root->key);
+  }
+
+  CPPUNIT_ASSERT(d.getHash() == t.getHash());
+  vector<int> dv, tv;
+  d.getInorder(dv);
+  t.getInorder(tv);
+  CPPUNIT_ASSERT(dv == tv);
+
+  BufferPoolStats s = d.getPoolStats();
+  CPPUNIT_ASSERT(s.frames == 8);
+  CPPUNIT_ASSERT(s.evictions > 0 && s.writebacks > 0);
+  CPPUNIT_ASSERT(s.hitRate() > 0.5);
+  CPPUNIT_ASSERT(d.close());
+}
+
+// the tree survives close and reopen, and 
+// freed slots are reused before the file grows 
+void DiskSplayTest::testReopen() {
+  vector<int> keys = randomInts(3000, 48, 1000000);
+  SplayTree t;
+  {
+    DiskSplayTree d;
+    CPPUNIT_ASSERT(d.open(path, 16));
+    for (int k : keys) {
+      if (t.find(k) == nullptr) {
+        t.insert(k);
+        d.insert(k);
+      }
+    }
+    CPPUNIT_ASSERT(d.close());
+    CPPUNIT_ASSERT(! d.isOpen());
+  }
+
+  DiskSplayTree d;
+  CPPUNIT_ASSERT(d.open(path, 16));
+  CPPUNIT_ASSERT(d.getSize() == t.getSize());
+  CPPUNIT_ASSERT(d.getHash() == t.getHash());
+  CPPUNIT_ASSERT(d.rootKey() == t.root->key);
+  vector<int> dv, tv;
+  d.getInorder(dv);
+  t.getInorder(tv);
+  CPPUNIT_ASSERT(dv == tv);
+
+  long long pages = d.numPages();
+  CPPUNIT_ASSERT(pages == 1 + (t.getSize() + DISK_NODES_PER_PAGE - 1) / DISK_NODES_PER_PAGE);
+  for (int i = 0; i < 1000; i++) {
+    d.remove(tv[i]);
+    t.remove(tv[i]);
+  }
+  for (int i = 0; i < 1000; i++) {
+    d.insert(-1 - i);
+    t.insert(-1 - i);
+  }
+  CPPUNIT_ASSERT(d.numPages() == pages);
+  CPPUNIT_ASSERT(d.getHash() == t.getHash());
+  CPPUNIT_ASSERT(d.close());
+
+  // not a tree file 
+  FILE * f = fopen(path.c_str(), "r+");
+  fputs("garbage!", f);
+  fclose(f);
+  CPPUNIT_ASSERT(! d.open(path, 16));
+  CPPUNIT_ASSERT(! d.isOpen());
+}
+
+// a copy of the file taken between flushes is 
+// what a crash would leave: evicted pages are 
+// newer than the header, and open() refuses it 
+void DiskSplayTest::testUnflushed() {
+  string crashed = path + ".crashed";
+  DiskSplayTree d;
+  CPPUNIT_ASSERT(d.open(path, 4));
+  for (int i = 0; i < 2000; i++)
+    d.insert(i);
+  CPPUNIT_ASSERT(d.flush());
+  int size = d.getSize();
+  ll hash = d.getHash();
+
+  // reads splay, so they change the file too 
+  for (int i = 0; i < 2000; i += 7)
+    d.find(i);
+  CPPUNIT_ASSERT(d.getPoolStats().writebacks > 0);
+  copyFile(path, crashed);
+  DiskSplayTree other;
+  CPPUNIT_ASSERT(! other.open(crashed, 4));
+
+  // after a flush the copy opens again 
+  CPPUNIT_ASSERT(d.flush());
+  copyFile(path, crashed);
+  CPPUNIT_ASSERT(other.open(crashed, 4));
+  CPPUNIT_ASSERT(other.getSize() == size);
+  CPPUNIT_ASSERT(other.getHash() == hash);
+  CPPUNIT_ASSERT(other.close());
+  CPPUNIT_ASSERT(d.close());
+  remove(crashed.c_str());
+}
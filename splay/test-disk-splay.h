@@ -0,0 +1,27 @@
+#ifndef TEST_DISK_SPLAY_H
+#define TEST_DISK_SPLAY_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "disk-splay.h"
+
+class DiskSplayTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DiskSplayTest);
+  CPPUNIT_TEST(testMatchesSplayTree);
+  CPPUNIT_TEST(testReopen);
+  CPPUNIT_TEST(testUnflushed);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+
+    void testMatchesSplayTree();
+    void testReopen();
+    void testUnflushed();
+
+  private:
+    std::string path;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include <cstdlib>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "test-euler-tour.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( EulerTourTest );
+
+// a star around 0 with a tail 4 - 5 
+void EulerTourTest::testStar() {
+  EulerTourForest f(6);
+  for (int i = 0; i < 6; i++)
+    f.setValue(i, 1 << i);
+  for (int i = 1; i < 5; i++)
+    CPPUNIT_ASSERT(f.link(0, i));
+  CPPUNIT_ASSERT(f.link(5, 4));
+  CPPUNIT_ASSERT(! f.link(1, 5));
+  CPPUNIT_ASSERT(f.componentSize(3) == 6);
+  CPPUNIT_ASSERT(f.componentSum(3) == 63);
+  CPPUNIT_ASSERT(f.subtreeSum(4, 0) == 16 + 32);
+  CPPUNIT_ASSERT(f.subtreeSum(0, 4) == 1 + 2 + 4 + 8);
+  CPPUNIT_ASSERT(f.subtreeSum(2, 0) == 4);
+
+  CPPUNIT_ASSERT(! f.cut(1, 2));
+  CPPUNIT_ASSERT(f.cut(4, 0));
+  CPPUNIT_ASSERT(! f.connected(5, 1));
+  CPPUNIT_ASSERT(f.connected(4, 5));
+  CPPUNIT_ASSERT(f.componentSize(0) == 4 && f.componentSize(5) == 2);
+  CPPUNIT_ASSERT(f.componentSum(5) == 48);
+
+  f.setValue(5, -2);
+  CPPUNIT_ASSERT(f.getValue(5) == -2 && f.componentSum(4) == 14);
+  CPPUNIT_ASSERT(f.addVertex(3) == 6);
+  CPPUNIT_ASSERT(f.link(6, 5));
+  CPPUNIT_ASSERT(f.componentSize(4) == 3 && f.componentSum(4) == 17);
+}
+
+// sum of the values reachable from v 
+// without crossing v - p 
+static int sideSum(const vector<set<int>> &adj, const vector<int> &value, 
+                   int v, int p, vector<bool> &seen) {
+  vector<int> stack = {v};
+  seen[v] = true;
+  int sum = 0;
+  while (! stack.empty()) {
+    int x = stack.back();
+    stack.pop_back();
+    sum += value[x];
+    for (int y : adj[x]) {
+      if (seen[y] || (x == v && y == p)) continue;
+      seen[y] = true;
+      stack.push_back(y);
+    }
+  }
+  return sum;
+}
+
+// random links, cuts and value changes, with 
+// every query checked by a search of the graph 
+void EulerTourTest::testMatchesBfs() {
+  const int n = 150;
+  EulerTourForest f(n);
+  vector<set<int>> adj(n);
+  vector<int> value(n, 0);
+  vector<pair<int,int>> edges;
+  srand(48);
+
+  for (int i = 0; i < 10000; i++) {
+    int u = rand() % n, v = rand() % n;
+    int op = rand() % 6;
+    vector<bool> seen(n, false);
+    sideSum(adj, value, u, -1, seen);
+    bool conn = seen[v];
+
+    if (op < 2) {
+      CPPUNIT_ASSERT(f.link(u, v) == ! conn);
+      if (! conn) {
+        adj[u].insert(v);
+        adj[v].insert(u);
+        edges.push_back({u, v});
+      }
+    } else if (op == 2 && ! edges.empty()) {
+      int j = rand() % edges.size();
+      pair<int,int> e = edges[j];
+      edges[j] = edges.back();
+      edges.pop_back();
+      adj[e.first].erase(e.second);
+      adj[e.second].erase(e.first);
+      CPPUNIT_ASSERT(rand() % 2 ? f.cut(e.first, e.second) : f.cut(e.second, e.first));
+      CPPUNIT_ASSERT(! f.cut(e.first, e.second));
+    } else if (op == 3) {
+      value[u] = rand() % 100;
+      f.setValue(u, value[u]);
+    } else {
+      CPPUNIT_ASSERT(f.connected(u, v) == conn);
+      int size = 0, sum = 0;
+      for (int x = 0; x < n; x++) {
+        if (seen[x]) {
+          size++;
+          sum += value[x];
+        }
+      }
+      CPPUNIT_ASSERT(f.componentSize(u) == size);
+      CPPUNIT_ASSERT(f.componentSum(u) == sum);
+      if (conn)
+        CPPUNIT_ASSERT(f.componentSum(v) == sum);
+      if (! adj[u].empty()) {
+        int p = *adj[u].begin();
+        vector<bool> side(n, false);
+        CPPUNIT_ASSERT(f.subtreeSum(u, p) == sideSum(adj, value, u, p, side));
+      }
+    }
+  }
+}
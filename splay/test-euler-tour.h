@@ -0,0 +1,19 @@
+#ifndef TEST_EULER_TOUR_H
+#define TEST_EULER_TOUR_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "euler-tour.h"
+
+class EulerTourTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(EulerTourTest);
+  CPPUNIT_TEST(testStar);
+  CPPUNIT_TEST(testMatchesBfs);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testStar();
+    void testMatchesBfs();
+};
+
+#endif
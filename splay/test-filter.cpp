@@ -0,0 +1,109 @@
+#include <set>
+#include <vector>
+
+#include "test-filter.h"
+#include "test-utils.h"
+#include "splay.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( FilterTest );
+
+// every added key is reported, also after other 
+// keys are removed, and absent keys are mostly 
+// ruled out, at about the target rate 
+void FilterTest::testNoFalseNegatives() {
+  KeyFilter f(10000, 0.01);
+  set<int> keys;
+  for (int i : randomInts(10000, 43, 1 << 30)) {
+    if (keys.insert(i).second)
+      f.add(i);
+  }
+  int n = 0;
+  for (int i : keys) {
+    if (n++ % 2 == 0) continue;
+    f.remove(i);
+  }
+  for (int i : randomInts(5000, 44, 1 << 30)) {
+    if (keys.count(i) == 0) {
+      keys.insert(i);
+      f.add(i);
+    }
+  }
+
+  // the removed ones are gone from keys too 
+  n = 0;
+  for (auto it = keys.begin(); it != keys.end(); ) {
+    if (f.mayContain(*it))
+      ++it;
+    else
+      it = keys.erase(it);
+  }
+  CPPUNIT_ASSERT(f.size() >= 9000 && f.size() <= keys.size());
+
+  int falsePositives = 0, absent = 0;
+  for (int i = -100000; i < 0; i++) {
+    absent++;
+    falsePositives += f.mayContain(i);
+  }
+  CPPUNIT_ASSERT(falsePositives < absent * 0.03);
+
+  f.clear();
+  CPPUNIT_ASSERT(f.size() == 0 && ! f.mayContain(*keys.begin()));
+}
+
+// every mutation keeps the filter in step, 
+// the tree ends up exactly as without a filter, 
+// and the filter grows with the tree 
+void FilterTest::testTreeInSync() {
+  SplayTree plain, filtered;
+  filtered.enableFilter(100, 0.01);
+  vector<int> ins = randomInts(5000, 45, 100000);
+  for (SplayTree * t : {&plain, &filtered}) {
+    for (int i : ins) {
+      if (t->find(i) == nullptr)
+        t->insert(i);
+    }
+    for (int i = 0; i < 100000; i += 7)
+      t->remove(i);
+    t->eraseRange(20000, 30000);
+    t->eraseIf([](int k) { return k % 5 == 0; });
+    t->popMin();
+    t->popMax();
+    for (int i = 1; i < 50000; i += 97) {
+      t->rekey(i, i + 1);
+      t->rekey(i + 3, 200000 + i);
+    }
+    NodeHandle nh = t->extract(t->root->key);
+    nh.key() = -1;
+    t->insert(std::move(nh));
+    t->insertMulti(-1);
+    t->removeOne(-1);
+    for (int i = 0; i < 100000; i += 3)
+      t->find(i);
+  }
+
+  CPPUNIT_ASSERT(plain == filtered);
+  CPPUNIT_ASSERT(plain.root->key == filtered.root->key);
+  CPPUNIT_ASSERT(validateTree(filtered));
+
+  vector<int> keys;
+  filtered.getInorder(keys);
+  for (int k : keys)
+    CPPUNIT_ASSERT(filtered.find(k) != nullptr);
+
+  FilterStats s = filtered.getFilterStats();
+  CPPUNIT_ASSERT(s.keys == filtered.getSize());
+  CPPUNIT_ASSERT(s.rebuilds > 0 && 2 * s.capacity >= s.keys);
+  CPPUNIT_ASSERT(s.definiteMisses > 0);
+  CPPUNIT_ASSERT(s.observedFpRate() < 0.05);
+  CPPUNIT_ASSERT(s.lookups >= s.definiteMisses + s.falsePositives);
+
+  // enabling again resizes and resets the stats 
+  filtered.enableFilter(1000000);
+  s = filtered.getFilterStats();
+  CPPUNIT_ASSERT(s.keys == filtered.getSize() && s.lookups == 0);
+  CPPUNIT_ASSERT(filtered.find(keys[0]) != nullptr);
+  filtered.disableFilter();
+  CPPUNIT_ASSERT(! filtered.hasFilter() && filtered.find(keys[0]) != nullptr);
+}
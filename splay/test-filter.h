@@ -0,0 +1,19 @@
+#ifndef TEST_FILTER_H
+#define TEST_FILTER_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "filter.h"
+
+class FilterTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(FilterTest);
+  CPPUNIT_TEST(testNoFalseNegatives);
+  CPPUNIT_TEST(testTreeInSync);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testNoFalseNegatives();
+    void testTreeInSync();
+};
+
+#endif 
@@ -0,0 +1,150 @@
+#include <cstdlib>
+#include <vector>
+
+#include "test-forest.h"
+#include "test-utils.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ForestTest );
+
+// every way of adding and removing nodes 
+// goes through the tree's allocator 
+void ForestTest::testAccounting() {
+  SplayForest f(64);
+  int a = f.createTree(), b = f.createTree();
+  CPPUNIT_ASSERT(f.getNumTrees() == 2);
+
+  for (int i = 0; i < 500; i++)
+    CPPUNIT_ASSERT(f.insert(i % 2 ? a : b, i));
+  CPPUNIT_ASSERT(! f.insert(a, 1));
+  SplayTree &ta = f.tree(a);
+  SplayTree &tb = f.tree(b);
+  ta.insertMulti(1);
+  ta.remove(3);
+  ta.popMin();
+  ta.popMax();
+  ta.eraseRange(100, 199);
+  ta.eraseIf([](int k) { return k % 10 == 1; });
+  ta.removeOne(1);
+  tb.rekey(0, -1);
+
+  // a node moves between a forest tree and 
+  // a heap tree by copy 
+  SplayTree heap;
+  CPPUNIT_ASSERT(heap.insert(tb.extract(2)));
+  heap.insert(1000);
+  CPPUNIT_ASSERT(tb.insert(heap.extract(1000)));
+  {
+    NodeHandle h = tb.extract(4);
+    CPPUNIT_ASSERT(! h.empty());
+    CPPUNIT_ASSERT(f.getTreeStats(b).nodes == tb.getSize() + 1);
+  }
+
+  CPPUNIT_ASSERT(validateTree(ta) && validateTree(tb));
+  TreeMemoryStats sa = f.getTreeStats(a), sb = f.getTreeStats(b);
+  CPPUNIT_ASSERT(sa.nodes == ta.getSize() && sb.nodes == tb.getSize());
+  CPPUNIT_ASSERT(sa.bytes == sa.nodes * (long long) sizeof(STNode));
+  CPPUNIT_ASSERT(sa.maxDepth >= 0 && sa.avgDepth <= sa.maxDepth);
+
+  ForestStats s = f.getStats();
+  CPPUNIT_ASSERT(s.trees == 2 && s.nodes == sa.nodes + sb.nodes);
+  CPPUNIT_ASSERT(s.arena.liveSlots == s.nodes);
+  CPPUNIT_ASSERT(s.arena.reservedBytes == (s.arena.liveSlots + s.arena.freeSlots) * (long long) sizeof(STNode));
+  CPPUNIT_ASSERT(s.utilization() > 0 && s.utilization() <= 1);
+
+  // nodes for buildFromSorted come from 
+  // the tree's allocator 
+  vector<STNode *> nodes;
+  SplayTree src;
+  for (int i = 0; i < 100; i++)
+    src.insert(i);
+  int c = f.createTree();
+  for (int i = 0; i < 100; i++)
+    nodes.push_back(f.tree(c).allocNode(i));
+  f.tree(c).buildFromSorted(nodes);
+  CPPUNIT_ASSERT(f.tree(c) == src);
+  CPPUNIT_ASSERT(f.getTreeStats(c).nodes == 100);
+
+  f.dropTree(a);
+  CPPUNIT_ASSERT(! f.hasTree(a) && f.getNumTrees() == 2);
+  CPPUNIT_ASSERT(f.getStats().nodes == sb.nodes + 100);
+  CPPUNIT_ASSERT(f.createTree() == a);
+  CPPUNIT_ASSERT(f.getTreeStats(a).nodes == 0 && f.getTreeStats(a).maxDepth == -1);
+}
+
+void ForestTest::testQuota() {
+  SplayForest f;
+  int t = f.createTree(10 * sizeof(STNode));
+  for (int i = 0; i < 10; i++)
+    CPPUNIT_ASSERT(f.insert(t, i));
+  CPPUNIT_ASSERT(! f.insert(t, 10));
+  CPPUNIT_ASSERT(f.tree(t).getSize() == 10);
+  CPPUNIT_ASSERT(f.getTreeStats(t).quotaBytes == 10 * (long long) sizeof(STNode));
+
+  f.tree(t).remove(0);
+  CPPUNIT_ASSERT(f.insert(t, 10));
+  f.setQuota(t, 0);
+  CPPUNIT_ASSERT(f.insert(t, 11));
+}
+
+// trees built in interleaved order are scattered 
+// over the slabs; compacting puts each one in a 
+// single run, and dropped trees' slabs come back 
+void ForestTest::testCompaction() {
+  SplayForest f(128);
+  vector<int> ids;
+  for (int i = 0; i < 8; i++)
+    ids.push_back(f.createTree());
+  vector<int> keys = randomInts(4000, 50, 1000000);
+  for (int i = 0; i < keys.size(); i++)
+    f.insert(ids[i % 8], keys[i]);
+
+  vector<ll> hashes;
+  for (int id : ids)
+    hashes.push_back(f.tree(id).getHash());
+
+  SplayTree &t = f.tree(ids[0]);
+  t.enableHotCache();
+  int k = t.root->key;
+  t.find(k);
+  int rootKey = t.root->key, minKey = t.peekMin()->key;
+  TreeMemoryStats before = f.getTreeStats(ids[0]);
+
+  CPPUNIT_ASSERT(f.compact(ids[0]));
+  CPPUNIT_ASSERT(validateTree(t));
+  CPPUNIT_ASSERT(t.getHash() == hashes[0]);
+  CPPUNIT_ASSERT(t.root->key == rootKey && t.peekMin()->key == minKey);
+  TreeMemoryStats after = f.getTreeStats(ids[0]);
+  CPPUNIT_ASSERT(after.nodes == before.nodes && after.maxDepth == before.maxDepth);
+
+  // preorder in one block: the root first, and 
+  // every node within the block 
+  char * lo = (char *) t.root;
+  char * hi = lo + t.getSize() * sizeof(STNode);
+  vector<int> inorder;
+  t.getInorder(inorder);
+  for (int key : inorder) {
+    char * p = (char *) t.find(key);
+    CPPUNIT_ASSERT(p >= lo && p < hi);
+  }
+  CPPUNIT_ASSERT(t.find(k) != nullptr);
+
+  long long reserved = f.getStats().arena.reservedBytes;
+  for (int i = 1; i < 6; i++)
+    f.dropTree(ids[i]);
+  long long freed = f.defragment();
+  ForestStats s = f.getStats();
+  CPPUNIT_ASSERT(freed > 0);
+  CPPUNIT_ASSERT(s.arena.reservedBytes < reserved);
+  CPPUNIT_ASSERT(s.utilization() > 0.5);
+  for (int i : {0, 6, 7}) {
+    CPPUNIT_ASSERT(validateTree(f.tree(ids[i])));
+    CPPUNIT_ASSERT(f.tree(ids[i]).getHash() == hashes[i]);
+  }
+
+  // a heap tree can't compact 
+  SplayTree heap;
+  heap.insert(1);
+  CPPUNIT_ASSERT(! heap.compact());
+}
@@ -0,0 +1,21 @@
+#ifndef TEST_FOREST_H
+#define TEST_FOREST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "forest.h"
+
+class ForestTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(ForestTest);
+  CPPUNIT_TEST(testAccounting);
+  CPPUNIT_TEST(testQuota);
+  CPPUNIT_TEST(testCompaction);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testAccounting();
+    void testQuota();
+    void testCompaction();
+};
+
+#endif
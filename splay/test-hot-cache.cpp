@@ -0,0 +1,85 @@
+#include <vector>
+
+#include "test-hot-cache.h"
+#include "test-utils.h"
+#include "splay.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( HotCacheTest );
+
+// alternating between two hot keys rotates 
+// them on every find without a cache, and 
+// not at all with one 
+void HotCacheTest::testHitsSkipSplay() {
+  SplayTree t;
+  t.enableHotCache(64);
+  for (int i : randomInts(1000, 46, 100000))
+    t.insert(i);
+  vector<int> keys;
+  t.getInorder(keys);
+  int a = keys[100], b = keys[900];
+
+  t.find(a);
+  t.find(b);
+  CPPUNIT_ASSERT(t.root->key == b);
+  ll hash = t.getHash();
+  for (int i = 0; i < 100; i++) {
+    CPPUNIT_ASSERT(t.find(a)->key == a);
+    CPPUNIT_ASSERT(t.find(b)->key == b);
+  }
+  CPPUNIT_ASSERT(t.root->key == b);
+  CPPUNIT_ASSERT(t.getHash() == hash);
+  CPPUNIT_ASSERT(t.find(-5) == nullptr);
+
+  HotCacheStats s = t.getHotCacheStats();
+  CPPUNIT_ASSERT(s.slots == 64);
+  CPPUNIT_ASSERT(s.hits == 200 && s.misses == 3);
+  CPPUNIT_ASSERT(validateTree(t));
+
+  // other lookups still splay 
+  t.select(100);
+  CPPUNIT_ASSERT(t.root->key == a);
+  t.disableHotCache();
+  t.find(b);
+  CPPUNIT_ASSERT(! t.hasHotCache() && t.root->key == b);
+}
+
+// cached keys that go away (or change) are 
+// never returned, and bulk operations start 
+// over with an empty cache 
+void HotCacheTest::testInvalidation() {
+  SplayTree t;
+  t.enableHotCache(4);
+  for (int i = 0; i < 100; i++)
+    t.insert(i);
+  for (int i = 0; i < 100; i++)
+    t.find(i);
+
+  t.remove(99);
+  CPPUNIT_ASSERT(t.find(99) == nullptr);
+  t.rekey(98, 500);
+  CPPUNIT_ASSERT(t.find(98) == nullptr && t.find(500)->key == 500);
+  t.find(0);
+  t.popMin();
+  CPPUNIT_ASSERT(t.find(0) == nullptr);
+  t.find(97);
+  NodeHandle nh = t.extract(97);
+  CPPUNIT_ASSERT(t.find(97) == nullptr);
+  t.insertMulti(50);
+  t.removeOne(50);
+  t.find(50);
+  t.removeOne(50);
+  CPPUNIT_ASSERT(t.find(50) == nullptr);
+  CPPUNIT_ASSERT(t.getHotCacheStats().invalidations >= 5);
+
+  t.find(10);
+  t.eraseRange(5, 15);
+  CPPUNIT_ASSERT(t.find(10) == nullptr);
+  t.find(20);
+  t.eraseIf([](int k) { return k == 20; });
+  CPPUNIT_ASSERT(t.find(20) == nullptr);
+  CPPUNIT_ASSERT(t.getHotCacheStats().clears == 2);
+  CPPUNIT_ASSERT(t.find(21)->key == 21);
+  CPPUNIT_ASSERT(validateTree(t));
+}
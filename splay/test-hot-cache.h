@@ -0,0 +1,19 @@
+#ifndef TEST_HOT_CACHE_H
+#define TEST_HOT_CACHE_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "hot-cache.h"
+
+class HotCacheTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(HotCacheTest);
+  CPPUNIT_TEST(testHitsSkipSplay);
+  CPPUNIT_TEST(testInvalidation);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testHitsSkipSplay();
+    void testInvalidation();
+};
+
+#endif 
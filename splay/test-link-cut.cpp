@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <vector>
+
+#include "test-link-cut.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( LinkCutTest );
+
+// a path 0 - 1 - .. - 9 rooted at 9, cut 
+// in the middle and linked back the other way 
+void LinkCutTest::testPath() {
+  LinkCutForest f(10);
+  for (int i = 0; i < 10; i++)
+    f.setValue(i, i + 1);
+  for (int i = 0; i < 9; i++)
+    CPPUNIT_ASSERT(f.link(i, i + 1));
+  CPPUNIT_ASSERT(! f.link(0, 9));
+
+  CPPUNIT_ASSERT(f.findRoot(0) == 9);
+  CPPUNIT_ASSERT(f.pathSum(0, 9) == 55);
+  CPPUNIT_ASSERT(f.pathSum(3, 5) == 4 + 5 + 6);
+  CPPUNIT_ASSERT(f.pathMin(3, 5) == 4);
+  CPPUNIT_ASSERT(f.lca(2, 7) == 7);
+  CPPUNIT_ASSERT(f.findRoot(0) == 9);
+
+  CPPUNIT_ASSERT(! f.cut(2, 4));
+  CPPUNIT_ASSERT(f.cut(5, 4));
+  CPPUNIT_ASSERT(! f.connected(0, 9));
+  CPPUNIT_ASSERT(f.findRoot(0) == 4);
+  CPPUNIT_ASSERT(f.findRoot(5) == 9);
+  CPPUNIT_ASSERT(f.lca(0, 9) == -1);
+
+  // 0 - 1 - .. - 4 hangs under 9 by 0 now 
+  CPPUNIT_ASSERT(f.link(0, 9));
+  CPPUNIT_ASSERT(f.findRoot(4) == 9);
+  CPPUNIT_ASSERT(f.lca(4, 6) == 9);
+  CPPUNIT_ASSERT(f.pathSum(4, 6) == 5 + 4 + 3 + 2 + 1 + 10 + 9 + 8 + 7);
+  f.setValue(9, -3);
+  CPPUNIT_ASSERT(f.pathMin(4, 6) == -3);
+
+  f.reroot(2);
+  CPPUNIT_ASSERT(f.findRoot(9) == 2);
+  CPPUNIT_ASSERT(f.lca(4, 6) == 2);
+  CPPUNIT_ASSERT(f.addVertex(7) == 10 && f.getValue(10) == 7);
+  CPPUNIT_ASSERT(f.findRoot(10) == 10);
+}
+
+// parent pointers, with rerooting by 
+// reversing the path to the root 
+struct NaiveForest {
+  vector<int> parent;
+  vector<long long> value;
+
+  NaiveForest(int n) : parent(n, -1), value(n, 0) { }
+
+  int root(int v) {
+    while (parent[v] != -1) v = parent[v];
+    return v;
+  }
+
+  void reroot(int v) {
+    int prev = -1;
+    while (v != -1) {
+      int next = parent[v];
+      parent[v] = prev;
+      prev = v;
+      v = next;
+    }
+  }
+
+  vector<int> toRoot(int v) {
+    vector<int> path;
+    for (; v != -1; v = parent[v])
+      path.push_back(v);
+    return path;
+  }
+
+  int lca(int u, int v) {
+    if (root(u) != root(v)) return -1;
+    vector<int> a = toRoot(u);
+    vector<int> b = toRoot(v);
+    for (int x : a)
+      if (find(b.begin(), b.end(), x) != b.end())
+        return x;
+    return -1;
+  }
+
+  vector<int> path(int u, int v) {
+    int l = lca(u, v);
+    vector<int> p;
+    for (int x = u; x != l; x = parent[x])
+      p.push_back(x);
+    p.push_back(l);
+    for (int x = v; x != l; x = parent[x])
+      p.push_back(x);
+    return p;
+  }
+};
+
+// random links, cuts, reroots and value changes, 
+// with every query checked against NaiveForest 
+void LinkCutTest::testMatchesNaiveForest() {
+  const int n = 200;
+  LinkCutForest f(n);
+  NaiveForest g(n);
+  srand(47);
+
+  for (int i = 0; i < 20000; i++) {
+    int u = rand() % n, v = rand() % n;
+    int op = rand() % 8;
+    if (op < 3) {
+      bool linked = g.root(u) != g.root(v);
+      if (linked) {
+        g.reroot(u);
+        g.parent[u] = v;
+      }
+      CPPUNIT_ASSERT(f.link(u, v) == linked);
+    } else if (op == 3) {
+      // an edge when there is one, so 
+      // cuts keep up with links 
+      if (g.parent[u] != -1)
+        v = g.parent[u];
+      bool edge = g.parent[u] == v || g.parent[v] == u;
+      if (g.parent[u] == v)
+        g.parent[u] = -1;
+      else if (g.parent[v] == u)
+        g.parent[v] = -1;
+      CPPUNIT_ASSERT(f.cut(u, v) == edge);
+    } else if (op == 4) {
+      long long x = rand() % 1000 - 500;
+      g.value[u] = x;
+      f.setValue(u, x);
+    } else if (op == 5) {
+      g.reroot(u);
+      f.reroot(u);
+    } else {
+      CPPUNIT_ASSERT(f.findRoot(u) == g.root(u));
+      CPPUNIT_ASSERT(f.connected(u, v) == (g.root(u) == g.root(v)));
+      CPPUNIT_ASSERT(f.lca(u, v) == g.lca(u, v));
+      if (g.root(u) == g.root(v)) {
+        long long sum = 0, mn = LLONG_MAX;
+        for (int x : g.path(u, v)) {
+          sum += g.value[x];
+          mn = min(mn, g.value[x]);
+        }
+        CPPUNIT_ASSERT(f.pathSum(u, v) == sum);
+        CPPUNIT_ASSERT(f.pathMin(u, v) == mn);
+      }
+    }
+  }
+
+  for (int v = 0; v < n; v++) {
+    CPPUNIT_ASSERT(f.findRoot(v) == g.root(v));
+    CPPUNIT_ASSERT(f.getValue(v) == g.value[v]);
+  }
+}
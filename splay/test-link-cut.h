@@ -0,0 +1,19 @@
+#ifndef TEST_LINK_CUT_H
+#define TEST_LINK_CUT_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "link-cut.h"
+
+class LinkCutTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(LinkCutTest);
+  CPPUNIT_TEST(testPath);
+  CPPUNIT_TEST(testMatchesNaiveForest);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testPath();
+    void testMatchesNaiveForest();
+};
+
+#endif
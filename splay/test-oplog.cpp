@@ -0,0 +1,231 @@
+#include <cstdio>
+#include <sys/stat.h>
+#include <vector>
+
+#include "test-oplog.h"
+#include "test-utils.h"
+#include "oplog.h"
+#include "snapshot.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( OpLogTest );
+
+void OpLogTest::setUp() {
+  logPath = tempFile("splay-oplog");
+  snapshotPath = tempFile("splay-snapshot");
+  // no snapshot until the first checkpoint 
+  remove(snapshotPath.c_str());
+}
+
+void OpLogTest::tearDown() {
+  remove(logPath.c_str());
+  remove(snapshotPath.c_str());
+}
+
+static long fileSize(const string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+static string readFile(const string &path) {
+  string data;
+  FILE * f = fopen(path.c_str(), "rb");
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.append(buf, n);
+  fclose(f);
+  return data;
+}
+
+static void writeFile(const string &path, const string &data) {
+  FILE * f = fopen(path.c_str(), "wb");
+  fwrite(data.data(), 1, data.size(), f);
+  fclose(f);
+}
+
+// apply random mutations of every kind 
+static void randomOps(SplayTree &t, int numOps, int maxVal) {
+  for (int i = 0; i < numOps; i++) {
+    int k = rand() % maxVal;
+    switch (rand() % 8) {
+      case 0: 
+        t.remove(k);
+        break;
+      case 1: 
+        t.eraseRange(k, k + maxVal / 100);
+        break;
+      case 2: 
+        t.insertMulti(k);
+        break;
+      case 3: 
+        t.removeOne(k);
+        break;
+      case 4: 
+        t.rekey(k, rand() % maxVal);
+        break;
+      case 5: 
+        if (t.getSize() > 0)
+          t.popMin();
+        break;
+      default: 
+        if (t.find(k) == nullptr)
+          t.insert(k);
+    }
+  }
+}
+
+// the replayed tree has the same keys and counts 
+static bool sameTree(SplayTree &a, SplayTree &b) {
+  if (! (a == b) || a.getWeight() != b.getWeight()) 
+    return false;
+
+  vector<int> keys;
+  a.getInorder(keys);
+  for (int k : keys)
+    if (a.getCount(k) != b.getCount(k)) return false;
+  return true;
+}
+
+// log without and with checkpoints, then replay 
+void OpLogTest::testReplay() {
+  SplayTree t;
+  OpLog log;
+  CPPUNIT_ASSERT(log.open(logPath, 16));
+  t.addObserver(&log);
+
+  randomOps(t, 500, 1000);
+  CPPUNIT_ASSERT(log.commit());
+  {
+    SplayTree replayed;
+    CPPUNIT_ASSERT(replayLog(snapshotPath, logPath, replayed));
+    CPPUNIT_ASSERT(sameTree(t, replayed));
+  }
+
+  CPPUNIT_ASSERT(log.checkpoint(t, snapshotPath));
+  randomOps(t, 500, 1000);
+  CPPUNIT_ASSERT(log.commit());
+  {
+    SplayTree replayed;
+    CPPUNIT_ASSERT(replayLog(snapshotPath, logPath, replayed));
+    CPPUNIT_ASSERT(sameTree(t, replayed));
+  }
+
+  // group commit: far fewer fsyncs than records 
+  CPPUNIT_ASSERT(log.fsyncCount() < 200);
+  t.removeObserver(&log);
+}
+
+// after a checkpoint the log only holds newer records 
+void OpLogTest::testCheckpointTruncates() {
+  SplayTree t;
+  OpLog log;
+  CPPUNIT_ASSERT(log.open(logPath));
+  t.addObserver(&log);
+
+  for (int i = 0; i < 1000; i++)
+    t.insert(i);
+  CPPUNIT_ASSERT(log.commit());
+  long before = fileSize(logPath);
+
+  CPPUNIT_ASSERT(log.checkpoint(t, snapshotPath));
+  CPPUNIT_ASSERT(fileSize(logPath) < before / 100);
+  CPPUNIT_ASSERT(fileSize(logPath + ".tmp") < 0);
+
+  t.remove(5);
+  log.close();
+
+  // reopening keeps the records 
+  CPPUNIT_ASSERT(log.open(logPath));
+  t.remove(6);
+  CPPUNIT_ASSERT(log.commit());
+
+  SplayTree replayed;
+  CPPUNIT_ASSERT(replayLog(snapshotPath, logPath, replayed));
+  CPPUNIT_ASSERT(sameTree(t, replayed));
+
+  // a snapshot of a different tree doesn't match 
+  // any checkpoint hash in the log 
+  SplayTree other;
+  other.insert(-1);
+  CPPUNIT_ASSERT(writeSnapshot(other, snapshotPath));
+  SplayTree bad;
+  CPPUNIT_ASSERT(! replayLog(snapshotPath, logPath, bad));
+  t.removeObserver(&log);
+}
+
+// a partial record at the tail is ignored and 
+// cut off when the log is reopened 
+void OpLogTest::testTornTail() {
+  SplayTree t;
+  OpLog log;
+  CPPUNIT_ASSERT(log.open(logPath, 1));
+  t.addObserver(&log);
+  for (int i = 0; i < 100; i++)
+    t.insert(i);
+  t.removeObserver(&log);
+  log.close();
+
+  FILE * f = fopen(logPath.c_str(), "ab");
+  fwrite("torn", 1, 4, f);
+  fclose(f);
+
+  SplayTree replayed;
+  CPPUNIT_ASSERT(replayLog(snapshotPath, logPath, replayed));
+  CPPUNIT_ASSERT(sameTree(t, replayed));
+
+  CPPUNIT_ASSERT(log.open(logPath, 1));
+  t.addObserver(&log);
+  t.insert(1000);
+  t.removeObserver(&log);
+  log.close();
+
+  SplayTree replayed2;
+  CPPUNIT_ASSERT(replayLog(snapshotPath, logPath, replayed2));
+  CPPUNIT_ASSERT(sameTree(t, replayed2));
+}
+
+// moving a copy from one key to another keeps the 
+// root hash, size and weight, so only the snapshot 
+// checksum tells the two checkpoints apart. replay 
+// the states a crash in the middle of the second 
+// checkpoint can leave 
+void OpLogTest::testCountOnlyCheckpoint() {
+  SplayTree t;
+  OpLog log;
+  CPPUNIT_ASSERT(log.open(logPath, 1));
+  t.addObserver(&log);
+  for (int i = 0; i < 100; i++) {
+    t.insert(i);
+    t.insertMulti(i);
+  }
+  CPPUNIT_ASSERT(log.checkpoint(t, snapshotPath));
+  string oldSnapshot = readFile(snapshotPath);
+
+  ll hash = t.getHash();
+  t.insertMulti(3);
+  t.removeOne(7);
+  CPPUNIT_ASSERT(t.getHash() == hash);
+  string oldLog = readFile(logPath);
+
+  CPPUNIT_ASSERT(log.checkpoint(t, snapshotPath));
+  string newSnapshot = readFile(snapshotPath);
+  string newLog = readFile(logPath);
+  string cp = newLog.substr(newLog.size() - sizeof(LogRecord));
+  t.removeObserver(&log);
+  log.close();
+
+  // checkpoint record logged, snapshot not renamed 
+  writeFile(logPath, oldLog + cp);
+  writeFile(snapshotPath, oldSnapshot);
+  SplayTree replayed;
+  CPPUNIT_ASSERT(replayLog(snapshotPath, logPath, replayed));
+  CPPUNIT_ASSERT(sameTree(t, replayed));
+
+  // snapshot renamed, log not replaced yet 
+  writeFile(snapshotPath, newSnapshot);
+  SplayTree replayed2;
+  CPPUNIT_ASSERT(replayLog(snapshotPath, logPath, replayed2));
+  CPPUNIT_ASSERT(sameTree(t, replayed2));
+}
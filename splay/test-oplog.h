@@ -0,0 +1,30 @@
+#ifndef TEST_OPLOG_H
+#define TEST_OPLOG_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "oplog.h"
+
+class OpLogTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(OpLogTest);
+  CPPUNIT_TEST(testReplay);
+  CPPUNIT_TEST(testCheckpointTruncates);
+  CPPUNIT_TEST(testTornTail);
+  CPPUNIT_TEST(testCountOnlyCheckpoint);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+
+    void testReplay();
+    void testCheckpointTruncates();
+    void testTornTail();
+    void testCountOnlyCheckpoint();
+
+  private:
+    std::string logPath;
+    std::string snapshotPath;
+};
+
+#endif 
@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "test-parallel.h"
+#include "test-utils.h"
+#include "parallel.h"
+
+using namespace std;
+using vi = vector<int>;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( ParallelTest );
+
+// random, path-shaped and tiny trees, 
+// with more threads than cores 
+void ParallelTest::testInorderMatches() {
+  SplayTree random, path, one, empty;
+  for (int i : randomInts(20000, 41, 1000000))
+    random.insert(i);
+  for (int i = 0; i < 50000; i++)
+    path.insert(i);
+  one.insert(7);
+
+  for (SplayTree * t : {&random, &path, &one, &empty}) {
+    vi expected;
+    t->getInorder(expected);
+    CPPUNIT_ASSERT(expected.size() == t->getSize());
+    for (int threads : {1, 3, 8}) {
+      vi got(5, -1);
+      parallelInorder(*t, got, threads);
+      CPPUNIT_ASSERT(got == expected);
+    }
+  }
+  // nothing was splayed 
+  CPPUNIT_ASSERT(path.root->key == 49999);
+}
+
+// ranges inside, across and outside the tree, 
+// with multiset counts 
+void ParallelTest::testForEachReduce() {
+  SplayTree t;
+  vi ints = randomInts(30000, 42, 1000000);
+  for (int i : ints) {
+    t.insert(i);
+    if (i % 5 == 0) t.insertMulti(i);
+  }
+
+  for (auto range : {make_pair(INT_MIN, INT_MAX), make_pair(1000, 500000),
+                     make_pair(-100, 10), make_pair(2000000, 3000000),
+                     make_pair(5, 4)}) {
+    int lo = range.first, hi = range.second;
+    long long keys = 0, weight = 0, sum = 0;
+    int mx = INT_MIN;
+    for (int i : ints) {
+      if (i < lo || i > hi) continue;
+      int c = i % 5 == 0 ? 2 : 1;
+      keys++;
+      weight += c;
+      sum += (long long) i * c;
+      mx = max(mx, i);
+    }
+
+    for (int threads : {1, 4}) {
+      // a failed assert in a worker would end the 
+      // process, so count them for the main thread 
+      atomic<long long> seen(0), w(0), outside(0);
+      long long n = parallelForEach(t, lo, hi, [&](int key, int count) {
+        if (key < lo || key > hi) outside++;
+        seen++;
+        w += count;
+      }, threads);
+      CPPUNIT_ASSERT(outside == 0);
+      CPPUNIT_ASSERT(n == keys && seen == keys && w == weight);
+
+      long long s = parallelReduce(t, lo, hi, 0LL, 
+          [](int key, int count) { return (long long) key * count; },
+          [](long long a, long long b) { return a + b; }, threads);
+      CPPUNIT_ASSERT(s == sum);
+
+      int m = parallelReduce(t, lo, hi, INT_MIN, 
+          [](int key, int count) { return key; },
+          [](int a, int b) { return max(a, b); }, threads);
+      CPPUNIT_ASSERT(m == mx);
+    }
+  }
+}
+
+// sequential inserts leave a path. every worker 
+// still gets an equal share of the keys 
+void ParallelTest::testPathSplitsWork() {
+  SplayTree t;
+  const int n = 1000000;
+  for (int i = 0; i < n; i++)
+    t.insert(i);
+
+  const int threads = 8;
+  vector<atomic<long long>> perWorker(threads);
+  for (auto &c : perWorker) c = 0;
+  atomic<long long> badWorker(0);
+  long long visited = parallelForEachWorker(t, INT_MIN, INT_MAX, 
+      [&](int worker, int key, int count) {
+    if (worker < 0 || worker >= threads) 
+      badWorker++;
+    else
+      perWorker[worker]++;
+  }, threads);
+  CPPUNIT_ASSERT(badWorker == 0);
+  CPPUNIT_ASSERT(visited == n);
+  for (auto &c : perWorker)
+    CPPUNIT_ASSERT(c == n / threads);
+
+  // a range in the middle too 
+  for (auto &c : perWorker) c = 0;
+  visited = parallelForEachWorker(t, 1000, 1000 + 8000 - 1, 
+      [&](int worker, int key, int count) { perWorker[worker]++; }, threads);
+  CPPUNIT_ASSERT(visited == 8000);
+  for (auto &c : perWorker)
+    CPPUNIT_ASSERT(c == 1000);
+
+  vi got;
+  parallelInorder(t, got, threads);
+  CPPUNIT_ASSERT(got.size() == n);
+  for (int i = 0; i < n; i++)
+    CPPUNIT_ASSERT(got[i] == i);
+  CPPUNIT_ASSERT(t.root->key == n - 1);
+}
@@ -0,0 +1,21 @@
+#ifndef TEST_PARALLEL_H
+#define TEST_PARALLEL_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "parallel.h"
+
+class ParallelTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(ParallelTest);
+  CPPUNIT_TEST(testInorderMatches);
+  CPPUNIT_TEST(testForEachReduce);
+  CPPUNIT_TEST(testPathSplitsWork);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testInorderMatches();
+    void testForEachReduce();
+    void testPathSplitsWork();
+};
+
+#endif 
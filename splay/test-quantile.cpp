@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+#include "test-quantile.h"
+#include "quantile.h"
+
+using namespace std;
+using vi = vector<int>;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( QuantileWindowTest );
+
+// nearest-rank quantile by sorting the window 
+static int sortedQuantile(const deque<int> &window, double q) {
+  vi v(window.begin(), window.end());
+  sort(v.begin(), v.end());
+  int i = (int) ceil(q * v.size()) - 1;
+  i = max(0, min(i, (int) v.size() - 1));
+  return v[i];
+}
+
+// compare every step of a stream with a re-sorted window 
+void QuantileWindowTest::testMatchesSortedWindow() {
+  int w = 50;
+  QuantileWindow qw(w);
+  deque<int> window;
+
+  srand(12);
+  for (int i = 0; i < 2000; i++) {
+    // small range so the window has repeats 
+    int v = rand() % 40;
+    qw.push(v);
+    window.push_back(v);
+    if (window.size() > w)
+      window.pop_front();
+
+    CPPUNIT_ASSERT(qw.size() == window.size());
+    for (double q : {0.0, 0.25, 0.5, 0.9, 0.99, 1.0})
+      CPPUNIT_ASSERT(qw.quantile(q) == sortedQuantile(window, q));
+  }
+}
+
+// batched ingest leaves the same window as single pushes 
+void QuantileWindowTest::testBatch() {
+  int w = 64;
+  QuantileWindow batched(w), single(w);
+
+  srand(13);
+  for (int b = 0; b < 50; b++) {
+    // batches both smaller and larger than the window 
+    vi batch(rand() % (2*w));
+    for (int &v : batch)
+      v = rand() % 1000 - 500;
+
+    batched.pushBatch(batch);
+    for (int v : batch)
+      single.push(v);
+
+    CPPUNIT_ASSERT(batched.size() == single.size());
+    if (single.size() == 0) continue;
+    CPPUNIT_ASSERT(batched.median() == single.median());
+    CPPUNIT_ASSERT(batched.quantile(0.99) == single.quantile(0.99));
+    CPPUNIT_ASSERT(batched.quantile(0.0) == single.quantile(0.0));
+  }
+}
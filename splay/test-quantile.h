@@ -0,0 +1,19 @@
+#ifndef TEST_QUANTILE_H
+#define TEST_QUANTILE_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "quantile.h"
+
+class QuantileWindowTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(QuantileWindowTest);
+  CPPUNIT_TEST(testMatchesSortedWindow);
+  CPPUNIT_TEST(testBatch);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testMatchesSortedWindow();
+    void testBatch();
+};
+
+#endif 
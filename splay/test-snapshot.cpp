@@ -0,0 +1,148 @@
+#include <cstdio>
+#include <unistd.h>
+#include <vector>
+
+#include "test-snapshot.h"
+#include "test-utils.h"
+#include "snapshot.h"
+
+using namespace std;
+using vi = vector<int>;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SnapshotTest );
+
+void SnapshotTest::setUp() {
+  path = tempFile("splay-snapshot");
+}
+
+void SnapshotTest::tearDown() {
+  remove(path.c_str());
+}
+
+// write, map and rebuild a tree, with and without aug 
+void SnapshotTest::testRoundTrip() {
+  SplayTree t;
+  vi ints = randomInts(1000, 14);
+  for (int i : ints)
+    t.insert(i);
+
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  BSTPred bstPred;
+  ChildParentPred childParentPred;
+  for (bool withAug : {false, true}) {
+    CPPUNIT_ASSERT(writeSnapshot(t, path, withAug));
+
+    SnapshotView view;
+    CPPUNIT_ASSERT(view.open(path));
+    CPPUNIT_ASSERT(view.hasAug() == withAug);
+    CPPUNIT_ASSERT(view.size() == t.getSize());
+    CPPUNIT_ASSERT(view.getHash() == t.getHash());
+
+    vi keys;
+    t.getInorder(keys);
+    for (int i = 0; i < keys.size(); i++) {
+      CPPUNIT_ASSERT(view.keyAt(i) == keys[i]);
+      CPPUNIT_ASSERT(view.indexOf(keys[i]) == i);
+    }
+    CPPUNIT_ASSERT(! view.contains(-1));
+
+    SplayTree loaded;
+    view.toTree(loaded);
+    CPPUNIT_ASSERT(loaded == t);
+    CPPUNIT_ASSERT(loaded.getSize() == t.getSize());
+    CPPUNIT_ASSERT(loaded.peekMin()->key == keys.front());
+    CPPUNIT_ASSERT(loaded.peekMax()->key == keys.back());
+    CPPUNIT_ASSERT(bstPred.testTree(loaded));
+    CPPUNIT_ASSERT(childParentPred.testTree(loaded));
+    CPPUNIT_ASSERT(sspred.testTree(loaded));
+    CPPUNIT_ASSERT(shpred.testTree(loaded));
+
+    // loaded tree is an ordinary mutable tree 
+    loaded.remove(keys[0]);
+    loaded.insert(-1);
+    CPPUNIT_ASSERT(shpred.testTree(loaded));
+  }
+
+  // empty tree 
+  SplayTree empty, loaded;
+  CPPUNIT_ASSERT(writeSnapshot(empty, path, true));
+  CPPUNIT_ASSERT(loadSnapshot(path, loaded));
+  CPPUNIT_ASSERT(loaded.root == nullptr);
+}
+
+// counts and precomputed aug survive the round trip 
+void SnapshotTest::testMultisetWithAug() {
+  SplayTree t;
+  for (int i = 0; i < 2000; i++)
+    t.insertMulti(rand() % 500);
+
+  CPPUNIT_ASSERT(writeSnapshot(t, path, true));
+  SplayTree loaded;
+  CPPUNIT_ASSERT(loadSnapshot(path, loaded));
+
+  CPPUNIT_ASSERT(loaded.getWeight() == t.getWeight());
+  CPPUNIT_ASSERT(loaded.getHash() == t.getHash());
+  for (int k = 0; k < 500; k++)
+    CPPUNIT_ASSERT(loaded.getCount(k) == t.getCount(k));
+
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  CPPUNIT_ASSERT(sspred.testTree(loaded));
+  CPPUNIT_ASSERT(shpred.testTree(loaded));
+}
+
+// a flipped byte, a bad count or a truncated 
+// file is rejected 
+void SnapshotTest::testCorruption() {
+  SplayTree t;
+  for (int i : randomInts(100, 15))
+    t.insert(i);
+  CPPUNIT_ASSERT(writeSnapshot(t, path));
+
+  FILE * f = fopen(path.c_str(), "r+b");
+  fseek(f, sizeof(SnapshotHeader) + 10, SEEK_SET);
+  int c = fgetc(f);
+  fseek(f, sizeof(SnapshotHeader) + 10, SEEK_SET);
+  fputc(c ^ 0xff, f);
+  fclose(f);
+
+  SnapshotView view;
+  CPPUNIT_ASSERT(! view.open(path));
+  CPPUNIT_ASSERT(! view.isOpen());
+  CPPUNIT_ASSERT(view.open(path, false));
+
+  // a count whose size in bytes wraps around to 
+  // the real one 
+  CPPUNIT_ASSERT(writeSnapshot(t, path));
+  f = fopen(path.c_str(), "r+b");
+  SnapshotHeader h;
+  CPPUNIT_ASSERT(fread(&h, sizeof(h), 1, f) == 1);
+  h.count += 1ULL << 62;
+  fseek(f, 0, SEEK_SET);
+  CPPUNIT_ASSERT(fwrite(&h, sizeof(h), 1, f) == 1);
+  fclose(f);
+  CPPUNIT_ASSERT(! view.open(path, false));
+  CPPUNIT_ASSERT(view.size() == 0);
+
+  CPPUNIT_ASSERT(truncate(path.c_str(), sizeof(SnapshotHeader) + 4) == 0);
+  CPPUNIT_ASSERT(! view.open(path, false));
+  CPPUNIT_ASSERT(! view.open("/nonexistent/snapshot"));
+}
+
+// sequential inserts leave a path of 1M nodes, 
+// which the inorder pass must not recurse down 
+void SnapshotTest::testPathShaped() {
+  const int n = 1000000;
+  SplayTree t;
+  for (int i = 0; i < n; i++)
+    t.insert(i);
+  CPPUNIT_ASSERT(writeSnapshot(t, path));
+
+  SplayTree loaded;
+  CPPUNIT_ASSERT(loadSnapshot(path, loaded));
+  CPPUNIT_ASSERT(loaded.getSize() == n);
+  CPPUNIT_ASSERT(loaded.getHash() == t.getHash());
+  CPPUNIT_ASSERT(loaded.peekMin()->key == 0);
+  CPPUNIT_ASSERT(loaded.peekMax()->key == n - 1);
+}
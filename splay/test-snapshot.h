@@ -0,0 +1,29 @@
+#ifndef TEST_SNAPSHOT_H
+#define TEST_SNAPSHOT_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "snapshot.h"
+
+class SnapshotTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(SnapshotTest);
+  CPPUNIT_TEST(testRoundTrip);
+  CPPUNIT_TEST(testMultisetWithAug);
+  CPPUNIT_TEST(testCorruption);
+  CPPUNIT_TEST(testPathShaped);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+
+    void testRoundTrip();
+    void testMultisetWithAug();
+    void testCorruption();
+    void testPathShaped();
+
+  private:
+    std::string path;
+};
+
+#endif 
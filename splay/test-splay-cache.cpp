@@ -0,0 +1,144 @@
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "test-splay-cache.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SplayCacheTest );
+
+// with no capacity it's an ordered map 
+void SplayCacheTest::testGetPutScan() {
+  SplayCache<int, string> c(0);
+  map<int, string> m;
+  srand(49);
+  for (int i = 0; i < 5000; i++) {
+    int k = rand() % 1000;
+    if (rand() % 3 == 0) {
+      CPPUNIT_ASSERT(c.erase(k) == (m.erase(k) > 0));
+    } else {
+      string v = to_string(rand());
+      c.put(k, v);
+      m[k] = v;
+    }
+    int q = rand() % 1000;
+    string * got = c.get(q);
+    CPPUNIT_ASSERT((got != nullptr) == (m.count(q) > 0));
+    if (got != nullptr)
+      CPPUNIT_ASSERT(*got == m[q]);
+  }
+  CPPUNIT_ASSERT(c.getSize() == m.size());
+  CPPUNIT_ASSERT(c.getBytes() == m.size() * c.nodeBytes());
+
+  using Entries = vector<pair<int, string>>;
+  Entries all, range, expected;
+  c.forEach([&](int k, const string &v) { all.push_back({k, v}); });
+  CPPUNIT_ASSERT(all == Entries(m.begin(), m.end()));
+
+  c.scan(250, 500, [&](int k, const string &v) { range.push_back({k, v}); });
+  for (auto it = m.lower_bound(250); it != m.end() && it->first <= 500; ++it)
+    expected.push_back(*it);
+  CPPUNIT_ASSERT(range == expected);
+
+  SplayCacheStats s = c.getStats();
+  CPPUNIT_ASSERT(s.hits + s.misses == 5000);
+  CPPUNIT_ASSERT(s.evictions == 0 && s.batches == 0);
+  c.clear();
+  CPPUNIT_ASSERT(c.getSize() == 0 && c.get(1) == nullptr);
+}
+
+// every get, put and erase against a map and an 
+// LRU list that evict the same batches 
+void SplayCacheTest::testMatchesLru() {
+  // a small batch unlinks the victims, a 
+  // large one rebuilds the tree 
+  for (double fraction : {1.0 / 16, 0.5}) {
+    const size_t cap = 200;
+    SplayCache<int, int> c(cap, 0, fraction);
+    list<int> lru;
+    map<int, pair<int, list<int>::iterator>> m;
+    long long evicted = 0;
+    srand(49);
+
+    for (int i = 0; i < 20000; i++) {
+      int k = rand() % 600;
+      int op = rand() % 4;
+      auto it = m.find(k);
+      if (op == 0) {
+        CPPUNIT_ASSERT(c.erase(k) == (it != m.end()));
+        if (it != m.end()) {
+          lru.erase(it->second.second);
+          m.erase(it);
+        }
+      } else if (op == 1) {
+        int * v = c.get(k);
+        CPPUNIT_ASSERT((v != nullptr) == (it != m.end()));
+        if (v != nullptr) {
+          CPPUNIT_ASSERT(*v == it->second.first);
+          lru.splice(lru.begin(), lru, it->second.second);
+        }
+      } else {
+        c.put(k, i);
+        if (it != m.end()) {
+          it->second.first = i;
+          lru.splice(lru.begin(), lru, it->second.second);
+        } else {
+          lru.push_front(k);
+          m[k] = {i, lru.begin()};
+        }
+        if (m.size() > cap) {
+          size_t keep = cap - (size_t) (cap * fraction);
+          while (m.size() > keep) {
+            m.erase(lru.back());
+            lru.pop_back();
+            evicted++;
+          }
+        }
+      }
+      CPPUNIT_ASSERT(c.getSize() == m.size());
+    }
+
+    vector<int> recency;
+    c.getRecency(recency);
+    CPPUNIT_ASSERT(recency == vector<int>(lru.begin(), lru.end()));
+    vector<int> keys;
+    c.forEach([&](int k, int v) {
+      keys.push_back(k);
+      CPPUNIT_ASSERT(m[k].first == v);
+    });
+    CPPUNIT_ASSERT(keys.size() == m.size());
+
+    SplayCacheStats s = c.getStats();
+    CPPUNIT_ASSERT(s.evictions == evicted && s.batches > 0);
+    CPPUNIT_ASSERT(fraction < 0.25 ? s.rebuilds == 0 : s.rebuilds == s.batches);
+  }
+}
+
+// entries are charged their node plus the 
+// extra bytes, and a big put evicts several 
+void SplayCacheTest::testByteCapacity() {
+  size_t node = SplayCache<int, int>::nodeBytes();
+  SplayCache<int, int> c(0, 10 * (node + 100), 0);
+  for (int i = 0; i < 10; i++)
+    c.put(i, i, 100);
+  CPPUNIT_ASSERT(c.getSize() == 10 && c.getBytes() == 10 * (node + 100));
+  c.get(0);
+
+  // needs room for two more entries: 1 and 2 
+  // are the least recent 
+  c.put(10, 10, 200);
+  CPPUNIT_ASSERT(c.getSize() == 9);
+  CPPUNIT_ASSERT(c.get(1) == nullptr && c.get(2) == nullptr);
+  CPPUNIT_ASSERT(c.get(0) != nullptr && c.get(3) != nullptr);
+  CPPUNIT_ASSERT(c.getBytes() <= 10 * (node + 100));
+
+  // an entry bigger than the capacity 
+  // still stays, by itself 
+  c.put(11, 11, 100 * node);
+  CPPUNIT_ASSERT(c.getSize() == 1 && *c.get(11) == 11);
+  CPPUNIT_ASSERT(c.getStats().evictions == 2 + 9);
+}
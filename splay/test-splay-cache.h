@@ -0,0 +1,21 @@
+#ifndef TEST_SPLAY_CACHE_H
+#define TEST_SPLAY_CACHE_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "splay-cache.h"
+
+class SplayCacheTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(SplayCacheTest);
+  CPPUNIT_TEST(testGetPutScan);
+  CPPUNIT_TEST(testMatchesLru);
+  CPPUNIT_TEST(testByteCapacity);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testGetPutScan();
+    void testMatchesLru();
+    void testByteCapacity();
+};
+
+#endif
@@ -2,6 +2,9 @@
 #include <cppunit/ui/text/TestRunner.h>
 #include <iostream>
 #include <vector>
+#include <set>
+#include <map>
+#include <algorithm>
 
 #include "test-utils.h"
 #include "test-splay.h"
@@ -180,6 +183,681 @@ void SplayTreeTest::testRemoveAllHelper(int seed) {
   std::cout << "removed all " << numNodes << " nodes successfully." << std::endl;
 }
 
+// insert and find keys through a finger 
+void SplayTreeTest::testFingerInsertFind() {
+  int numNodes = 500;
+  vi ints = randomInts(numNodes, 3);
+
+  Finger f;
+  for (int i : ints) {
+    tree->insert(i, f);
+    CPPUNIT_ASSERT(f.node != nullptr && f.node->key == i);
+    CPPUNIT_ASSERT(tree->root == f.node);
+  }
+
+  BSTPred bstPred;
+  ChildParentPred childParentPred;
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  CPPUNIT_ASSERT(bstPred.testTree(*tree));
+  CPPUNIT_ASSERT(childParentPred.testTree(*tree));
+  CPPUNIT_ASSERT(sspred.testTree(*tree));
+  CPPUNIT_ASSERT(shpred.testTree(*tree));
+  CPPUNIT_ASSERT(tree->getSize() == numNodes);
+
+  // find every key from the previous finger 
+  for (int i : ints) {
+    STNode * n = tree->find(i, f);
+    CPPUNIT_ASSERT(n != nullptr && n->key == i);
+    CPPUNIT_ASSERT(f.node == n);
+  }
+
+  // misses leave the finger alone 
+  STNode * before = f.node;
+  CPPUNIT_ASSERT(tree->find(-1, f) == nullptr);
+  CPPUNIT_ASSERT(f.node == before);
+
+  // so do duplicate inserts, which observers 
+  // don't hear about 
+  struct InsertCounter : TreeObserver {
+    int inserts = 0;
+    void onInsert(int key, int count) { inserts++; }
+  } counter;
+  tree->addObserver(&counter);
+  CPPUNIT_ASSERT(! tree->insert(ints[0], f));
+  CPPUNIT_ASSERT(f.node == before);
+  CPPUNIT_ASSERT(tree->getSize() == numNodes);
+  CPPUNIT_ASSERT(tree->insert(-1, f));
+  CPPUNIT_ASSERT(f.node->key == -1);
+  CPPUNIT_ASSERT(counter.inserts == 1);
+  tree->removeObserver(&counter);
+}
+
+// walk the whole tree with next() and prev() 
+void SplayTreeTest::testFingerNextPrev() {
+  int numNodes = 300;
+  vi ints = randomInts(numNodes, 4);
+  for (int i : ints)
+    tree->insert(i);
+
+  vi sorted;
+  tree->getInorder(sorted);
+
+  Finger f;
+  CPPUNIT_ASSERT(tree->find(sorted[0], f) != nullptr);
+  for (int i = 1; i < sorted.size(); i++) {
+    STNode * n = tree->next(f);
+    CPPUNIT_ASSERT(n != nullptr && n->key == sorted[i]);
+  }
+  CPPUNIT_ASSERT(tree->next(f) == nullptr);
+  CPPUNIT_ASSERT(f.node->key == sorted.back());
+
+  for (int i = sorted.size() - 2; i >= 0; i--) {
+    STNode * n = tree->prev(f);
+    CPPUNIT_ASSERT(n != nullptr && n->key == sorted[i]);
+  }
+  CPPUNIT_ASSERT(tree->prev(f) == nullptr);
+
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  CPPUNIT_ASSERT(sspred.testTree(*tree));
+  CPPUNIT_ASSERT(shpred.testTree(*tree));
+}
+
+// move keys to another tree through node handles 
+void SplayTreeTest::testExtractInsert() {
+  int numNodes = 200;
+  vi ints = randomInts(numNodes, 6);
+  for (int i : ints)
+    tree->insert(i);
+
+  SplayTree other;
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  for (int i = 0; i < numNodes / 2; i++) {
+    NodeHandle nh = tree->extract(ints[i]);
+    CPPUNIT_ASSERT(! nh.empty());
+    CPPUNIT_ASSERT(nh.key() == ints[i]);
+    CPPUNIT_ASSERT(tree->find(ints[i]) == nullptr);
+
+    CPPUNIT_ASSERT(other.insert(std::move(nh)));
+    CPPUNIT_ASSERT(nh.empty());
+    CPPUNIT_ASSERT(other.root->key == ints[i]);
+  }
+  CPPUNIT_ASSERT(tree->getSize() == numNodes - numNodes / 2);
+  CPPUNIT_ASSERT(other.getSize() == numNodes / 2);
+  CPPUNIT_ASSERT(sspred.testTree(*tree) && shpred.testTree(*tree));
+  CPPUNIT_ASSERT(sspred.testTree(other) && shpred.testTree(other));
+
+  // absent key gives an empty handle 
+  CPPUNIT_ASSERT(tree->extract(ints[0]).empty());
+
+  // node is reused, not reallocated 
+  STNode * n = other.find(ints[0]);
+  NodeHandle nh = other.extract(ints[0]);
+  nh.key() = ints[0];
+  CPPUNIT_ASSERT(tree->insert(std::move(nh)));
+  CPPUNIT_ASSERT(tree->find(ints[0]) == n);
+
+  // duplicate key: handle keeps its node 
+  NodeHandle dup = other.extract(ints[1]);
+  dup.key() = ints[0];
+  CPPUNIT_ASSERT(! tree->insert(std::move(dup)));
+  CPPUNIT_ASSERT(! dup.empty());
+}
+
+// change keys in place and by relinking 
+void SplayTreeTest::testRekey() {
+  int numNodes = 300;
+  vi ints = randomInts(numNodes, 7, 10*numNodes);
+  for (int i : ints)
+    tree->insert(i);
+
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  BSTPred bstPred;
+  ChildParentPred childParentPred;
+  for (int i = 0; i < numNodes; i++) {
+    int newKey = ints[i] + (i % 2 == 0 ? 1 : 10*numNodes);
+    if (tree->find(newKey) != nullptr) continue;
+
+    STNode * n = tree->find(ints[i]);
+    CPPUNIT_ASSERT(tree->rekey(ints[i], newKey));
+    CPPUNIT_ASSERT(tree->find(ints[i]) == nullptr);
+    CPPUNIT_ASSERT(tree->find(newKey) == n);
+    CPPUNIT_ASSERT(bstPred.testTree(*tree));
+    CPPUNIT_ASSERT(childParentPred.testTree(*tree));
+    CPPUNIT_ASSERT(sspred.testTree(*tree));
+    CPPUNIT_ASSERT(shpred.testTree(*tree));
+  }
+  CPPUNIT_ASSERT(tree->getSize() == numNodes);
+
+  // absent old key, present new key 
+  CPPUNIT_ASSERT(! tree->rekey(-5, 1));
+  tree->insert(-5);
+  tree->insert(-6);
+  CPPUNIT_ASSERT(! tree->rekey(-5, -6));
+}
+
+// remove random ranges and compare with std::set 
+void SplayTreeTest::testEraseRange() {
+  int numNodes = 1000;
+  int maxVal = 5*numNodes;
+  vi ints = randomInts(numNodes, 8, maxVal);
+  std::set<int> expected(ints.begin(), ints.end());
+  for (int i : ints)
+    tree->insert(i);
+
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  BSTPred bstPred;
+  ChildParentPred childParentPred;
+  for (int r = 0; r < 20; r++) {
+    int lo = rand() % maxVal;
+    int hi = lo + rand() % (maxVal / 20);
+
+    int count = 0;
+    auto it = expected.lower_bound(lo);
+    while (it != expected.end() && *it <= hi) {
+      it = expected.erase(it);
+      count++;
+    }
+
+    CPPUNIT_ASSERT(tree->eraseRange(lo, hi) == count);
+    CPPUNIT_ASSERT(tree->getSize() == expected.size());
+    CPPUNIT_ASSERT(bstPred.testTree(*tree));
+    CPPUNIT_ASSERT(childParentPred.testTree(*tree));
+    CPPUNIT_ASSERT(sspred.testTree(*tree));
+    CPPUNIT_ASSERT(shpred.testTree(*tree));
+  }
+
+  vi keys;
+  tree->getInorder(keys);
+  CPPUNIT_ASSERT(keys == vi(expected.begin(), expected.end()));
+
+  // everything 
+  CPPUNIT_ASSERT(tree->eraseRange(-1, maxVal) == expected.size());
+  CPPUNIT_ASSERT(tree->root == nullptr);
+  CPPUNIT_ASSERT(tree->eraseRange(0, 10) == 0);
+}
+
+// remove keys matching a predicate 
+void SplayTreeTest::testEraseIf() {
+  int numNodes = 1000;
+  vi ints = randomInts(numNodes, 9);
+  for (int i : ints)
+    tree->insert(i);
+
+  int odd = 0;
+  for (int i : ints)
+    odd += i % 2;
+
+  CPPUNIT_ASSERT(tree->eraseIf([](int k) { return k % 2 == 1; }) == odd);
+  CPPUNIT_ASSERT(tree->getSize() == numNodes - odd);
+
+  BSTPred bstPred;
+  ChildParentPred childParentPred;
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  CPPUNIT_ASSERT(bstPred.testTree(*tree));
+  CPPUNIT_ASSERT(childParentPred.testTree(*tree));
+  CPPUNIT_ASSERT(sspred.testTree(*tree));
+  CPPUNIT_ASSERT(shpred.testTree(*tree));
+
+  for (int i : ints)
+    CPPUNIT_ASSERT((tree->find(i) != nullptr) == (i % 2 == 0));
+
+  CPPUNIT_ASSERT(tree->eraseIf([](int k) { return true; }) == numNodes - odd);
+  CPPUNIT_ASSERT(tree->root == nullptr);
+
+  // sequential inserts leave a path, which 
+  // must not be collected recursively 
+  int n = 1000000;
+  for (int i = 0; i < n; i++)
+    tree->insert(i);
+  CPPUNIT_ASSERT(tree->eraseIf([](int k) { return k % 3 != 0; }) == n - n / 3 - 1);
+  CPPUNIT_ASSERT(tree->getSize() == n / 3 + 1);
+  CPPUNIT_ASSERT(sspred.testTree(*tree));
+}
+
+// cached min/max through mixed updates 
+void SplayTreeTest::testMinMax() {
+  int numNodes = 1000;
+  int maxVal = 4*numNodes;
+  vi ints = randomInts(numNodes, 10, maxVal);
+  std::set<int> expected;
+
+  CPPUNIT_ASSERT(tree->peekMin() == nullptr);
+  CPPUNIT_ASSERT(tree->peekMax() == nullptr);
+
+  for (int i = 0; i < numNodes; i++) {
+    int k = ints[i];
+    switch (rand() % 6) {
+      case 0: 
+        tree->remove(k);
+        expected.erase(k);
+        break;
+      case 1: 
+        // move the min node to key k 
+        if (! expected.empty()) {
+          NodeHandle nh = tree->extract(*expected.begin());
+          expected.erase(expected.begin());
+          nh.key() = k;
+          CPPUNIT_ASSERT(tree->insert(std::move(nh)));
+          expected.insert(k);
+        }
+        break;
+      case 2: {
+        int lo = rand() % maxVal;
+        tree->eraseRange(lo, lo + maxVal / 50);
+        expected.erase(expected.lower_bound(lo), 
+                       expected.upper_bound(lo + maxVal / 50));
+        break;
+      }
+      default: 
+        tree->insert(k);
+        expected.insert(k);
+    }
+
+    if (expected.empty()) {
+      CPPUNIT_ASSERT(tree->peekMin() == nullptr);
+      CPPUNIT_ASSERT(tree->peekMax() == nullptr);
+      continue;
+    }
+    CPPUNIT_ASSERT(tree->peekMin()->key == *expected.begin());
+    CPPUNIT_ASSERT(tree->peekMax()->key == *expected.rbegin());
+  }
+
+  tree->eraseIf([](int k) { return k % 3 == 0; });
+  for (auto it = expected.begin(); it != expected.end(); )
+    it = (*it % 3 == 0) ? expected.erase(it) : ++it;
+  CPPUNIT_ASSERT(tree->peekMin()->key == *expected.begin());
+  CPPUNIT_ASSERT(tree->peekMax()->key == *expected.rbegin());
+}
+
+// drain tree from both ends 
+void SplayTreeTest::testPopMinMax() {
+  int numNodes = 500;
+  vi ints = randomInts(numNodes, 11);
+  for (int i : ints)
+    tree->insert(i);
+
+  vi sorted;
+  tree->getInorder(sorted);
+
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  ChildParentPred childParentPred;
+  int lo = 0, hi = numNodes - 1;
+  while (lo <= hi) {
+    if (rand() % 2 == 0)
+      CPPUNIT_ASSERT(tree->popMin() == sorted[lo++]);
+    else 
+      CPPUNIT_ASSERT(tree->popMax() == sorted[hi--]);
+
+    CPPUNIT_ASSERT(tree->getSize() == hi - lo + 1);
+    if (lo <= hi) {
+      CPPUNIT_ASSERT(tree->peekMin()->key == sorted[lo]);
+      CPPUNIT_ASSERT(tree->peekMax()->key == sorted[hi]);
+    }
+    if (lo % 50 == 0) {
+      CPPUNIT_ASSERT(childParentPred.testTree(*tree));
+      CPPUNIT_ASSERT(sspred.testTree(*tree));
+      CPPUNIT_ASSERT(shpred.testTree(*tree));
+    }
+  }
+  CPPUNIT_ASSERT(tree->root == nullptr);
+  CPPUNIT_ASSERT(tree->peekMin() == nullptr);
+  CPPUNIT_ASSERT(tree->peekMax() == nullptr);
+}
+
+// pops take one copy at a time 
+void SplayTreeTest::testPopMultiset() {
+  multiset<int> ref;
+  for (int i = 0; i < 2000; i++) {
+    int k = rand() % 100;
+    tree->insertMulti(k);
+    ref.insert(k);
+  }
+
+  SubtreeSizePred sspred;
+  ChildParentPred childParentPred;
+  while (! ref.empty()) {
+    if (rand() % 2 == 0) {
+      CPPUNIT_ASSERT(tree->popMin() == *ref.begin());
+      ref.erase(ref.begin());
+    } else {
+      CPPUNIT_ASSERT(tree->popMax() == *ref.rbegin());
+      ref.erase(prev(ref.end()));
+    }
+    CPPUNIT_ASSERT(tree->getWeight() == (int) ref.size());
+    if (ref.size() % 100 == 0) {
+      CPPUNIT_ASSERT(childParentPred.testTree(*tree));
+      CPPUNIT_ASSERT(sspred.testTree(*tree));
+    }
+  }
+  CPPUNIT_ASSERT(tree->root == nullptr);
+}
+
+// counts and weights with repeated keys 
+void SplayTreeTest::testMultiset() {
+  int numOps = 2000;
+  std::map<int, int> expected;
+  int total = 0;
+
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  for (int i = 0; i < numOps; i++) {
+    int k = rand() % 100;
+    if (rand() % 3 == 0) {
+      bool present = expected.count(k) > 0;
+      CPPUNIT_ASSERT(tree->removeOne(k) == present);
+      if (present) {
+        total--;
+        if (--expected[k] == 0)
+          expected.erase(k);
+      }
+    }
+    else {
+      tree->insertMulti(k);
+      expected[k]++;
+      total++;
+    }
+
+    CPPUNIT_ASSERT(tree->getWeight() == total);
+    CPPUNIT_ASSERT(tree->getSize() == expected.size());
+    CPPUNIT_ASSERT(tree->getCount(k) == (expected.count(k) ? expected[k] : 0));
+  }
+  CPPUNIT_ASSERT(sspred.testTree(*tree));
+  CPPUNIT_ASSERT(shpred.testTree(*tree));
+
+  // remove() drops every copy 
+  int k = expected.begin()->first;
+  total -= expected.begin()->second;
+  tree->remove(k);
+  CPPUNIT_ASSERT(tree->getCount(k) == 0);
+  CPPUNIT_ASSERT(tree->getWeight() == total);
+
+  // a count query isn't a find: no event for 
+  // observers, no access recorded, no splay 
+  struct FindCounter : TreeObserver {
+    int finds = 0;
+    void onFind(int key) { finds++; }
+  } counter;
+  expected.erase(k);
+  k = expected.begin()->first;
+  tree->addObserver(&counter);
+  unsigned accesses = tree->find(k)->accesses;
+  int other = expected.rbegin()->first;
+  CPPUNIT_ASSERT(tree->getCount(other) == expected[other]);
+  CPPUNIT_ASSERT(counter.finds == 1);
+  CPPUNIT_ASSERT(tree->root->key == k && tree->root->accesses == accesses);
+  tree->removeObserver(&counter);
+}
+
+// select and rank against a sorted multiset 
+void SplayTreeTest::testSelectRank() {
+  vi all;
+  for (int i = 0; i < 1000; i++) {
+    int k = rand() % 300;
+    tree->insertMulti(k);
+    all.push_back(k);
+  }
+  std::sort(all.begin(), all.end());
+
+  for (int i = 0; i < all.size(); i += 7) {
+    STNode * n = tree->select(i);
+    CPPUNIT_ASSERT(n != nullptr && n->key == all[i]);
+    CPPUNIT_ASSERT(tree->root == n);
+  }
+  CPPUNIT_ASSERT(tree->select(-1) == nullptr);
+  CPPUNIT_ASSERT(tree->select(all.size()) == nullptr);
+
+  for (int k = -1; k <= 301; k++) {
+    int expectedRank = std::lower_bound(all.begin(), all.end(), k) - all.begin();
+    CPPUNIT_ASSERT(tree->rank(k) == expectedRank);
+  }
+
+  SubtreeSizePred sspred;
+  CPPUNIT_ASSERT(sspred.testTree(*tree));
+}
+
+// diff ranges cover exactly the differing keys 
+void SplayTreeTest::testDiff() {
+  int numNodes = 5000;
+  int maxVal = 100000;
+  vi ints = randomInts(numNodes, 17, maxVal);
+
+  SplayTree other;
+  for (int i : ints) {
+    tree->insert(i);
+    other.insert(i);
+  }
+  CPPUNIT_ASSERT(diff(*tree, other).empty());
+
+  // a few scattered changes, one removed range 
+  // and one count change 
+  std::set<int> changed;
+  for (int j = 0; j < 20; j++) {
+    int k = rand() % maxVal;
+    if (other.find(k) != nullptr) 
+      other.remove(k);
+    else 
+      other.insert(k);
+    changed.insert(k);
+  }
+  for (int k : ints)
+    if (k >= 50000 && k <= 50500) changed.insert(k);
+  other.eraseRange(50000, 50500);
+  int k = ints[0];
+  if (other.find(k) != nullptr) {
+    other.insertMulti(k);
+    changed.insert(k);
+  }
+
+  auto ranges = diff(*tree, other);
+  CPPUNIT_ASSERT(! ranges.empty());
+  CPPUNIT_ASSERT(ranges.size() <= changed.size());
+
+  // every key of either tree inside a range 
+  // has changed, and every changed key is covered 
+  vi keys;
+  tree->getInorder(keys);
+  other.getInorder(keys);
+  for (int key : keys) {
+    bool covered = false;
+    for (auto &r : ranges)
+      covered |= r.first <= key && key <= r.second;
+    CPPUNIT_ASSERT(covered == (changed.count(key) > 0));
+  }
+  for (int i = 1; i < ranges.size(); i++)
+    CPPUNIT_ASSERT(ranges[i - 1].second < ranges[i].first);
+
+  // both trees are still valid after splaying 
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  CPPUNIT_ASSERT(sspred.testTree(*tree) && shpred.testTree(*tree));
+  CPPUNIT_ASSERT(sspred.testTree(other) && shpred.testTree(other));
+}
+
+// equality ignores shape but not keys or counts 
+void SplayTreeTest::testEquality() {
+  int numNodes = 2000;
+  vi ints = randomInts(numNodes, 23, 100000);
+
+  // same keys, different insertion order -> different shape 
+  SplayTree other;
+  for (int i : ints) tree->insert(i);
+  for (int i = ints.size() - 1; i >= 0; i--) other.insert(ints[i]);
+  other.find(ints[numNodes / 2]);
+  CPPUNIT_ASSERT(*tree == other);
+  CPPUNIT_ASSERT(*tree == *tree);
+
+  // a count difference is a difference 
+  other.insertMulti(ints[0]);
+  CPPUNIT_ASSERT(! (*tree == other));
+  other.removeOne(ints[0]);
+  CPPUNIT_ASSERT(*tree == other);
+
+  // so is a single changed key 
+  other.rekey(ints[1], -1);
+  CPPUNIT_ASSERT(! (*tree == other));
+
+  SplayTree empty1, empty2;
+  CPPUNIT_ASSERT(empty1 == empty2);
+  CPPUNIT_ASSERT(! (empty1 == *tree));
+}
+
+// the linear validator agrees with the predicates, 
+// scales to big and path-shaped trees, and catches 
+// each kind of corruption 
+void SplayTreeTest::testValidator() {
+  vi ints = randomInts(2000, 40, 100000);
+  for (int i : ints) {
+    tree->insert(i);
+    if (i % 3 == 0) tree->insertMulti(i);
+  }
+  BSTPred bpred;
+  ChildParentPred cppred;
+  SubtreeSizePred sspred;
+  SubtreeHashPred shpred;
+  CPPUNIT_ASSERT(bpred.testTree(*tree) && cppred.testTree(*tree));
+  CPPUNIT_ASSERT(sspred.testTree(*tree) && shpred.testTree(*tree));
+  CPPUNIT_ASSERT(validateTree(*tree));
+  CPPUNIT_ASSERT(validateTree(*tree, 4));
+
+  // break one thing at a time, deep in the tree 
+  string why;
+  STNode * n = tree->select(1000);
+  tree->find(ints[0]);
+  int oldSize = n->size;
+  n->size++;
+  CPPUNIT_ASSERT(! validateTree(*tree, 1, &why) && why.find("size") != string::npos);
+  CPPUNIT_ASSERT(! validateTree(*tree, 4, &why) && why.find("size") != string::npos);
+  n->size = oldSize;
+
+  n->hash ^= 1;
+  CPPUNIT_ASSERT(! validateTree(*tree, 1, &why) && why.find("hash") != string::npos);
+  n->hash ^= 1;
+
+  n->count++;
+  CPPUNIT_ASSERT(! validateTree(*tree, 1, &why) && why.find("weight") != string::npos);
+  n->count--;
+
+  STNode * succ = n->successor();
+  // out of order, but with matching hashes 
+  swap(n->key, succ->key);
+  n->updateAugToRoot();
+  succ->updateAugToRoot();
+  CPPUNIT_ASSERT(! validateTree(*tree, 4, &why) && why.find("BST") != string::npos);
+  swap(n->key, succ->key);
+  n->updateAugToRoot();
+  succ->updateAugToRoot();
+
+  STNode * p = n->parent;
+  n->parent = n;
+  CPPUNIT_ASSERT(! validateTree(*tree, 1, &why) && why.find("parent") != string::npos);
+  CPPUNIT_ASSERT(! validateTree(*tree, 4, &why) && why.find("parent") != string::npos);
+  n->parent = p;
+  CPPUNIT_ASSERT(validateTree(*tree, 4, &why) && why.empty());
+
+  // a path of 10^5 nodes would overflow a recursive walk 
+  SplayTree path;
+  for (int i = 0; i < 100000; i++)
+    path.insert(i);
+  CPPUNIT_ASSERT(validateTree(path));
+  CPPUNIT_ASSERT(validateTree(path, 4));
+  path.popMin();
+  CPPUNIT_ASSERT(validateTree(path, 2));
+
+  // a million keys, built directly 
+  SplayTree big;
+  vector<STNode *> nodes;
+  for (int i = 0; i < 1000000; i++)
+    nodes.push_back(new STNode(2 * i));
+  big.buildFromSorted(nodes);
+  CPPUNIT_ASSERT(validateTree(big, 8));
+  CPPUNIT_ASSERT(validateTree(SplayTree()));
+}
+
+// depth of a node (root = 0) 
+static int depthOf(STNode * n) {
+  int d = 0;
+  for (; n->parent != nullptr; n = n->parent)
+    d++;
+  return d;
+}
+
+// a rebuilt tree puts heavy keys near the root, 
+// beats a balanced tree on a skewed workload, and 
+// keeps its keys and hash. frozen trees don't 
+// splay on reads 
+void SplayTreeTest::testRebuildOptimal() {
+  SplayTree t;
+  vi keys = randomInts(1000, 47, 100000);
+  for (int i : keys)
+    t.insert(i);
+  ll hash = t.getHash();
+
+  // key j is found about 1000 / (j + 1) times 
+  vi sorted;
+  t.getInorder(sorted);
+  vi accesses;
+  for (int j = 0; j < 200; j++)
+    for (int c = 0; c < 1000 / (j + 1); c++)
+      accesses.push_back(keys[j]);
+
+  t.setFrozen(true);
+  int root = t.root->key;
+  for (int k : accesses)
+    CPPUNIT_ASSERT(t.find(k)->key == k);
+  t.rank(keys[5]);
+  t.select(5);
+  Finger f;
+  t.find(sorted[10], f);
+  CPPUNIT_ASSERT(t.next(f)->key == sorted[11]);
+  CPPUNIT_ASSERT(t.prev(f)->key == sorted[10]);
+  CPPUNIT_ASSERT(t.prev(f)->key == sorted[9]);
+  CPPUNIT_ASSERT(t.root->key == root);
+  CPPUNIT_ASSERT(t.find(keys[0])->accesses == 1001);
+
+  t.rebuildOptimal();
+  CPPUNIT_ASSERT(validateTree(t));
+  CPPUNIT_ASSERT(t.getHash() == hash);
+  // depth <= log2(total weight / its weight) + 1 
+  STNode * hot = t.find(keys[0]);
+  CPPUNIT_ASSERT(depthOf(hot) <= 3 && hot->accesses == 501);
+
+  SplayTree balanced;
+  vector<STNode *> nodes;
+  for (int k : sorted)
+    nodes.push_back(new STNode(k));
+  balanced.buildFromSorted(nodes);
+  balanced.setFrozen(true);
+  long long rebuiltCost = 0, balancedCost = 0;
+  for (int k : accesses) {
+    rebuiltCost += depthOf(t.find(k));
+    balancedCost += depthOf(balanced.find(k));
+  }
+  CPPUNIT_ASSERT(3 * rebuiltCost < 2 * balancedCost);
+
+  // with auto-rebuild, a new hot key rises 
+  // to the root after enough finds 
+  t.setAutoRebuild(10000);
+  for (int c = 0; c < 10000; c++)
+    t.find(keys[999]);
+  CPPUNIT_ASSERT(t.root->key == keys[999]);
+  CPPUNIT_ASSERT(validateTree(t));
+
+  t.setFrozen(false);
+  t.find(keys[500]);
+  CPPUNIT_ASSERT(t.root->key == keys[500]);
+
+  SplayTree empty;
+  empty.rebuildOptimal();
+  CPPUNIT_ASSERT(empty.root == nullptr);
+}
+
 int main() {
   // N.B. - all test methods have to be 
   // explicitly added to the test suite 
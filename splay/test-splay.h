@@ -20,6 +20,21 @@ class SplayTreeTest : public CPPUNIT_NS::TestFixture {
   CPPUNIT_TEST(testRemoveOne);
   CPPUNIT_TEST(testSizesWithInsert);
   CPPUNIT_TEST(testSizesWithRemove);
+  CPPUNIT_TEST(testFingerInsertFind);
+  CPPUNIT_TEST(testFingerNextPrev);
+  CPPUNIT_TEST(testExtractInsert);
+  CPPUNIT_TEST(testRekey);
+  CPPUNIT_TEST(testEraseRange);
+  CPPUNIT_TEST(testEraseIf);
+  CPPUNIT_TEST(testMinMax);
+  CPPUNIT_TEST(testPopMinMax);
+  CPPUNIT_TEST(testPopMultiset);
+  CPPUNIT_TEST(testMultiset);
+  CPPUNIT_TEST(testSelectRank);
+  CPPUNIT_TEST(testDiff);
+  CPPUNIT_TEST(testEquality);
+  CPPUNIT_TEST(testValidator);
+  CPPUNIT_TEST(testRebuildOptimal);
   CPPUNIT_TEST_SUITE_END();
 
   public:
@@ -38,6 +53,27 @@ class SplayTreeTest : public CPPUNIT_NS::TestFixture {
     void testSizesWithInsert();
     void testSizesWithRemove();
 
+    void testFingerInsertFind();
+    void testFingerNextPrev();
+
+    void testExtractInsert();
+    void testRekey();
+
+    void testEraseRange();
+    void testEraseIf();
+
+    void testMinMax();
+    void testPopMinMax();
+    void testPopMultiset();
+
+    void testMultiset();
+    void testSelectRank();
+
+    void testDiff();
+    void testEquality();
+    void testValidator();
+    void testRebuildOptimal();
+
 
   private:
     // SplayTree object to test 
@@ -0,0 +1,119 @@
+#include <string>
+#include <vector>
+
+#include "test-stats.h"
+#include "splay.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( StatsTest );
+
+// steps add up to the rotations, nested calls 
+// count once, allocations match the tree size 
+void StatsTest::testCounters() {
+  SplayTree t;
+  for (int i = 0; i < 1000; i++)
+    t.insert((i * 7919) % 1000);
+  for (int i = 0; i < 500; i++)
+    t.find(i);
+  t.insertMulti(3);
+  t.removeOne(3);
+  t.rank(10);
+  t.select(10);
+  t.eraseRange(100, 199);
+  t.remove(5);
+  t.popMin();
+
+  SplayStats s = t.getStats();
+  CPPUNIT_ASSERT(s.rotations > 0);
+  CPPUNIT_ASSERT(s.rotations == s.zigSteps + 2 * (s.zigZigSteps + s.zigZagSteps));
+
+  // insertMulti/removeOne call find, 
+  // which isn't counted on its own 
+  CPPUNIT_ASSERT(s.ops[STAT_FIND].count == 500);
+  CPPUNIT_ASSERT(s.ops[STAT_INSERT].count == 1001);
+  CPPUNIT_ASSERT(s.ops[STAT_REMOVE].count == 3);
+  CPPUNIT_ASSERT(s.ops[STAT_RANK].count == 1);
+  CPPUNIT_ASSERT(s.ops[STAT_SELECT].count == 1);
+  CPPUNIT_ASSERT(s.ops[STAT_RANGE].count == 1);
+  CPPUNIT_ASSERT(s.ops[STAT_FIND].latency.count() == 500);
+
+  CPPUNIT_ASSERT(s.nodeAllocs == 1000);
+  CPPUNIT_ASSERT(s.nodeAllocs - s.nodeFrees == t.getSize());
+
+  // nodes allocated outside of insert count too 
+  SplayTree loaded;
+  vector<STNode *> nodes;
+  for (int i = 0; i < 100; i++)
+    nodes.push_back(loaded.allocNode(i));
+  loaded.buildFromSorted(nodes);
+  CPPUNIT_ASSERT(loaded.getStats().nodeAllocs == 100);
+  NodeHandle nh = t.extract(500);
+  CPPUNIT_ASSERT(loaded.insert(std::move(nh)));
+  CPPUNIT_ASSERT(loaded.getStats().nodeAllocs == 100);
+
+  // the snapshot is a copy 
+  t.resetStats();
+  CPPUNIT_ASSERT(t.getStats().rotations == 0);
+  CPPUNIT_ASSERT(t.getStats().ops[STAT_FIND].count == 0);
+  CPPUNIT_ASSERT(s.ops[STAT_FIND].count == 500);
+}
+
+// ascending inserts leave a path, so the first 
+// find is deep and repeating it is cheap. a miss 
+// doesn't splay, so it stays deep every time 
+void StatsTest::testDepthAndDump() {
+  SplayTree t;
+  int n = 1000;
+  for (int i = 0; i < n; i++)
+    t.insert(i);
+  // each new max is a single zig below the old one, 
+  // and the presence check and the insert descent 
+  // only visit the root 
+  CPPUNIT_ASSERT(t.getStats().zigSteps == n - 1);
+  CPPUNIT_ASSERT(t.getStats().ops[STAT_INSERT].rotations.max() == 1);
+  CPPUNIT_ASSERT(t.getStats().ops[STAT_INSERT].depth.max() == 2);
+  t.resetStats();
+
+  t.find(-1);
+  t.find(-1);
+  CPPUNIT_ASSERT(t.getStats().ops[STAT_FIND].depth.min() == n);
+  CPPUNIT_ASSERT(t.getStats().ops[STAT_FIND].rotations.max() == 0);
+  t.resetStats();
+
+  t.find(0);
+  SplayStats s = t.getStats();
+  CPPUNIT_ASSERT(s.ops[STAT_FIND].depth.max() == n);
+  CPPUNIT_ASSERT(s.ops[STAT_FIND].rotations.max() == n - 1);
+  CPPUNIT_ASSERT(s.descentNodes == n);
+  // a path of left children is all zig-zig 
+  CPPUNIT_ASSERT(s.zigZigSteps == (n - 1) / 2);
+
+  t.resetStats();
+  t.find(0);
+  CPPUNIT_ASSERT(t.getStats().ops[STAT_FIND].depth.max() == 1);
+  CPPUNIT_ASSERT(t.getStats().ops[STAT_FIND].rotations.max() == 0);
+
+  // a frozen tree descends without rotating 
+  SplayTree frozen;
+  for (int i = 0; i < n; i++)
+    frozen.insert(i);
+  frozen.setFrozen(true);
+  frozen.resetStats();
+  frozen.find(0);
+  frozen.find(0);
+  CPPUNIT_ASSERT(frozen.getStats().ops[STAT_FIND].depth.min() == n);
+  CPPUNIT_ASSERT(frozen.getStats().rotations == 0);
+
+  string text = s.toText();
+  CPPUNIT_ASSERT(text.find("rotations 999") == 0);
+  CPPUNIT_ASSERT(text.find("find") != string::npos);
+  CPPUNIT_ASSERT(text.find("select") == string::npos);
+
+  string json = s.toJSON();
+  CPPUNIT_ASSERT(json.front() == '{' && json.back() == '}');
+  CPPUNIT_ASSERT(json.find("\"rotations\": 999") != string::npos);
+  CPPUNIT_ASSERT(json.find("\"descentNodes\": 1000") != string::npos);
+  CPPUNIT_ASSERT(json.find("\"find\": {\"count\": 1") != string::npos);
+  CPPUNIT_ASSERT(json.find("\"select\": {\"count\": 0") != string::npos);
+}
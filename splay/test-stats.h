@@ -0,0 +1,20 @@
+#ifndef TEST_STATS_H
+#define TEST_STATS_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "splay.h"
+
+// only built by make test-stats (with -DSPLAY_STATS) 
+class StatsTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(StatsTest);
+  CPPUNIT_TEST(testCounters);
+  CPPUNIT_TEST(testDepthAndDump);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testCounters();
+    void testDepthAndDump();
+};
+
+#endif 
@@ -0,0 +1,56 @@
+#include <atomic>
+
+#include "test-stress.h"
+#include "stress.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( StressTest );
+
+// a few short runs on dense, medium and 
+// sparse key ranges, with and without a 
+// filter and a hot-key cache, and frozen. 
+// the long ones are for the fuzz driver 
+void StressTest::testShortRuns() {
+  for (int keyRange : {16, 1000, 100000}) {
+    for (int w = 0; w < 5; w++) {
+      StressConfig c;
+      c.seed = stressWorkerSeed(42, w);
+      c.ops = 20000;
+      c.keyRange = keyRange;
+      c.validateEvery = 2000;
+      c.filter = w & 1;
+      c.hotCache = w & 2;
+      c.frozen = w == 4;
+      StressResult r;
+      CPPUNIT_ASSERT(runStress(c, r) && r.why.empty());
+      CPPUNIT_ASSERT(r.ops == c.ops && r.failedOp == -1);
+    }
+  }
+}
+
+// same seed, same run. progress counts 
+// every operation, and stop ends a run 
+// before it starts 
+void StressTest::testReproducible() {
+  StressConfig c;
+  c.seed = 7;
+  c.ops = 10000;
+  c.keyRange = 500;
+  StressResult a, b, d;
+  atomic<long long> progress(0);
+  CPPUNIT_ASSERT(runStress(c, a, nullptr, &progress));
+  CPPUNIT_ASSERT(progress == c.ops);
+  CPPUNIT_ASSERT(runStress(c, b));
+  CPPUNIT_ASSERT(a.size == b.size && a.hash == b.hash);
+  CPPUNIT_ASSERT(a.size > 0);
+
+  c.seed = 8;
+  CPPUNIT_ASSERT(runStress(c, d));
+  CPPUNIT_ASSERT(d.hash != a.hash);
+  CPPUNIT_ASSERT(stressWorkerSeed(1, 0) != stressWorkerSeed(1, 1));
+
+  atomic<bool> stop(true);
+  CPPUNIT_ASSERT(runStress(c, d, &stop));
+  CPPUNIT_ASSERT(d.ops == 0 && d.size == 0);
+}
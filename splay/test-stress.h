@@ -0,0 +1,19 @@
+#ifndef TEST_STRESS_H
+#define TEST_STRESS_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "stress.h"
+
+class StressTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(StressTest);
+  CPPUNIT_TEST(testShortRuns);
+  CPPUNIT_TEST(testReproducible);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void testShortRuns();
+    void testReproducible();
+};
+
+#endif 
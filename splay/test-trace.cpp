@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "test-trace.h"
+#include "test-utils.h"
+#include "trace.h"
+
+using namespace std;
+
+CPPUNIT_TEST_SUITE_REGISTRATION( TraceTest );
+
+void TraceTest::setUp() {
+  path = tempFile("splay-trace");
+}
+
+void TraceTest::tearDown() {
+  remove(path.c_str());
+}
+
+// same keys, counts and links everywhere 
+static bool sameShape(STNode * a, STNode * b) {
+  vector<pair<STNode *, STNode *> > stack;
+  stack.push_back(make_pair(a, b));
+  while (! stack.empty()) {
+    STNode * x = stack.back().first;
+    STNode * y = stack.back().second;
+    stack.pop_back();
+    if (x == nullptr || y == nullptr) {
+      if (x != y) return false;
+      continue;
+    }
+    if (x->key != y->key || x->count != y->count) return false;
+    stack.push_back(make_pair(x->left, y->left));
+    stack.push_back(make_pair(x->right, y->right));
+  }
+  return true;
+}
+
+// every kind of operation, reads included 
+void TraceTest::testReplaySameShape() {
+  SplayTree t;
+  TraceRecorder rec;
+  CPPUNIT_ASSERT(rec.open(path));
+  t.addObserver(&rec);
+
+  int maxVal = 5000;
+  Finger f;
+  srand(39);
+  for (int i = 0; i < 20000; i++) {
+    int k = rand() % maxVal;
+    switch (rand() % 12) {
+      case 0: case 1: case 2:
+        if (t.getCount(k) == 0) t.insert(k);
+        break;
+      case 3: t.find(k); break;
+      case 4: t.find(k, f); break;
+      case 5: t.remove(k); break;
+      case 6: t.insertMulti(k); break;
+      case 7: t.removeOne(k); break;
+      case 8: t.rank(k); break;
+      case 9: t.select(k % (t.getWeight() + 1)); break;
+      case 10: 
+        if (i % 50 == 0) t.eraseRange(k, k + 20);
+        break;
+      case 11: {
+        // a multiset node moved to a new key 
+        NodeHandle nh = t.extract(k);
+        if (! nh.empty()) {
+          nh.key() = k + maxVal;
+          t.insert(std::move(nh));
+        }
+        else
+          t.rekey(k + 1, k - maxVal);
+        break;
+      }
+    }
+    // a finger into a removed node would dangle 
+    f = Finger();
+  }
+  t.removeObserver(&rec);
+  CPPUNIT_ASSERT(rec.close());
+
+  SplayTree replayed;
+  TraceReader reader;
+  CPPUNIT_ASSERT(reader.open(path));
+  TraceEvent e;
+  long long n = 0;
+  while (reader.next(e)) {
+    applyTraceEvent(replayed, e);
+    n++;
+  }
+  CPPUNIT_ASSERT(! reader.truncated());
+  CPPUNIT_ASSERT(n == rec.eventCount());
+  CPPUNIT_ASSERT(replayed == t);
+  CPPUNIT_ASSERT(sameShape(replayed.root, t.root));
+}
+
+// sequential keys take ~3 bytes per event, 
+// and a torn tail ends the trace early 
+void TraceTest::testCompactAndTruncated() {
+  SplayTree t;
+  TraceRecorder rec;
+  CPPUNIT_ASSERT(rec.open(path));
+  t.addObserver(&rec);
+  for (int i = 0; i < 10000; i++)
+    t.insert(1000000 + 3 * i);
+  t.removeObserver(&rec);
+  CPPUNIT_ASSERT(rec.close());
+
+  CPPUNIT_ASSERT(rec.eventCount() == 10000);
+  // op byte, 1-byte delta, 1-byte count 
+  CPPUNIT_ASSERT(rec.bytesWritten() < 16 + 3 * 10000 + 8);
+
+  // cut the last record in half 
+  CPPUNIT_ASSERT(truncate(path.c_str(), rec.bytesWritten() - 1) == 0);
+  TraceReader reader;
+  CPPUNIT_ASSERT(reader.open(path));
+  TraceEvent e;
+  int n = 0, lastKey = 0;
+  while (reader.next(e)) {
+    CPPUNIT_ASSERT(e.op == TRACE_INSERT && e.b == 1);
+    lastKey = e.a;
+    n++;
+  }
+  CPPUNIT_ASSERT(n == 9999 && reader.truncated());
+  CPPUNIT_ASSERT(lastKey == 1000000 + 3 * 9998);
+
+  // not a trace 
+  FILE * fp = fopen(path.c_str(), "wb");
+  fputs("SPLAYLOG", fp);
+  fclose(fp);
+  CPPUNIT_ASSERT(! reader.open(path));
+}
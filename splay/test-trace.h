@@ -0,0 +1,26 @@
+#ifndef TEST_TRACE_H
+#define TEST_TRACE_H
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <string>
+#include "trace.h"
+
+class TraceTest : public CPPUNIT_NS::TestFixture {
+
+  CPPUNIT_TEST_SUITE(TraceTest);
+  CPPUNIT_TEST(testReplaySameShape);
+  CPPUNIT_TEST(testCompactAndTruncated);
+  CPPUNIT_TEST_SUITE_END();
+
+  public:
+    void setUp();
+    void tearDown();
+
+    void testReplaySameShape();
+    void testCompactAndTruncated();
+
+  private:
+    std::string path;
+};
+
+#endif 
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <bits/stdc++.h>
 #include <assert.h>
+#include <unistd.h>
+#include <dirent.h>
 #include "test-utils.h"
 
 
@@ -30,6 +32,43 @@ std::vector<int> randomInts(int n, int seed, int maxVal) {
 }
 
 
+// make a unique file under /tmp 
+std::string tempFile(const std::string &prefix) {
+  std::string path = "/tmp/" + prefix + "-XXXXXX";
+  std::vector<char> buf(path.begin(), path.end());
+  buf.push_back('\0');
+
+  int fd = mkstemp(buf.data());
+  assert(fd >= 0);
+  close(fd);
+  return std::string(buf.data());
+}
+
+std::string tempDir(const std::string &prefix) {
+  std::string path = "/tmp/" + prefix + "-XXXXXX";
+  std::vector<char> buf(path.begin(), path.end());
+  buf.push_back('\0');
+
+  char * dir = mkdtemp(buf.data());
+  assert(dir != nullptr);
+  return std::string(dir);
+}
+
+// only plain files are expected inside 
+void removeDir(const std::string &path) {
+  DIR * d = opendir(path.c_str());
+  if (d == nullptr) return;
+
+  struct dirent * e;
+  while ((e = readdir(d)) != nullptr) {
+    std::string name = e->d_name;
+    if (name != "." && name != "..")
+      unlink((path + "/" + name).c_str());
+  }
+  closedir(d);
+  rmdir(path.c_str());
+}
+
 // count nodes in a subtree
 // for testing augmented sizes 
 int countNodes(STNode *node) {
@@ -46,10 +85,207 @@ ll hashInorder(STNode *node) {
   ll pp = 1;
   ll hash = 0;
   for (int k : keys) {
-    hash += (k * pp) % M;
-    pp *= P;
+    hash = hashAdd(hash, hashMul(hashKey(k), pp));
+    pp = hashMul(pp, P % M);
+  }
+  return hash;
+}
+
+// everything the parent of a subtree needs 
+// to check itself (see validateTree) 
+struct SubtreeSummary {
+  bool empty;
+  long long size;
+  long long weight;
+  ll hash;
+  // P^size mod M, so the parent's hash is O(1) 
+  ll pw;
+  int minKey;
+  int maxKey;
+  STNode * minNode;
+  STNode * maxNode;
+};
+
+static SubtreeSummary emptySummary() {
+  SubtreeSummary s;
+  s.empty = true;
+  s.size = s.weight = 0;
+  s.hash = 0;
+  s.pw = 1;
+  s.minKey = s.maxKey = 0;
+  s.minNode = s.maxNode = nullptr;
+  return s;
+}
+
+static bool fail(std::string * why, STNode * node, const char * what) {
+  if (why != nullptr && why->empty())
+    *why = std::string(what) + " at key " + std::to_string(node->key);
+  return false;
+}
+
+// the child links of node point back at it. 
+// checked before descending, which also 
+// rules out cycles 
+static bool checkLinks(STNode * node, std::string * why) {
+  if (node->left != nullptr && node->left->parent != node)
+    return fail(why, node, "left child's parent pointer");
+  if (node->right != nullptr && node->right->parent != node)
+    return fail(why, node, "right child's parent pointer");
+  return true;
+}
+
+// check node from its children's summaries 
+// and summarize its subtree. the hash is 
+// recomputed with running powers of P, 
+// independently of combineHash 
+static bool checkNode(STNode * node, const SubtreeSummary &l, 
+                     const SubtreeSummary &r, SubtreeSummary &out, 
+                     std::string * why) {
+  if (! l.empty && l.maxKey >= node->key)
+    return fail(why, node, "BST order (left subtree)");
+  if (! r.empty && r.minKey <= node->key)
+    return fail(why, node, "BST order (right subtree)");
+  if (node->count < 1)
+    return fail(why, node, "count");
+
+  out.empty = false;
+  out.size = 1 + l.size + r.size;
+  out.weight = node->count + l.weight + r.weight;
+  ll p = P % M;
+  out.hash = hashAdd(hashAdd(l.hash, hashMul(hashKey(node->key), l.pw)), 
+                     hashMul(r.hash, hashMul(l.pw, p)));
+  out.pw = hashMul(hashMul(l.pw, p), r.pw);
+  out.minKey = l.empty ? node->key : l.minKey;
+  out.maxKey = r.empty ? node->key : r.maxKey;
+  out.minNode = l.empty ? node : l.minNode;
+  out.maxNode = r.empty ? node : r.maxNode;
+
+  if (node->size != out.size)
+    return fail(why, node, "subtree size");
+  if (node->weight != out.weight)
+    return fail(why, node, "subtree weight");
+  if (node->hash != out.hash)
+    return fail(why, node, "subtree hash");
+  return true;
+}
+
+// iterative post-order over the subtree at node. 
+// children's summaries are taken from done 
+// if they are there (subtrees checked by 
+// another thread), so the same walk also 
+// combines the parallel results 
+static bool validateSubtree(STNode * node, SubtreeSummary &out, std::string * why,
+                            const std::unordered_map<STNode *, SubtreeSummary> * done = nullptr) {
+  std::vector<std::pair<STNode *, bool> > stack;
+  std::vector<SubtreeSummary> results;
+  stack.push_back(std::make_pair(node, false));
+
+  while (! stack.empty()) {
+    STNode * n = stack.back().first;
+    bool expanded = stack.back().second;
+    stack.pop_back();
+
+    if (n == nullptr) {
+      results.push_back(emptySummary());
+      continue;
+    }
+    if (done != nullptr && ! expanded) {
+      auto it = done->find(n);
+      if (it != done->end()) {
+        results.push_back(it->second);
+        continue;
+      }
+    }
+    if (! expanded) {
+      if (! checkLinks(n, why)) return false;
+      // left is finished first, so it ends up 
+      // below the right one on the results stack 
+      stack.push_back(std::make_pair(n, true));
+      stack.push_back(std::make_pair(n->right, false));
+      stack.push_back(std::make_pair(n->left, false));
+      continue;
+    }
+
+    SubtreeSummary r = results.back();
+    results.pop_back();
+    SubtreeSummary l = results.back();
+    results.pop_back();
+    SubtreeSummary s;
+    if (! checkNode(n, l, r, s, why)) return false;
+    results.push_back(s);
+  }
+
+  out = results.back();
+  return true;
+}
+
+bool validateTree(const SplayTree &t, int threads, std::string * why) {
+  if (why != nullptr) why->clear();
+  STNode * root = t.root;
+  SubtreeSummary s = emptySummary();
+
+  if (root != nullptr && root->parent != nullptr)
+    return fail(why, root, "root's parent pointer");
+
+  if (threads <= 1 || root == nullptr) {
+    if (! validateSubtree(root, s, why)) return false;
+  }
+  else {
+    // split off subtrees of at most ~n / (8 * threads) 
+    // nodes (by their stored sizes, which only 
+    // affects the split, not the result) 
+    long long chunk = std::max(1LL, (long long) root->size / (8LL * threads));
+    std::vector<STNode *> tasks;
+    std::vector<STNode *> todo(1, root);
+    while (! todo.empty()) {
+      STNode * n = todo.back();
+      todo.pop_back();
+      if (n->size <= chunk) {
+        tasks.push_back(n);
+        continue;
+      }
+      if (! checkLinks(n, why)) return false;
+      if (n->left != nullptr) todo.push_back(n->left);
+      if (n->right != nullptr) todo.push_back(n->right);
+    }
+
+    std::vector<SubtreeSummary> results(tasks.size());
+    std::vector<std::string> errors(threads);
+    std::atomic<size_t> next(0);
+    std::atomic<bool> ok(true);
+    std::vector<std::thread> workers;
+    for (int w = 0; w < threads; w++) {
+      workers.push_back(std::thread([&, w]() {
+        size_t i;
+        while (ok && (i = next++) < tasks.size())
+          if (! validateSubtree(tasks[i], results[i], &errors[w]))
+            ok = false;
+      }));
+    }
+    for (std::thread &w : workers) 
+      w.join();
+
+    if (! ok) {
+      for (std::string &e : errors)
+        if (why != nullptr && ! e.empty()) *why = e;
+      return false;
+    }
+
+    std::unordered_map<STNode *, SubtreeSummary> done;
+    for (size_t i = 0; i < tasks.size(); i++)
+      done[tasks[i]] = results[i];
+    if (! validateSubtree(root, s, why, &done)) return false;
+  }
+
+  if (t.peekMin() != s.minNode) {
+    if (why != nullptr) *why = "cached min node";
+    return false;
+  }
+  if (t.peekMax() != s.maxNode) {
+    if (why != nullptr) *why = "cached max node";
+    return false;
   }
-  return hash % M;
+  return true;
 }
 
 // check all nodes using 
@@ -2,6 +2,7 @@
 #define TEST_UTILS_H
 
 #include <vector>
+#include <string>
 #include "splay.h"
 
 
@@ -9,6 +10,15 @@ const int MAX_VAL = 10000;
 // generate n random non-negative integers upper bounded by maxVal
 std::vector<int> randomInts(int n, int seed=0, int maxVal=MAX_VAL);
 
+// create an empty temporary file and return its path 
+// (caller removes it) 
+std::string tempFile(const std::string &prefix);
+
+// same for an empty directory, and remove 
+// a directory with the files in it 
+std::string tempDir(const std::string &prefix);
+void removeDir(const std::string &path);
+
 // count nodes in a subtree
 int countNodes(STNode * node);
 
@@ -16,6 +26,23 @@ int countNodes(STNode * node);
 // subtree rooted at this node 
 ll hashInorder(STNode * node);
 
+// check every invariant of a tree in one 
+// bottom-up pass: BST order, child/parent links, 
+// subtree sizes, weights and hashes, and the 
+// cached min/max nodes. 
+//
+// unlike the predicates below (which recount 
+// every subtree for every node, O(n^2)), each 
+// node is checked from its children's results 
+// in O(1), so this is O(n). it is iterative, so 
+// path-shaped trees can't overflow the stack. 
+//
+// with threads > 1, disjoint subtrees are checked 
+// in parallel and the nodes above them afterwards. 
+// on failure, why (if given) says which node 
+// and invariant failed 
+bool validateTree(const SplayTree &t, int threads = 1, std::string * why = nullptr);
+
 // TODO add traceback for when test fails on a particular node 
 
 // to create a new predicate for a tree: 
@@ -0,0 +1,270 @@
+#include "trace.h"
+#include <cstring>
+
+// file header: magic + version + padding
+const size_t TRACE_HEADER_SIZE = 16;
+
+const char * traceOpName(int op) {
+  static const char * names[TRACE_NUM_OPS] = {
+    "?", "find", "insert", "remove", "eraseRange",
+    "insertMulti", "removeOne", "rekey", "rank", "select"
+  };
+  return op > 0 && op < TRACE_NUM_OPS ? names[op] : "?";
+}
+
+// zigzag: small negative and positive
+// numbers both become small unsigned ones
+static uint64_t zigzag(int64_t v) {
+  return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+  return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+//
+// recorder
+//
+
+TraceRecorder::TraceRecorder()
+  : f(nullptr),
+    prevKey(0),
+    events(0),
+    bytes(0) { }
+
+TraceRecorder::~TraceRecorder() {
+  close();
+}
+
+bool TraceRecorder::open(const std::string &path) {
+  close();
+  f = fopen(path.c_str(), "wb");
+  if (f == nullptr) return false;
+
+  char header[TRACE_HEADER_SIZE];
+  memset(header, 0, sizeof(header));
+  memcpy(header, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  memcpy(header + sizeof(TRACE_MAGIC), &TRACE_VERSION, sizeof(TRACE_VERSION));
+
+  prevKey = 0;
+  events = 0;
+  bytes = sizeof(header);
+  if (fwrite(header, sizeof(header), 1, f) != 1) {
+    fclose(f);
+    f = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool TraceRecorder::close() {
+  if (f == nullptr) return true;
+  bool ok = ! ferror(f);
+  ok = fclose(f) == 0 && ok;
+  f = nullptr;
+  return ok;
+}
+
+// write errors are sticky in the FILE and
+// reported by close()
+void TraceRecorder::putByte(uint8_t b) {
+  putc(b, f);
+  bytes++;
+}
+
+void TraceRecorder::putVarint(uint64_t v) {
+  while (v >= 0x80) {
+    putByte((uint8_t) (v | 0x80));
+    v >>= 7;
+  }
+  putByte((uint8_t) v);
+}
+
+void TraceRecorder::putKey(int key) {
+  putVarint(zigzag((int64_t) key - prevKey));
+  prevKey = key;
+}
+
+void TraceRecorder::record(uint8_t op, int key) {
+  if (f == nullptr) return;
+  putByte(op);
+  putKey(key);
+  events++;
+}
+
+void TraceRecorder::onInsert(int key, int count) {
+  if (f == nullptr) return;
+  record(TRACE_INSERT, key);
+  putVarint(count);
+}
+
+void TraceRecorder::onRemove(int key) {
+  record(TRACE_REMOVE, key);
+}
+
+void TraceRecorder::onEraseRange(int lo, int hi) {
+  if (f == nullptr) return;
+  record(TRACE_ERASE_RANGE, lo);
+  putVarint(zigzag((int64_t) hi - lo));
+}
+
+void TraceRecorder::onInsertMulti(int key) {
+  record(TRACE_INSERT_MULTI, key);
+}
+
+void TraceRecorder::onRemoveOne(int key) {
+  record(TRACE_REMOVE_ONE, key);
+}
+
+// the new key is the next delta base
+void TraceRecorder::onRekey(int oldKey, int newKey) {
+  if (f == nullptr) return;
+  record(TRACE_REKEY, oldKey);
+  putKey(newKey);
+}
+
+void TraceRecorder::onFind(int key) {
+  record(TRACE_FIND, key);
+}
+
+void TraceRecorder::onRank(int key) {
+  record(TRACE_RANK, key);
+}
+
+void TraceRecorder::onSelect(int i) {
+  if (f == nullptr) return;
+  putByte(TRACE_SELECT);
+  putVarint(zigzag(i));
+  events++;
+}
+
+//
+// reader
+//
+
+TraceReader::TraceReader()
+  : f(nullptr),
+    prevKey(0),
+    corrupt(false) { }
+
+TraceReader::~TraceReader() {
+  close();
+}
+
+bool TraceReader::open(const std::string &path) {
+  close();
+  f = fopen(path.c_str(), "rb");
+  if (f == nullptr) return false;
+
+  char header[TRACE_HEADER_SIZE];
+  uint32_t version;
+  bool ok = fread(header, sizeof(header), 1, f) == 1;
+  memcpy(&version, header + sizeof(TRACE_MAGIC), sizeof(version));
+  ok = ok && memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0;
+  ok = ok && version == TRACE_VERSION;
+  if (! ok) {
+    close();
+    return false;
+  }
+
+  prevKey = 0;
+  corrupt = false;
+  return true;
+}
+
+void TraceReader::close() {
+  if (f != nullptr)
+    fclose(f);
+  f = nullptr;
+}
+
+// at most 10 bytes for 64 bits
+bool TraceReader::getVarint(uint64_t &v) {
+  v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int c = getc(f);
+    if (c == EOF) return false;
+    v |= (uint64_t) (c & 0x7f) << shift;
+    if ((c & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+bool TraceReader::getKey(int32_t &key) {
+  uint64_t v;
+  if (! getVarint(v)) return false;
+  int64_t k = prevKey + unzigzag(v);
+  if (k < INT32_MIN || k > INT32_MAX) return false;
+  key = prevKey = (int32_t) k;
+  return true;
+}
+
+bool TraceReader::next(TraceEvent &e) {
+  if (f == nullptr) return false;
+
+  int op = getc(f);
+  if (op == EOF) return false;
+
+  e.op = op;
+  e.a = e.b = 0;
+  uint64_t v = 0;
+  bool ok;
+  switch (op) {
+    case TRACE_FIND:
+    case TRACE_REMOVE:
+    case TRACE_INSERT_MULTI:
+    case TRACE_REMOVE_ONE:
+    case TRACE_RANK:
+      ok = getKey(e.a);
+      break;
+    case TRACE_INSERT:
+      ok = getKey(e.a) && getVarint(v) && v <= INT32_MAX;
+      e.b = v;
+      break;
+    case TRACE_ERASE_RANGE: {
+      ok = getKey(e.a) && getVarint(v);
+      int64_t hi = (int64_t) e.a + unzigzag(v);
+      ok = ok && hi >= INT32_MIN && hi <= INT32_MAX;
+      e.b = hi;
+      break;
+    }
+    case TRACE_REKEY:
+      ok = getKey(e.a) && getKey(e.b);
+      break;
+    case TRACE_SELECT: {
+      ok = getVarint(v);
+      int64_t i = unzigzag(v);
+      ok = ok && i >= INT32_MIN && i <= INT32_MAX;
+      e.a = i;
+      break;
+    }
+    default:
+      ok = false;
+  }
+
+  if (! ok) {
+    corrupt = true;
+    close();
+  }
+  return ok;
+}
+
+void applyTraceEvent(SplayTree &t, const TraceEvent &e) {
+  switch (e.op) {
+    case TRACE_FIND:         t.find(e.a); break;
+    case TRACE_REMOVE:       t.remove(e.a); break;
+    case TRACE_ERASE_RANGE:  t.eraseRange(e.a, e.b); break;
+    case TRACE_INSERT_MULTI: t.insertMulti(e.a); break;
+    case TRACE_REMOVE_ONE:   t.removeOne(e.a); break;
+    case TRACE_REKEY:        t.rekey(e.a, e.b); break;
+    case TRACE_RANK:         t.rank(e.a); break;
+    case TRACE_SELECT:       t.select(e.a); break;
+    case TRACE_INSERT:
+      // a re-linked multiset node: the extra copies
+      // find it at the root, so the shape is the same
+      t.insert(e.a);
+      for (int i = 1; i < e.b; i++)
+        t.insertMulti(e.a);
+      break;
+  }
+}
@@ -0,0 +1,137 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "splay.h"
+
+// compact binary traces of tree operations,
+// for replaying captured traffic offline
+// (see replay.cpp).
+//
+// a TraceRecorder is attached to a tree as an
+// observer and logs every operation that notifies
+// observers, reads included (see TreeObserver).
+// replaying the trace on an empty tree with
+// applyTraceEvent ends with the same keys and
+// counts. it repeats the same splays, so it also
+// ends with the same shape, unless the recorded
+// tree used any of
+//  - eraseIf, which is traced as single removes
+//    but relinks the survivors as a balanced tree
+//  - next/prev on a Finger, which splay but are
+//    not traced
+//  - the hot cache (enableHotCache): a hit is
+//    traced as a find but didn't splay
+//  - setFrozen, rebuildOptimal or setAutoRebuild,
+//    which aren't traced and change how reads
+//    splay or relink the whole tree
+//  - isolateRange and diff (which calls it),
+//    neither of them traced
+//
+// file layout: 8-byte magic, version, 4 bytes
+// padding, then one record per event: an op byte
+// followed by its arguments as varints (LEB128).
+// keys are stored as the zigzag-encoded
+// difference to the previous key in the trace,
+// so clustered or sequential traffic takes 2-3
+// bytes per event instead of a fixed-size record.
+//
+// unlike the OpLog there are no checksums and
+// no fsyncs: a trace is a measurement, and a torn
+// tail just ends the trace early.
+
+const char TRACE_MAGIC[8] = {'S','P','L','A','Y','T','R','C'};
+const uint32_t TRACE_VERSION = 1;
+
+enum TraceOp : uint8_t {
+  TRACE_FIND = 1,       // a = key
+  TRACE_INSERT,         // a = key, b = count
+  TRACE_REMOVE,         // a = key
+  TRACE_ERASE_RANGE,    // a = lo, b = hi
+  TRACE_INSERT_MULTI,   // a = key
+  TRACE_REMOVE_ONE,     // a = key
+  TRACE_REKEY,          // a = old key, b = new key
+  TRACE_RANK,           // a = key
+  TRACE_SELECT,         // a = index (not delta encoded)
+  TRACE_NUM_OPS
+};
+
+const char * traceOpName(int op);
+
+struct TraceEvent {
+  uint8_t op;
+  int32_t a;
+  int32_t b;
+};
+
+class TraceRecorder : public TreeObserver {
+  private:
+    FILE * f;
+    int prevKey;
+    long long events;
+    long long bytes;
+
+    void putByte(uint8_t b);
+    void putVarint(uint64_t v);
+    void putKey(int key);
+    void record(uint8_t op, int key);
+
+  public:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    // create (or truncate) the trace file
+    bool open(const std::string &path);
+    // flush and close. returns false if
+    // any write failed
+    bool close();
+    bool isOpen() const { return f != nullptr; }
+
+    long long eventCount() const { return events; }
+    long long bytesWritten() const { return bytes; }
+
+    void onInsert(int key, int count);
+    void onRemove(int key);
+    void onEraseRange(int lo, int hi);
+    void onInsertMulti(int key);
+    void onRemoveOne(int key);
+    void onRekey(int oldKey, int newKey);
+    void onFind(int key);
+    void onRank(int key);
+    void onSelect(int i);
+};
+
+class TraceReader {
+  private:
+    FILE * f;
+    int prevKey;
+    bool corrupt;
+
+    bool getVarint(uint64_t &v);
+    bool getKey(int32_t &key);
+
+  public:
+    TraceReader();
+    ~TraceReader();
+
+    // false if the file is missing or
+    // has a bad header
+    bool open(const std::string &path);
+    void close();
+
+    // next event, false at the end of the trace
+    // (or at the first malformed record)
+    bool next(TraceEvent &e);
+
+    // true if the trace ended in a malformed
+    // or torn record rather than at end of file
+    bool truncated() const { return corrupt; }
+};
+
+// apply one traced operation to t, as the
+// public operation that produced it
+void applyTraceEvent(SplayTree &t, const TraceEvent &e);
+
+#endif